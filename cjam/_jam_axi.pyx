@@ -1,12 +1,27 @@
 # Python wrappers for JAM functions in C.
 
 from __future__ import print_function
+import hashlib
+from collections import OrderedDict
 import numpy as np
 from astropy import table, units as u
 cimport cython_jam
 
 
-def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q, beta, kappa, nrad=30, nang=7):
+# recently computed axisymmetric models in km/s, keyed by the distance-free
+# part of the model so that distance and nscale changes can be rescaled
+_scaling_cache = OrderedDict()
+_scaling_cache_size = 16
+
+# reasons for rejecting a model, by C status code
+_status_message = {
+    cython_jam.JAM_ERR_INCL: "the inclination is too low to deproject the MGEs",
+    cython_jam.JAM_ERR_FLAT: "a deprojected MGE component is flatter than q=0.05",
+    cython_jam.JAM_ERR_INPUT: "the anisotropy must be less than 1",
+}
+
+
+def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q, beta, kappa, nrad=30, nang=7, nthread=1):
     
     # set array types for C
     cdef double [:] c_xp
@@ -22,6 +37,8 @@ def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     cdef double [:] c_vx
     cdef double [:] c_vy
     cdef double [:] c_vz
+    cdef int [:] c_posflag
+    cdef double [:] c_poserr
     cdef double c_incl
     cdef int c_nxy
     cdef int c_lum_total
@@ -29,6 +46,8 @@ def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     cdef int c_nrad
     cdef int c_nang
     cdef int c_integrationFlag
+    cdef int c_nthread
+    cdef int c_status
     
     # set c inputs
     c_nxy = len(xp)
@@ -37,6 +56,7 @@ def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     c_nrad = nrad
     c_nang = nang
     c_incl = incl
+    c_nthread = nthread
     
     # initialise integration error flag
     c_integrationFlag = 0
@@ -57,28 +77,44 @@ def axi_vel(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     c_vx = np.zeros(c_nxy)
     c_vy = np.zeros(c_nxy)
     c_vz = np.zeros(c_nxy)
+    c_posflag = np.zeros(c_nxy, dtype=np.intc)
+    c_poserr = np.zeros(c_nxy)
     
     # now call the JAM code
     try:
-        cython_jam.jam_axi_vel(&c_xp[0], &c_yp[0], c_nxy, c_incl,
+        c_status = cython_jam.jam_axi_vel(&c_xp[0], &c_yp[0], c_nxy, c_incl,
             &c_lum_area[0], &c_lum_sigma[0], &c_lum_q[0], c_lum_total,
             &c_pot_area[0], &c_pot_sigma[0], &c_pot_q[0], c_pot_total,
             &c_beta[0], &c_kappa[0], c_nrad, c_nang, &c_integrationFlag,
-            &c_vx[0], &c_vy[0], &c_vz[0])
+            &c_vx[0], &c_vy[0], &c_vz[0], &c_posflag[0], &c_poserr[0],
+            c_nthread)
     except:
         print("CJAM first moments failed in axi_vel.", flush=True)
         return False
     
-    # check if integration failed
-    if c_integrationFlag!=0:
-        print("CJAM first moments integration failed.", flush=True)
+    # check if the model was rejected
+    if c_status in _status_message:
+        print("CJAM first moments rejected model:", _status_message[c_status], flush=True)
         return False
     
+    # check if integration failed: give up if it failed for every star (or
+    # for none in particular), otherwise blank out the stars that failed
+    if c_integrationFlag!=0:
+        failed = np.asarray(c_posflag)!=0
+        if failed.all() or not failed.any():
+            print("CJAM first moments integration failed.", flush=True)
+            return False
+        print("CJAM first moments integration failed for", failed.sum(),
+            "of", c_nxy, "stars, whose moments are set to NaN.", flush=True)
+        np.asarray(c_vx)[failed] = np.nan
+        np.asarray(c_vy)[failed] = np.nan
+        np.asarray(c_vz)[failed] = np.nan
+    
     return c_vx, c_vy, c_vz
 
 
 
-def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q, beta, nrad=30, nang=7, xaxis=True, yaxis=True, zaxis=True):
+def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q, beta, nrad=30, nang=7, xaxis=True, yaxis=True, zaxis=True, nthread=1):
     
     # set array types for C
     cdef double [:] c_xp
@@ -96,6 +132,8 @@ def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     cdef double [:] c_rxy
     cdef double [:] c_rxz
     cdef double [:] c_ryz
+    cdef int [:] c_posflag
+    cdef double [:] c_poserr
     cdef double c_incl
     cdef int c_nxy
     cdef int c_lum_total
@@ -106,6 +144,8 @@ def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     cdef int c_xaxis
     cdef int c_yaxis
     cdef int c_zaxis
+    cdef int c_nthread
+    cdef int c_status
     
     # set c inputs
     c_nxy = len(xp)
@@ -117,6 +157,7 @@ def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     c_xaxis = int(xaxis)
     c_yaxis = int(yaxis)
     c_zaxis = int(zaxis)
+    c_nthread = nthread
     
     # initialise integration error flag
     c_integrationFlag = 0
@@ -139,35 +180,103 @@ def axi_rms(xp, yp, incl, lum_area, lum_sigma, lum_q, pot_area, pot_sigma, pot_q
     c_rxy = np.full(c_nxy, np.nan)
     c_rxz = np.full(c_nxy, np.nan)
     c_ryz = np.full(c_nxy, np.nan)
+    c_posflag = np.zeros(c_nxy, dtype=np.intc)
+    c_poserr = np.zeros(c_nxy)
     
     # now call the JAM code
     try:
-        cython_jam.jam_axi_rms_axes(&c_xp[0], &c_yp[0], c_nxy, c_incl,
+        c_status = cython_jam.jam_axi_rms_axes(&c_xp[0], &c_yp[0], c_nxy, c_incl,
             &c_lum_area[0], &c_lum_sigma[0], &c_lum_q[0], c_lum_total,
             &c_pot_area[0], &c_pot_sigma[0], &c_pot_q[0], c_pot_total,
             &c_beta[0], c_nrad, c_nang, &c_integrationFlag,
             &c_rxx[0], &c_ryy[0], &c_rzz[0], &c_rxy[0],
             &c_rxz[0], &c_ryz[0],
-            c_xaxis, c_yaxis, c_zaxis)
+            c_xaxis, c_yaxis, c_zaxis, &c_posflag[0], &c_poserr[0],
+            c_nthread)
     except:
         print("CJAM second moments failed in axi_rms.", flush=True)
         return False
     
-    # check if integration failed
-    if c_integrationFlag!=0:
-        print("CJAM second moments integration failed.", flush=True)
+    # check if the model was rejected
+    if c_status in _status_message:
+        print("CJAM second moments rejected model:", _status_message[c_status], flush=True)
         return False
     
+    # check if integration failed: give up if it failed for every star (or
+    # for none in particular), otherwise blank out the stars that failed
+    if c_integrationFlag!=0:
+        failed = np.asarray(c_posflag)!=0
+        if failed.all() or not failed.any():
+            print("CJAM second moments integration failed.", flush=True)
+            return False
+        print("CJAM second moments integration failed for", failed.sum(),
+            "of", c_nxy, "stars, whose moments are set to NaN.", flush=True)
+        np.asarray(c_rxx)[failed] = np.nan
+        np.asarray(c_ryy)[failed] = np.nan
+        np.asarray(c_rzz)[failed] = np.nan
+        np.asarray(c_rxy)[failed] = np.nan
+        np.asarray(c_rxz)[failed] = np.nan
+        np.asarray(c_ryz)[failed] = np.nan
+    
     return c_rxx, c_ryy, c_rzz, c_rxy, c_rxz, c_ryz
 
 
 
-def axisymmetric(xp, yp, tracer_mge, potential_mge, distance, beta=0, kappa=0, nscale=1, mscale=1, incl=np.pi/2*u.rad, mbh=0*u.Msun, rbh=0*u.arcsec, nrad=30, nang=7, xaxis=True, yaxis=True, zaxis=True):
+def _scaling_key(xp, yp, tracer_mge, potential_mge, distance, beta, kappa, mscale, incl, mbh, rbh, nrad, nang, xaxis, yaxis, zaxis):
+    
+    # At fixed surface densities, a change of distance rescales every length
+    # by the same factor, so the model is set by everything except distance.
+    # The tracer normalisation cancels in the moments, so only the relative
+    # tracer intensities enter.  The BH enters through its surface density,
+    # which is fixed when mbh/distance^2 is fixed.
+    # (rounded, as mbh/distance^2 is usually built by the caller from floats)
+    if mbh>0 and rbh>0:
+        bh = [float("%.12g" % (mbh/distance**2).to("Msun/kpc**2").value),
+            rbh.to("arcsec").value]
+    else:
+        bh = [0., 0.]
+    tracer_i = np.asarray(tracer_mge["i"].value, dtype=np.double)
+    parts = [
+        xp.to("arcsec").value, yp.to("arcsec").value,
+        tracer_i/np.max(np.abs(tracer_i)),
+        tracer_mge["s"].to("arcsec").value, tracer_mge["q"],
+        (potential_mge["i"]*mscale).to("Msun/pc**2").value,
+        potential_mge["s"].to("arcsec").value, potential_mge["q"],
+        beta, kappa, incl.to("rad").value, bh,
+        [nrad, nang, xaxis, yaxis, zaxis]]
+    
+    key = hashlib.sha1()
+    for part in parts:
+        key.update(np.ascontiguousarray(part, dtype=np.double).tobytes())
+        key.update(b"|")
+    
+    return key.hexdigest()
+
+
+
+def axisymmetric(xp, yp, tracer_mge, potential_mge, distance, beta=0, kappa=0, nscale=1, mscale=1, incl=np.pi/2*u.rad, mbh=0*u.Msun, rbh=0*u.arcsec, nrad=30, nang=7, xaxis=True, yaxis=True, zaxis=True, cache=True, nthread=1):
     
     # make sure anisotropy and rotation arrays are the correct length
     beta = np.ones(len(tracer_mge))*beta
     kappa = np.ones(len(tracer_mge))*kappa
     
+    # if the same model was run at another distance or tracer normalisation,
+    # rescale it: lengths scale with distance at fixed surface densities, so
+    # the second moments [km/s] scale with distance and first moments with
+    # its square root, and nscale cancels in the moments altogether
+    if cache:
+        key = _scaling_key(xp, yp, tracer_mge, potential_mge, distance,
+            beta, kappa, mscale, incl, mbh, rbh, nrad, nang,
+            xaxis, yaxis, zaxis)
+        if key in _scaling_cache:
+            _scaling_cache.move_to_end(key)
+            cached_distance, cached = _scaling_cache[key]
+            scale = (distance/cached_distance).to("").value
+            vx, vy, vz = [v*np.sqrt(scale) for v in cached[:3]]
+            rxx, ryy, rzz, rxy, rxz, ryz = [r*scale for r in cached[3:]]
+            return _axisymmetric_moments(distance, vx, vy, vz,
+                rxx, ryy, rzz, rxy, rxz, ryz, xaxis, yaxis, zaxis)
+    
     # copy MGEs so that changes we make here aren't propagated
     tracer_copy = tracer_mge.copy()
     potential_copy = potential_mge.copy()
@@ -201,7 +310,8 @@ def axisymmetric(xp, yp, tracer_mge, potential_mge, distance, beta=0, kappa=0, n
             beta,
             kappa,
             nrad,
-            nang)
+            nang,
+            nthread=nthread)
     except:
         print("CJAM first moments failed in axisymmetric.", flush=True)
         return False
@@ -223,11 +333,26 @@ def axisymmetric(xp, yp, tracer_mge, potential_mge, distance, beta=0, kappa=0, n
             nang,
             xaxis=xaxis,
             yaxis=yaxis,
-            zaxis=zaxis)
+            zaxis=zaxis,
+            nthread=nthread)
     except:
         print("CJAM second moments failed in axisymmetric.", flush=True)
         return False
     
+    # keep the moments in km/s for rescaling at other distances
+    if cache:
+        _scaling_cache[key] = (distance,
+            (vx, vy, vz, rxx, ryy, rzz, rxy, rxz, ryz))
+        if len(_scaling_cache)>_scaling_cache_size:
+            _scaling_cache.popitem(last=False)
+    
+    return _axisymmetric_moments(distance, vx, vy, vz,
+        rxx, ryy, rzz, rxy, rxz, ryz, xaxis, yaxis, zaxis)
+
+
+
+def _axisymmetric_moments(distance, vx, vy, vz, rxx, ryy, rzz, rxy, rxz, ryz, xaxis, yaxis, zaxis):
+    
     # put results into astropy table, also convert PMs to mas/yr
     kms2masyr = (u.km/u.s*u.rad/distance).to("mas/yr")
     moments = table.QTable()
@@ -2,23 +2,35 @@
 
 cdef extern from "../src/jam/jam.h":
 
-    void jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
+    cdef enum jam_status:
+        JAM_OK
+        JAM_ERR_IO
+        JAM_ERR_INCL
+        JAM_ERR_FLAT
+        JAM_ERR_INPUT
+        JAM_ERR_INTEGRAL
+        JAM_ERR_CANCEL
+        JAM_ERR_BUDGET
+    
+    jam_status jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
         double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
         double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
         double *beta, int nrad, int nang, int* integrationFlag, \
         double *rxx, double *ryy, double *rzz, \
-        double *rxy, double *rxz, double *ryz)
+        double *rxy, double *rxz, double *ryz, int nthread)
     
-    void jam_axi_rms_axes(double *xp, double *yp, int nxy, double incl, \
+    jam_status jam_axi_rms_axes(double *xp, double *yp, int nxy, double incl, \
         double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
         double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
         double *beta, int nrad, int nang, int* integrationFlag, \
         double *rxx, double *ryy, double *rzz, \
         double *rxy, double *rxz, double *ryz, \
-        int xaxis, int yaxis, int zaxis)
+        int xaxis, int yaxis, int zaxis, int *posflag, double *poserr, \
+        int nthread)
     
-    void jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
+    jam_status jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
         double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
         double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
         double *beta, double *kappa, int nrad, int nang, \
-        int* integrationFlag, double *vx, double *vy, double *vz)
+        int* integrationFlag, double *vx, double *vy, double *vz, \
+        int *posflag, double *poserr, int nthread)
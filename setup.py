@@ -7,20 +7,46 @@ from Cython.Build import cythonize
 
 
 sources = ["cjam/_jam_axi.pyx"]
-interp = ["src/interp/interp2dpol.c"]
-jam = ["src/jam/jam_axi_rms.c", "src/jam/jam_axi_rms_axes.c",
-    "src/jam/jam_axi_rms_mgeint.c", "src/jam/jam_axi_rms_mmt.c",
-    "src/jam/jam_axi_rms_wmmt.c", "src/jam/jam_axi_vel.c",
-    "src/jam/jam_axi_vel_losint.c", "src/jam/jam_axi_vel_mgeint.c",
-    "src/jam/jam_axi_vel_mmt.c", "src/jam/jam_axi_vel_wmmt.c"]
+cache = ["src/cache/cache_evict.c", "src/cache/cache_get.c",
+    "src/cache/cache_key.c", "src/cache/cache_open.c", "src/cache/cache_put.c"]
+emu = ["src/emu/emu_eval.c", "src/emu/emu_free.c", "src/emu/emu_train.c"]
+interp = ["src/interp/interp2dpol.c", "src/interp/interp2dquad.c",
+    "src/interp/interp2dspec.c"]
+jam = ["src/jam/jam_axi_adapt.c", "src/jam/jam_axi_cache.c",
+    "src/jam/jam_axi_cost.c", "src/jam/jam_axi_emu.c",
+    "src/jam/jam_axi_fold.c", "src/jam/jam_axi_graph.c",
+    "src/jam/jam_axi_grid.c", "src/jam/jam_axi_gsl.c",
+    "src/jam/jam_axi_interp.c", "src/jam/jam_axi_map.c",
+    "src/jam/jam_axi_mmt.c", "src/jam/jam_axi_plan.c",
+    "src/jam/jam_axi_pool.c", "src/jam/jam_axi_posstat.c",
+    "src/jam/jam_axi_prog.c", "src/jam/jam_axi_quadvec.c",
+    "src/jam/jam_axi_rms.c", "src/jam/jam_axi_rms_axes.c",
+    "src/jam/jam_axi_rms_batch.c", "src/jam/jam_axi_rms_cross.c",
+    "src/jam/jam_axi_rms_eval.c", "src/jam/jam_axi_rms_grad.c",
+    "src/jam/jam_axi_rms_mgegrad.c", "src/jam/jam_axi_rms_mgeint.c",
+    "src/jam/jam_axi_rms_mmt.c", "src/jam/jam_axi_rms_wgrad.c",
+    "src/jam/jam_axi_rms_wmmt.c", "src/jam/jam_axi_sentinel.c",
+    "src/jam/jam_axi_shared.c", "src/jam/jam_axi_stop.c",
+    "src/jam/jam_axi_terms.c", "src/jam/jam_axi_vel.c",
+    "src/jam/jam_axi_vel_batch.c", "src/jam/jam_axi_vel_check.c",
+    "src/jam/jam_axi_vel_cross.c", "src/jam/jam_axi_vel_eval.c",
+    "src/jam/jam_axi_vel_grad.c", "src/jam/jam_axi_vel_losgrad.c",
+    "src/jam/jam_axi_vel_losint.c", "src/jam/jam_axi_vel_mgegrad.c",
+    "src/jam/jam_axi_vel_mgeint.c", "src/jam/jam_axi_vel_mmt.c",
+    "src/jam/jam_axi_vel_wgrad.c", "src/jam/jam_axi_vel_wmmt.c",
+    "src/jam/jam_axi_ws.c"]
 mge = ["src/mge/mge_addbh.c", "src/mge/mge_dens.c", "src/mge/mge_deproject.c",
-    "src/mge/mge_qmed.c", "src/mge/mge_read.c", "src/mge/mge_surf.c"]
+    "src/mge/mge_fit1d.c", "src/mge/mge_halo.c", "src/mge/mge_merge.c",
+    "src/mge/mge_project.c", "src/mge/mge_qmed.c", "src/mge/mge_read.c",
+    "src/mge/mge_surf.c"]
+store = ["src/store/store_attach.c", "src/store/store_lock.c",
+    "src/store/store_write.c"]
 tools = ["src/tools/maximum.c", "src/tools/median.c", "src/tools/minimum.c",
-    "src/tools/range.c", "src/tools/readcol.c", "src/tools/sort_dbl.c",
-    "src/tools/where.c"]
-sources += interp + jam + mge + tools
+    "src/tools/nnls.c", "src/tools/range.c", "src/tools/readcol.c",
+    "src/tools/sort_dbl.c", "src/tools/where.c"]
+sources += cache + emu + interp + jam + mge + store + tools
 
-ext_modules = Extension("cjam._jam_axi", sources, libraries=["gsl","gslcblas"])
+ext_modules = Extension("cjam._jam_axi", sources, libraries=["gsl","gslcblas","pthread"])
 
 setup(name="cjam",
     ext_modules=cythonize([ext_modules]),
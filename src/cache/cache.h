@@ -0,0 +1,50 @@
+/* -----------------------------------------------------------------------------
+  CACHE PROGRAMS
+    
+    cache       : on-disk cache structure
+    cache_close : close an on-disk cache
+    cache_evict : measure an on-disk cache and remove old entries if too big
+    cache_get   : read an entry from an on-disk cache
+    cache_key   : content hash structure
+    cache_key_add  : add bytes to a content hash
+    cache_key_init : start a content hash
+    cache_open  : open (and create if needed) an on-disk cache
+    cache_put   : write an entry to an on-disk cache, evicting old entries
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+----------------------------------------------------------------------------- */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define CACHE_VERSION 2
+
+struct cache {
+    char *dir;
+    long maxbytes;
+    long total;
+    pthread_mutex_t lock;
+};
+
+struct cache_key {
+    unsigned long long h1, h2;
+};
+
+void cache_close( struct cache * );
+
+long cache_evict( struct cache * );
+
+int cache_get( struct cache *, struct cache_key *, double *, int );
+
+void cache_key_add( struct cache_key *, const void *, size_t );
+
+void cache_key_init( struct cache_key * );
+
+struct cache* cache_open( char *, long );
+
+void cache_put( struct cache *, struct cache_key *, double *, int );
+
+#endif
@@ -0,0 +1,105 @@
+/* ----------------------------------------------------------------------------
+  CACHE_EVICT
+    
+    Measures the total size of the entries in an on-disk cache and, if it
+    exceeds the size limit, removes the least recently used entries (by file
+    modification time) until it fits.  This reads the whole directory, so it
+    is only done when the cache is opened and when the running total kept by
+    cache_put passes the limit; the total is then reset to the size on disk,
+    which includes any entries written by other processes.  The caller holds
+    the lock of the cache.
+    
+    INPUTS
+      c   : cache from cache_open
+      
+    OUTPUTS
+      Total size of the entries left in the cache [bytes].
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+
+// cache file and its age, for eviction
+struct cache_file {
+    char name[40];
+    long size;
+    time_t mtime;
+};
+
+
+static int cache_file_older( const void *a, const void *b ) {
+    
+    const struct cache_file *fa = a, *fb = b;
+    
+    if ( fa->mtime < fb->mtime ) return -1;
+    if ( fa->mtime > fb->mtime ) return 1;
+    return 0;
+    
+}
+
+
+long cache_evict( struct cache *c ) {
+    
+    DIR *d;
+    struct dirent *ent;
+    struct stat st;
+    struct cache_file *files;
+    char *path;
+    int nfile, maxfile, i, len;
+    long total;
+    
+    // total size of cache files
+    d = opendir( c->dir );
+    if ( d == NULL ) return 0;
+    path = (char *) malloc( strlen( c->dir ) + 40 );
+    nfile = 0;
+    maxfile = 64;
+    files = (struct cache_file *) malloc( maxfile \
+        * sizeof( struct cache_file ) );
+    total = 0;
+    while ( ( ent = readdir( d ) ) != NULL ) {
+        len = strlen( ent->d_name );
+        if ( len != 36 || strcmp( ent->d_name + 32, ".jmc" ) != 0 ) continue;
+        sprintf( path, "%s/%s", c->dir, ent->d_name );
+        if ( stat( path, &st ) != 0 ) continue;
+        if ( nfile == maxfile ) {
+            maxfile *= 2;
+            files = (struct cache_file *) realloc( files, \
+                maxfile * sizeof( struct cache_file ) );
+        }
+        strcpy( files[nfile].name, ent->d_name );
+        files[nfile].size = st.st_size;
+        files[nfile].mtime = st.st_mtime;
+        total += st.st_size;
+        nfile++;
+    }
+    closedir( d );
+    
+    // remove least recently used files until the cache fits
+    if ( c->maxbytes > 0 && total > c->maxbytes ) {
+        qsort( files, nfile, sizeof( struct cache_file ), &cache_file_older );
+        for ( i = 0; i < nfile && total > c->maxbytes; i++ ) {
+            sprintf( path, "%s/%s", c->dir, files[i].name );
+            if ( remove( path ) == 0 ) total -= files[i].size;
+        }
+    }
+    
+    free( files );
+    free( path );
+    
+    return total;
+    
+}
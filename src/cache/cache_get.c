@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------------
+  CACHE_GET
+    
+    Reads an entry from an on-disk cache.  Returns 0 if an entry with the
+    given key and length was found, and 1 otherwise.  An entry whose values
+    do not match the checksum written with them is treated as missing.  A
+    successful read marks the entry as recently used.
+    
+    INPUTS
+      c   : cache from cache_open
+      key : content hash of the entry
+      val : array to hold the entry
+      n   : number of values in the entry
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+#include "cache.h"
+
+
+int cache_get( struct cache *c, struct cache_key *key, double *val, int n ) {
+    
+    FILE *fp;
+    char *path, magic[4];
+    int head[2], ok;
+    unsigned long long hash[2], check[2];
+    struct cache_key sum;
+    
+    path = (char *) malloc( strlen( c->dir ) + 40 );
+    sprintf( path, "%s/%016llx%016llx.jmc", c->dir, key->h1, key->h2 );
+    
+    fp = fopen( path, "rb" );
+    if ( fp == NULL ) {
+        free( path );
+        return 1;
+    }
+    
+    // check header, full key and length before reading values, and the
+    // values against their checksum
+    ok = fread( magic, 1, 4, fp ) == 4 && memcmp( magic, "JAMC", 4 ) == 0 \
+        && fread( head, sizeof( int ), 2, fp ) == 2 \
+        && head[0] == CACHE_VERSION && head[1] == n \
+        && fread( hash, sizeof( hash[0] ), 2, fp ) == 2 \
+        && hash[0] == key->h1 && hash[1] == key->h2 \
+        && fread( check, sizeof( check[0] ), 2, fp ) == 2 \
+        && fread( val, sizeof( double ), n, fp ) == (size_t) n;
+    fclose( fp );
+    if ( ok ) {
+        cache_key_init( &sum );
+        cache_key_add( &sum, val, n * sizeof( double ) );
+        ok = sum.h1 == check[0] && sum.h2 == check[1];
+    }
+    
+    // mark as recently used
+    if ( ok ) utime( path, NULL );
+    
+    free( path );
+    
+    return ok ? 0 : 1;
+    
+}
@@ -0,0 +1,46 @@
+/* ----------------------------------------------------------------------------
+  CACHE_KEY
+    
+    Content hash used to address entries in an on-disk cache.  Two
+    independent 64-bit hashes (FNV-1a and a multiply-xorshift hash) are
+    kept, giving a 128-bit key.
+    
+    INPUTS (cache_key_add)
+      key   : hash to update
+      data  : bytes to add to the hash
+      nbyte : number of bytes
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cache.h"
+
+
+void cache_key_init( struct cache_key *key ) {
+    
+    key->h1 = 0xcbf29ce484222325ULL;
+    key->h2 = 0x9e3779b97f4a7c15ULL;
+    
+}
+
+
+void cache_key_add( struct cache_key *key, const void *data, size_t nbyte ) {
+    
+    const unsigned char *b = data;
+    size_t i;
+    
+    for ( i = 0; i < nbyte; i++ ) {
+        key->h1 = ( key->h1 ^ b[i] ) * 0x100000001b3ULL;
+        key->h2 = ( key->h2 + b[i] ) * 0xbf58476d1ce4e5b9ULL;
+        key->h2 ^= key->h2 >> 29;
+    }
+    
+}
@@ -0,0 +1,61 @@
+/* ----------------------------------------------------------------------------
+  CACHE_OPEN
+    
+    Opens an on-disk cache in the given directory, creating the directory if
+    it does not exist.  Each entry is stored in its own file, named by its
+    content hash, so several processes can share one cache.  Returns NULL if
+    the directory cannot be used.  If there is a size limit, the size of the
+    entries already in the cache is measured (see cache_evict), and cache_put
+    keeps a running total from there, so that it reads the directory only
+    when the limit is passed.
+    
+    INPUTS
+      dir      : cache directory
+      maxbytes : largest total size of the cache files (0 for no limit)
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+
+struct cache* cache_open( char *dir, long maxbytes ) {
+    
+    struct cache *c;
+    struct stat st;
+    
+    // create directory if needed
+    if ( mkdir( dir, 0755 ) != 0 && errno != EEXIST ) return NULL;
+    if ( stat( dir, &st ) != 0 || !S_ISDIR( st.st_mode ) ) return NULL;
+    
+    c = (struct cache *) malloc( sizeof( struct cache ) );
+    c->dir = (char *) malloc( strlen( dir ) + 1 );
+    strcpy( c->dir, dir );
+    c->maxbytes = maxbytes;
+    pthread_mutex_init( &c->lock, NULL );
+    c->total = ( maxbytes > 0 ) ? cache_evict( c ) : 0;
+    
+    return c;
+    
+}
+
+
+void cache_close( struct cache *c ) {
+    
+    if ( c == NULL ) return;
+    pthread_mutex_destroy( &c->lock );
+    free( c->dir );
+    free( c );
+    
+}
@@ -0,0 +1,99 @@
+/* ----------------------------------------------------------------------------
+  CACHE_PUT
+    
+    Writes an entry to an on-disk cache.  The entry is written to a
+    temporary file and renamed into place, so readers in other processes
+    never see a partial entry; the temporary file is named after the
+    process and a counter shared by all threads, so that threads writing
+    the same entry at the same time do not write to the same file.  The
+    entry holds a checksum of its values, which cache_get checks to reject
+    an entry that has been damaged on disk.  The size of the entry is added
+    to the running total of the cache, and only if that exceeds the size
+    limit is the directory read and the least recently used entries removed
+    until it fits (see cache_evict).
+    
+    INPUTS
+      c   : cache from cache_open
+      key : content hash of the entry
+      val : values to store
+      n   : number of values
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cache.h"
+
+
+// number of temporary files opened by this process
+static pthread_mutex_t cache_put_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long cache_put_count = 0;
+
+
+void cache_put( struct cache *c, struct cache_key *key, double *val, int n ) {
+    
+    FILE *fp;
+    char *path, *tmp;
+    int head[2], ok;
+    unsigned long long hash[2], check[2];
+    unsigned long count;
+    struct cache_key sum;
+    
+    pthread_mutex_lock( &cache_put_lock );
+    count = cache_put_count++;
+    pthread_mutex_unlock( &cache_put_lock );
+    
+    path = (char *) malloc( strlen( c->dir ) + 40 );
+    tmp = (char *) malloc( strlen( c->dir ) + 80 );
+    sprintf( path, "%s/%016llx%016llx.jmc", c->dir, key->h1, key->h2 );
+    sprintf( tmp, "%s/.%016llx%016llx.%ld.%lu", c->dir, key->h1, key->h2, \
+        (long) getpid(), count );
+        
+    // checksum of the values
+    cache_key_init( &sum );
+    cache_key_add( &sum, val, n * sizeof( double ) );
+    check[0] = sum.h1;
+    check[1] = sum.h2;
+    
+    // write entry to a temporary file then move it into place
+    fp = fopen( tmp, "wb" );
+    if ( fp == NULL ) {
+        free( path );
+        free( tmp );
+        return;
+    }
+    head[0] = CACHE_VERSION;
+    head[1] = n;
+    hash[0] = key->h1;
+    hash[1] = key->h2;
+    ok = fwrite( "JAMC", 1, 4, fp ) == 4 \
+        && fwrite( head, sizeof( int ), 2, fp ) == 2 \
+        && fwrite( hash, sizeof( hash[0] ), 2, fp ) == 2 \
+        && fwrite( check, sizeof( check[0] ), 2, fp ) == 2 \
+        && fwrite( val, sizeof( double ), n, fp ) == (size_t) n;
+    if ( !ok ) fclose( fp );
+    else ok = fclose( fp ) == 0 && rename( tmp, path ) == 0;
+    if ( !ok ) remove( tmp );
+    free( tmp );
+    free( path );
+    
+    if ( !ok || c->maxbytes <= 0 ) return;
+    
+    // add the entry to the running total (a replaced entry is counted
+    // twice, which only brings the next look at the directory forward)
+    pthread_mutex_lock( &c->lock );
+    c->total += 4 + 2 * sizeof( int ) + 4 * sizeof( hash[0] ) \
+        + n * sizeof( double );
+    if ( c->total > c->maxbytes ) c->total = cache_evict( c );
+    pthread_mutex_unlock( &c->lock );
+    
+}
@@ -1,6 +1,6 @@
 /* ----------------------------------------------------------------------------
   CJAM
-  
+    
     For a given input model, the program reads in data-file locations and then
     calculates the moments of the model.  The moments are saved to specified
     file.
@@ -20,7 +20,31 @@
       fxy     : path to star positions file
       fmom    : path to output moments file
       verbose : print progress, if set
-  
+      
+    ENVIRONMENT
+      CJAM_CACHE    : directory for an on-disk cache of moment maps, so that
+                      reruns of the same model are read back from disk
+      CJAM_CACHE_MB : size limit of the cache [MB] (default 1024, 0 for none)
+      CJAM_TOL      : relative tolerance for an adaptive interpolation grid,
+                      which starts coarse and is refined until the moments
+                      interpolated from it meet the tolerance
+      CJAM_SPECTRAL : if set, use a spectral expansion on 20 x 5 nodes in
+                      place of the interpolation grid
+      CJAM_HYBRID   : if set, calculate stars at extreme radii directly and
+                      interpolate the rest from a grid that covers only them,
+                      when that is cheaper
+      CJAM_CALIBRATE: if set, time the integrals and interpolation on this
+                      machine before choosing how to calculate the moments
+      CJAM_SENTINEL : number of stars at which to check the interpolated
+                      moments against direct calculation (reported if
+                      verbose is set)
+      CJAM_MERGE    : relative distance within which stars whose moments
+                      are calculated directly share one calculation
+      CJAM_NTHREAD  : number of threads for the integrals (default 1,
+                      negative to use all available processors)
+      CJAM_TIMEOUT  : time limit for the moments [s], after which the model
+                      is abandoned and no moments are written
+      
   Laura L Watkins [lauralwatkins@gmail.com]
   
   This code is released under a BSD 2-clause license.
@@ -41,6 +65,22 @@
 #include "tools/tools.h"
 
 
+// report and reset the interpolation errors at the accuracy sentinels
+static void cjam_sentinel( struct jam_opts *opts, char **name, int i0,
+    int n, int verbose ) {
+    
+    int i;
+    
+    if ( !opts->nsentinel ) return;
+    for ( i = i0; i < n; i++ ) {
+        if ( verbose ) printf( "Sentinels (%s): max error %g, rms error %g\n",
+            name[i], opts->sentmax[i], opts->sentrms[i] );
+        opts->sentmax[i] = opts->sentrms[i] = 0.;
+    }
+    
+}
+
+
 void cjam( double *beta, double *kappa, double *ml, double incl, double dist,
     double mbh, double rbh, int nlg, int nmg, char *flmge, char *fmmge,
     char *fxy, char *fmom, int verbose ) {
@@ -48,10 +88,17 @@ void cjam( double *beta, double *kappa, double *ml, double incl, double dist,
     FILE *fp;
     struct multigaussexp lum, pot;
     char flags[60];
-    int nrad, nang, i, j, k, filelen, nxy, check;
+    int nrad, nang, i, j, k, filelen, nxy, check, integrationFlag;
     double rad2arcsec, arcsec2pc, *xp, *yp;
     struct jam_vel vm;
     double *rxxm, *ryym, *rzzm, *rxym, *rxzm, *ryzm;
+    struct jam_opts opts = { NULL };
+    struct jam_cost cost;
+    struct jam_graph graph = { NULL };
+    char *env;
+    long cachemb;
+    int *path, npath;
+    enum jam_status status;
     
     
     
@@ -94,54 +141,131 @@ void cjam( double *beta, double *kappa, double *ml, double incl, double dist,
     
     
     
-    // properties of interpolation grid
+    // properties of interpolation grid (starting grid if adaptive)
     nrad = 30;
     nang = 7;
+    env = getenv( "CJAM_TOL" );
+    if ( env != NULL && env[0] != '\0' ) {
+        opts.tol = atof( env );
+        nrad = 10;
+        nang = 4;
+    }
+    env = getenv( "CJAM_SPECTRAL" );
+    if ( env != NULL && env[0] != '\0' ) {
+        opts.spectral = 1;
+        nrad = 20;
+        nang = 5;
+    }
+    
+    // choice between direct calculation, interpolation and a hybrid
+    env = getenv( "CJAM_HYBRID" );
+    if ( env != NULL && env[0] != '\0' ) opts.hybrid = 1;
+    env = getenv( "CJAM_CALIBRATE" );
+    if ( env != NULL && env[0] != '\0' ) {
+        jam_axi_cost_calibrate( &cost );
+        opts.cost = &cost;
+        if ( verbose ) printf( "Cost per position: rms %g s, vel %g s, "
+            "interpolation %g s\n", cost.rms, cost.vel, cost.interp );
+    }
+    
+    // threads for the integrals
+    env = getenv( "CJAM_NTHREAD" );
+    if ( env != NULL && env[0] != '\0' ) opts.nthread = atoi( env );
+    
+    // merging of nearby stars that are calculated directly
+    env = getenv( "CJAM_MERGE" );
+    if ( env != NULL && env[0] != '\0' ) opts.merge = atof( env );
+    
+    // accuracy sentinels
+    env = getenv( "CJAM_SENTINEL" );
+    if ( env != NULL && env[0] != '\0' ) opts.nsentinel = atoi( env );
+    
+    // time limit
+    env = getenv( "CJAM_TIMEOUT" );
+    if ( env != NULL && env[0] != '\0' ) opts.timeout = atof( env );
+    
+    // on-disk cache of moment maps
+    env = getenv( "CJAM_CACHE_MB" );
+    cachemb = ( env == NULL ) ? 1024 : atol( env );
+    env = getenv( "CJAM_CACHE" );
+    if ( env != NULL && env[0] != '\0' ) {
+        opts.cache = cache_open( env, cachemb << 20 );
+        if ( opts.cache == NULL ) printf( "Cannot use cache directory %s\n",
+            env );
+        else if ( verbose ) printf( "Using cache directory %s\n", env );
+    }
+    integrationFlag = 0;
     
     // check for at least 1 rotating, non-spherical, non-isotropic component
     check = 0;
     for ( k = 0; k < lum.ntotal; k++ ) for ( j = 0; j < pot.ntotal; j++ ) 
         if ( ( kappa[k] != 0. ) & ( ( beta[k] != 0. ) | ( lum.q[k] != 1. ) 
             | ( pot.q[j] != 1. ) ) ) check++;
-    
+            
+    // allocate moments
     if ( check > 0 ) {
-        // calculate first moments
-        if ( verbose ) printf( "Calculating first moments.\n" );
-        vm = jam_axi_vel_mmt( xp, yp, nxy, incl, &lum, &pot, beta, kappa, nrad,
-            nang );
-    } else {
-        if ( verbose ) printf( "Not calculating first moments -- model does "
-            "not contain a rotating, non-spherical, non-isotropic "
-            "component.\n" );
+        vm.vx = (double *) malloc( nxy * sizeof( double ) );
+        vm.vy = (double *) malloc( nxy * sizeof( double ) );
+        vm.vz = (double *) malloc( nxy * sizeof( double ) );
     }
+    rxxm = (double *) malloc( nxy * sizeof( double ) );
+    ryym = (double *) malloc( nxy * sizeof( double ) );
+    rzzm = (double *) malloc( nxy * sizeof( double ) );
+    rxym = (double *) malloc( nxy * sizeof( double ) );
+    rxzm = (double *) malloc( nxy * sizeof( double ) );
+    ryzm = (double *) malloc( nxy * sizeof( double ) );
     
-    // calculate second moments
-    if ( verbose ) printf( "Calculating second moments.\n" );
-    rxxm = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 1 );
-    ryym = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 2 );
-    rzzm = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 3 );
-    rxym = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 4 );
-    rxzm = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 5 );
-    ryzm = jam_axi_rms_mmt( xp, yp, nxy, incl, &lum, &pot, beta,
-        nrad, nang, 6 );
-    
-    
-    
-    // output model moments to file
-    if ( verbose ) printf( "Writing moments to file %s\n\n", fmom );
-    fp = fopen( fmom, "w" );
-    for ( i = 0; i < nxy; i++ ) {
-        if ( check == 0 ) fprintf( fp, "%lf  %lf  %lf  ", 0., 0., 0. );
-        else fprintf( fp, "%lf  %lf  %lf  ", vm.vx[i], vm.vy[i], vm.vz[i] );
-        fprintf( fp, "%lf  %lf  %lf  ", rxxm[i], ryym[i], rzzm[i] );
-        fprintf( fp, "%lf  %lf  %lf\n", rxym[i], rxzm[i], ryzm[i] );
+    // calculate first and second moments, with the independent stages run
+    // at the same time
+    if ( verbose ) {
+        if ( check > 0 ) printf( "Calculating first and second moments.\n" );
+        else printf( "Not calculating first moments -- model does not "
+            "contain a rotating, non-spherical, non-isotropic "
+            "component.\nCalculating second moments.\n" );
+    }
+    status = jam_axi_mmt( xp, yp, nxy, incl, &lum, &pot, beta, kappa, nrad,
+        nang, &integrationFlag, check > 0 ? &vm : NULL,
+        (double *[]) { rxxm, ryym, rzzm, rxym, rxzm, ryzm }, &graph, &opts );
+    cjam_sentinel( &opts, (char *[]) { "vx", "vy", "vz", "xx", "yy", "zz",
+        "xy", "xz", "yz" }, check > 0 ? 0 : 3, 9, verbose );
+    if ( verbose && ( opts.tol > 0. || opts.spectral ) ) printf( "Grid: up "
+        "to %i nodes, error estimate %g\n", opts.npol, opts.err );
+        
+    // critical path of the calculation
+    if ( verbose ) {
+        path = (int *) malloc( graph.ntask * sizeof( int ) );
+        printf( "Wall time %g s, critical path %g s:\n", graph.wall,
+            jam_axi_graph_path( &graph, path, &npath ) );
+        for ( i = 0; i < npath; i++ ) printf( "  %-16s %g s\n",
+            graph.task[path[i]].name, graph.task[path[i]].t1
+            - graph.task[path[i]].t0 );
+        free( path );
+    }
+    jam_axi_graph_free( &graph );
+    
+    
+    
+    // output model moments to file, unless the model was rejected
+    if ( status == JAM_ERR_INCL ) printf( "Inclination too low to deproject "
+        "the MGEs -- no moments written.\n" );
+    else if ( status == JAM_ERR_FLAT ) printf( "Deprojected MGE component "
+        "flatter than q=0.05 -- no moments written.\n" );
+    else if ( status == JAM_ERR_INPUT ) printf( "Anisotropy must be less "
+        "than 1 -- no moments written.\n" );
+    else if ( status == JAM_ERR_BUDGET ) printf( "Time limit exceeded -- no "
+        "moments written.\n" );
+    else {
+        if ( verbose ) printf( "Writing moments to file %s\n\n", fmom );
+        fp = fopen( fmom, "w" );
+        for ( i = 0; i < nxy; i++ ) {
+            if ( check == 0 ) fprintf( fp, "%lf  %lf  %lf  ", 0., 0., 0. );
+            else fprintf( fp, "%lf  %lf  %lf  ", vm.vx[i], vm.vy[i],
+                vm.vz[i] );
+            fprintf( fp, "%lf  %lf  %lf  ", rxxm[i], ryym[i], rzzm[i] );
+            fprintf( fp, "%lf  %lf  %lf\n", rxym[i], rxzm[i], ryzm[i] );
+        }
+        fclose( fp );
     }
-    fclose( fp );
     
     
     
@@ -165,5 +289,6 @@ void cjam( double *beta, double *kappa, double *ml, double incl, double dist,
     free( rxym );
     free( rxzm );
     free( ryzm );
+    cache_close( opts.cache );
     
 }
@@ -18,6 +18,9 @@
       (kappa) : rotation parameter (for each of the nlg components)
       (ml)    : mass-to-light ratio (for each of the nmg components)
       verbose : print progress, if set
+      
+    The optional environment variables read by cjam (CJAM_CACHE, etc) are
+    listed in the usage message printed when no arguments are given.
   
   Laura L Watkins [lauralwatkins@gmail.com]
   
@@ -65,7 +68,22 @@ int main( int argc, char *argv[] ) {
             "\nNote that beta and kappa are required for each\ncomponent of "
             "the luminous MGE, and ml is required for\neach component of the "
             "potential MGE.  In total there\nshould be (10 + 2*nlg + nmg) "
-            "arguments provided.\n\n" );
+            "arguments provided.\n"
+            "\nOptional environment variables:\n"
+            "  CJAM_CACHE     : directory for an on-disk cache of moment maps\n"
+            "  CJAM_CACHE_MB  : size limit of the cache [MB] (default 1024)\n"
+            "  CJAM_TOL       : tolerance for an adaptive interpolation grid\n"
+            "  CJAM_SPECTRAL  : if set, use a spectral expansion for the grid\n"
+            "  CJAM_HYBRID    : if set, calculate stars at extreme radii "
+            "directly\n"
+            "  CJAM_CALIBRATE : if set, time the integrals on this machine\n"
+            "  CJAM_SENTINEL  : number of stars at which to check the "
+            "interpolation\n"
+            "  CJAM_MERGE     : distance within which stars share one "
+            "calculation\n"
+            "  CJAM_NTHREAD   : number of threads (negative for all "
+            "processors)\n"
+            "  CJAM_TIMEOUT   : time limit for the moments [s]\n\n" );
         return 0;
     }
     
@@ -0,0 +1,27 @@
+/* -----------------------------------------------------------------------------
+  EMU PROGRAMS
+    
+    emu_eval  : evaluate an emulator at a point in parameter space
+    emu_free  : free the memory held by an emulator
+    emu_train : train a Chebyshev emulator over a box in parameter space
+    emulator  : emulator structure
+  
+  Laura L Watkins [lauralwatkins@gmail.com]
+----------------------------------------------------------------------------- */
+
+#ifndef EMU_H
+#define EMU_H
+
+struct emulator {
+    int ndim, nout, nterm, *nord;
+    double *lo, *hi, *coef, *tail;
+};
+
+int emu_eval( struct emulator *, double *, double * );
+
+void emu_free( struct emulator * );
+
+void emu_train( struct emulator *, int, double *, double *, int *, int, \
+    void (*)( double *, void *, double * ), void * );
+
+#endif
@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------------------
+  EMU_EVAL
+    
+    Evaluates a trained Chebyshev emulator at a point in parameter space.
+    Returns 0 if the point lies inside the trained box and 1 otherwise, in
+    which case the output is not set and the caller should fall back to the
+    exact function.
+    
+    INPUTS
+      emu : trained emulator
+      par : parameters at which to evaluate the emulator
+      out : array of nout values to hold the emulated function
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "emu.h"
+
+
+int emu_eval( struct emulator *emu, double *par, double *out ) {
+    
+    int d, m, t, o, idx, nmax;
+    double x, w, *cheb;
+    
+    // reject points outside the trained box
+    for ( d = 0; d < emu->ndim; d++ ) \
+        if ( par[d] < emu->lo[d] || par[d] > emu->hi[d] ) return 1;
+    
+    // Chebyshev polynomials of each parameter from the usual recurrence
+    nmax = 0;
+    for ( d = 0; d < emu->ndim; d++ ) \
+        if ( emu->nord[d] > nmax ) nmax = emu->nord[d];
+    cheb = (double *) malloc( emu->ndim * nmax * sizeof( double ) );
+    for ( d = 0; d < emu->ndim; d++ ) {
+        x = ( 2. * par[d] - emu->lo[d] - emu->hi[d] ) \
+            / ( emu->hi[d] - emu->lo[d] );
+        cheb[d*nmax] = 1.;
+        if ( emu->nord[d] > 1 ) cheb[d*nmax+1] = x;
+        for ( m = 2; m < emu->nord[d]; m++ ) cheb[d*nmax+m] = \
+            2. * x * cheb[d*nmax+m-1] - cheb[d*nmax+m-2];
+    }
+    
+    // sum over tensor-product terms
+    for ( o = 0; o < emu->nout; o++ ) out[o] = 0.;
+    for ( t = 0; t < emu->nterm; t++ ) {
+        idx = t;
+        w = 1.;
+        for ( d = emu->ndim - 1; d >= 0; d-- ) {
+            w *= cheb[d*nmax+idx%emu->nord[d]];
+            idx /= emu->nord[d];
+        }
+        for ( o = 0; o < emu->nout; o++ ) \
+            out[o] += w * emu->coef[t*emu->nout+o];
+    }
+    
+    free( cheb );
+    
+    return 0;
+    
+}
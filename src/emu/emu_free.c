@@ -0,0 +1,30 @@
+/* ----------------------------------------------------------------------------
+  EMU_FREE
+    
+    Frees the memory held by a trained emulator.
+    
+    INPUTS
+      emu : trained emulator
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include "emu.h"
+
+
+void emu_free( struct emulator *emu ) {
+    
+    free( emu->lo );
+    free( emu->hi );
+    free( emu->nord );
+    free( emu->coef );
+    free( emu->tail );
+    
+}
@@ -0,0 +1,138 @@
+/* ----------------------------------------------------------------------------
+  EMU_TRAIN
+    
+    Trains a tensor-product Chebyshev emulator of a vector-valued function
+    over a box in parameter space.  The function is evaluated once at each
+    node of a tensor grid of Chebyshev points (of the first kind) and the
+    Chebyshev coefficients are found by a discrete cosine transform along
+    each dimension in turn.  The sum of the absolute coefficients of the
+    highest order in any dimension is kept for each output as an estimate of
+    the truncation error.
+    
+    INPUTS
+      emu    : emulator structure to fill
+      ndim   : number of parameters
+      lo     : lower limits of the parameter box
+      hi     : upper limits of the parameter box
+      nord   : number of Chebyshev nodes (and coefficients) per parameter
+      nout   : number of outputs of the function
+      func   : function to emulate, called as func( par, params, out )
+      params : parameters passed through to the function
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "emu.h"
+
+
+void emu_train( struct emulator *emu, int ndim, double *lo, double *hi, \
+        int *nord, int nout, void (*func)( double *, void *, double * ), \
+        void *params ) {
+    
+    int d, k, m, n, t, o, idx, stride, nblock, b, c, last;
+    double *par, *buf;
+    
+    // copy box and orders
+    emu->ndim = ndim;
+    emu->nout = nout;
+    emu->lo = (double *) malloc( ndim * sizeof( double ) );
+    emu->hi = (double *) malloc( ndim * sizeof( double ) );
+    emu->nord = (int *) malloc( ndim * sizeof( int ) );
+    emu->nterm = 1;
+    for ( d = 0; d < ndim; d++ ) {
+        emu->lo[d] = lo[d];
+        emu->hi[d] = hi[d];
+        emu->nord[d] = nord[d];
+        emu->nterm *= nord[d];
+    }
+    
+    emu->coef = (double *) malloc( emu->nterm * nout * sizeof( double ) );
+    emu->tail = (double *) malloc( nout * sizeof( double ) );
+    par = (double *) malloc( ndim * sizeof( double ) );
+    
+    
+    // ---------------------------------
+    
+    
+    // evaluate function on the tensor grid of Chebyshev nodes, with the
+    // first parameter varying slowest
+    for ( t = 0; t < emu->nterm; t++ ) {
+        idx = t;
+        for ( d = ndim - 1; d >= 0; d-- ) {
+            k = idx % nord[d];
+            idx /= nord[d];
+            par[d] = lo[d] + 0.5 * ( hi[d] - lo[d] ) \
+                * ( 1. + cos( M_PI * ( k + 0.5 ) / nord[d] ) );
+        }
+        func( par, params, &emu->coef[t*nout] );
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // discrete cosine transform along each dimension in turn
+    stride = emu->nterm;
+    for ( d = 0; d < ndim; d++ ) {
+        
+        n = nord[d];
+        stride /= n;
+        nblock = emu->nterm / ( n * stride );
+        buf = (double *) malloc( n * sizeof( double ) );
+        
+        for ( b = 0; b < nblock; b++ ) {
+            for ( c = 0; c < stride; c++ ) {
+                for ( o = 0; o < nout; o++ ) {
+                    
+                    for ( m = 0; m < n; m++ ) {
+                        buf[m] = 0.;
+                        for ( k = 0; k < n; k++ ) {
+                            idx = ( b * n + k ) * stride + c;
+                            buf[m] += emu->coef[idx*nout+o] \
+                                * cos( M_PI * m * ( k + 0.5 ) / n );
+                        }
+                        buf[m] *= ( m == 0 ? 1. : 2. ) / n;
+                    }
+                    
+                    for ( m = 0; m < n; m++ ) {
+                        idx = ( b * n + m ) * stride + c;
+                        emu->coef[idx*nout+o] = buf[m];
+                    }
+                    
+                }
+            }
+        }
+        
+        free( buf );
+        
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // truncation error estimate from the highest-order coefficients
+    for ( o = 0; o < nout; o++ ) emu->tail[o] = 0.;
+    for ( t = 0; t < emu->nterm; t++ ) {
+        idx = t;
+        last = 0;
+        for ( d = ndim - 1; d >= 0; d-- ) {
+            if ( idx % nord[d] == nord[d] - 1 ) last = 1;
+            idx /= nord[d];
+        }
+        if ( last ) for ( o = 0; o < nout; o++ ) \
+            emu->tail[o] += fabs( emu->coef[t*nout+o] );
+    }
+    
+    free( par );
+    
+}
@@ -1,8 +1,56 @@
 /* -----------------------------------------------------------------------------
   INTERP PROGRAMS
     
-    interp2dpol : interpolate over a 2-dimensional polar grid
+    interp2dpol       : interpolate over a 2-dimensional polar grid
+    interp2dquad      : bicubic patches on a symmetric polar quadrant
+    interp2dquad_eval : evaluate bicubic patches at given positions
+    interp2dquad_free : free bicubic patches
+    interp2dquad_init : precompute bicubic patches for a quadrant map
+    interp2dquad_work : size of the memory for bicubic patches
+    interp2dspec      : spectral expansion of a symmetric polar quadrant
+    interp2dspec_eval : evaluate spectral expansion at given positions
+    interp2dspec_free : free spectral expansion
+    interp2dspec_init : spectral expansion of a quadrant map on its nodes
+    interp2dspec_nodes : nodes for a spectral expansion
+    interp2dspec_tail : relative size of the last expansion coefficients
 ----------------------------------------------------------------------------- */
 
+#ifndef INTERP_H
+#define INTERP_H
+
+struct interp2dquad {
+    int n_rad, n_ang, s1, s2;
+    double *rad, *ang, lrad0, dlrad, dang, *coef, *work;
+};
+
+struct interp2dspec {
+    int n_rad, n_ang, s1, s2;
+    double lrmin, lrmax, *coef;
+};
+
 double* interp2dpol( double **, double *, double *, double *, \
     double *, int, int, int );
+
+void interp2dquad_eval( struct interp2dquad *, double *, double *, int, \
+    double * );
+
+void interp2dquad_free( struct interp2dquad * );
+
+void interp2dquad_init( struct interp2dquad *, double *, double *, double *, \
+    int, int, int, int, double * );
+
+long interp2dquad_work( int, int );
+
+void interp2dspec_eval( struct interp2dspec *, double *, double *, int, \
+    double * );
+
+void interp2dspec_free( struct interp2dspec * );
+
+void interp2dspec_init( struct interp2dspec *, double *, double, double, \
+    int, int, int, int );
+
+void interp2dspec_nodes( double, double, int, int, double *, double * );
+
+double interp2dspec_tail( struct interp2dspec * );
+
+#endif
@@ -2,6 +2,7 @@
   INTERP2DPOL
     
     Performs 2-dimensional cubic spline interpolation across a polar grid.
+    Returns NULL if memory cannot be allocated.
     
     INPUTS
       grid  : input polar grid
@@ -49,8 +50,11 @@ double *interp2dpol( double **grid, double *g_rad, double *g_ang, \
     interang = (double *) malloc( n_rad * sizeof( double ) );
     if ( ( result == NULL ) || ( accs == NULL) || ( splines == NULL) \
             || ( interang == NULL ) ) {
-        printf( "Malloc failed. Exiting...\n" );
-        exit(1);
+        free( result );
+        free( accs );
+        free( splines );
+        free( interang );
+        return NULL;
     }
     
     
@@ -0,0 +1,300 @@
+/* ----------------------------------------------------------------------------
+  INTERP2DQUAD
+    
+    Bicubic patch interpolation of a map given on one quadrant of a polar
+    grid, eccentric anomaly -pi to -pi/2, that has the symmetries of a
+    moment map: s1 is the sign picked up on reflection about the minor axis
+    and s2 the sign picked up on rotation by pi (see jam_axi_interp).
+    
+    The interpolant is the tensor product of a natural cubic spline in
+    radius and a cubic spline in angle, as in interp2dpol, but the angular
+    spline is solved on the quadrant alone, with the end conditions implied
+    by the symmetry (zero slope where the map is even, zero value and
+    curvature where it is odd), and queries are folded into the quadrant.
+    Because both splines are linear in the data, the interpolant on each
+    grid cell is a fixed combination of 16 coefficients, which
+    interp2dquad_init precomputes once per map.  interp2dquad_eval then
+    finds the cell of each query directly (the grid is uniform in angle and
+    logarithmic in radius) and evaluates its patch, so the cost per query
+    does not depend on the size of the grid.  Grids that have been refined
+    unevenly (see jam_axi_adapt) are also accepted; the cell is then found
+    by stepping from the uniform estimate.  The queries are taken in blocks
+    of INTERP2DQUAD_BLOCK: the cells, signs and weights of a block are found
+    first and kept in arrays on the stack, one per quantity, and the patches
+    are then contracted in a loop with no branches, which the compiler can
+    vectorise.
+    
+    The patches and the scratch used to make them take interp2dquad_work
+    doubles, which the caller can provide in work so that a map can be
+    interpolated without allocating any memory (they are then left in work
+    and interp2dquad_free does nothing); otherwise they are allocated.
+    
+    INPUTS (interp2dquad_init)
+      ip    : patch structure to fill
+      quad  : map on the quadrant grid points [n_rad*n_ang]
+      g_rad : radial coordinates of the grid (logarithmically spaced)
+      g_ang : angular coordinates of the grid (-pi to -pi/2)
+      n_rad : number of radial grid points
+      n_ang : number of angular grid points on the quadrant
+      s1    : sign on reflection about the minor axis
+      s2    : sign on rotation by pi
+      work  : array [interp2dquad_work(n_rad,n_ang)] to hold the patches
+              and scratch (or NULL to allocate them)
+      
+    INPUTS (interp2dquad_work)
+      n_rad : number of radial grid points
+      n_ang : number of angular grid points on the quadrant
+      
+    OUTPUTS (interp2dquad_work)
+      The number of doubles needed for the patches of one map.
+    
+    INPUTS (interp2dquad_eval)
+      ip     : patches from interp2dquad_init
+      i_rad  : radii for interpolation
+      i_ang  : eccentric anomalies for interpolation (-pi to pi)
+      n_int  : number of interpolation points
+      result : array to hold the n_int interpolated values
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "interp.h"
+
+// number of queries located together before their patches are contracted
+#define INTERP2DQUAD_BLOCK 64
+
+
+// second derivatives of a cubic spline through n points (stride apart in y
+// and m), with a natural (lo/hi=0) or zero-slope (lo/hi=1) end condition,
+// using 2n doubles of scratch in cd
+static void interp2dquad_spline( double *x, double *y, int n, int stride, \
+        int lo, int hi, double *m, double *cd ) {
+    
+    int i;
+    double *c = cd, *d = &cd[n], h0, h1, w;
+    
+    // first row
+    h1 = x[1] - x[0];
+    if ( lo ) {
+        c[0] = 0.5;
+        d[0] = 3. / h1 * ( y[stride] - y[0] ) / h1;
+    } else {
+        c[0] = 0.;
+        d[0] = 0.;
+    }
+    
+    // interior rows, eliminating forwards
+    for ( i = 1; i < n - 1; i++ ) {
+        h0 = x[i] - x[i-1];
+        h1 = x[i+1] - x[i];
+        w = 2. * ( h0 + h1 ) - h0 * c[i-1];
+        c[i] = h1 / w;
+        d[i] = ( 6. * ( ( y[(i+1)*stride] - y[i*stride] ) / h1 \
+            - ( y[i*stride] - y[(i-1)*stride] ) / h0 ) - h0 * d[i-1] ) / w;
+    }
+    
+    // last row
+    h0 = x[n-1] - x[n-2];
+    if ( hi ) {
+        w = 2. * h0 - h0 * c[n-2];
+        d[n-1] = ( -6. * ( y[(n-1)*stride] - y[(n-2)*stride] ) / h0 \
+            - h0 * d[n-2] ) / w;
+    } else {
+        d[n-1] = 0.;
+    }
+    
+    // back substitution
+    m[(n-1)*stride] = d[n-1];
+    for ( i = n - 2; i >= 0; i-- ) m[i*stride] = d[i] - c[i] * m[(i+1)*stride];
+    
+}
+
+
+// cubic in t = angle - left node, from node values and second derivatives
+static void interp2dquad_cubic( double y0, double y1, double m0, double m1, \
+        double h, double *a ) {
+    
+    a[0] = y0;
+    a[1] = ( y1 - y0 ) / h - h * ( 2. * m0 + m1 ) / 6.;
+    a[2] = 0.5 * m0;
+    a[3] = ( m1 - m0 ) / ( 6. * h );
+    
+}
+
+
+long interp2dquad_work( int n_rad, int n_ang ) {
+    
+    // nodes, patches, values and second derivatives, and spline scratch
+    return n_rad + n_ang + 16L * ( n_rad - 1 ) * ( n_ang - 1 ) \
+        + 4L * n_rad * n_ang + 2 * ( n_rad > n_ang ? n_rad : n_ang );
+        
+}
+
+
+void interp2dquad_init( struct interp2dquad *ip, double *quad, \
+        double *g_rad, double *g_ang, int n_rad, int n_ang, int s1, int s2, \
+        double *work ) {
+    
+    int i, j, k, a, n = n_rad * n_ang;
+    double *v, *ma, *mr, *mra, *cd, h, hr, *p;
+    
+    // the patches and scratch, in the caller's memory or in their own
+    ip->work = NULL;
+    if ( work == NULL ) work = ip->work = (double *) malloc( \
+        interp2dquad_work( n_rad, n_ang ) * sizeof( double ) );
+    ip->rad = work;
+    ip->ang = &ip->rad[n_rad];
+    ip->coef = &ip->ang[n_ang];
+    v = &ip->coef[16*(n_rad-1)*(n_ang-1)];
+    ma = &v[n];
+    mr = &ma[n];
+    mra = &mr[n];
+    cd = &mra[n];
+    
+    ip->n_rad = n_rad;
+    ip->n_ang = n_ang;
+    ip->s1 = s1;
+    ip->s2 = s2;
+    ip->dang = 0.5 * M_PI / ( n_ang - 1 );
+    for ( i = 0; i < n_rad; i++ ) ip->rad[i] = g_rad[i];
+    for ( j = 0; j < n_ang; j++ ) ip->ang[j] = g_ang[j];
+    ip->lrad0 = log( g_rad[0] );
+    ip->dlrad = ( log( g_rad[n_rad-1] ) - ip->lrad0 ) / ( n_rad - 1 );
+    
+    // map values, zero on the axes where the map is odd
+    for ( k = 0; k < n; k++ ) v[k] = quad[k];
+    for ( i = 0; i < n_rad; i++ ) {
+        if ( s1 * s2 < 0 ) v[i*n_ang] = 0.;
+        if ( s1 < 0 ) v[i*n_ang+n_ang-1] = 0.;
+    }
+    
+    // angular second derivatives along each radius: the major axis (-pi) is
+    // even if s1*s2 = 1 and the minor axis (-pi/2) is even if s1 = 1
+    for ( i = 0; i < n_rad; i++ ) interp2dquad_spline( ip->ang, &v[i*n_ang], \
+        n_ang, 1, s1 * s2 > 0, s1 > 0, &ma[i*n_ang], cd );
+    
+    // radial second derivatives of the values and of the angular second
+    // derivatives (natural spline, as in interp2dpol)
+    for ( j = 0; j < n_ang; j++ ) {
+        interp2dquad_spline( g_rad, &v[j], n_rad, n_ang, 0, 0, &mr[j], cd );
+        interp2dquad_spline( g_rad, &ma[j], n_rad, n_ang, 0, 0, &mra[j], \
+            cd );
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // patch coefficients: for cell (i,j) the four radial terms (value at
+    // i, value at i+1, scaled curvature at i and i+1) each have an angular
+    // cubic with four coefficients
+    for ( i = 0; i < n_rad - 1; i++ ) {
+        hr = ( g_rad[i+1] - g_rad[i] ) * ( g_rad[i+1] - g_rad[i] ) / 6.;
+        for ( j = 0; j < n_ang - 1; j++ ) {
+            h = ip->ang[j+1] - ip->ang[j];
+            p = &ip->coef[16*(i*(n_ang-1)+j)];
+            k = i * n_ang + j;
+            interp2dquad_cubic( v[k], v[k+1], ma[k], ma[k+1], h, &p[0] );
+            k += n_ang;
+            interp2dquad_cubic( v[k], v[k+1], ma[k], ma[k+1], h, &p[4] );
+            k -= n_ang;
+            interp2dquad_cubic( mr[k], mr[k+1], mra[k], mra[k+1], h, &p[8] );
+            k += n_ang;
+            interp2dquad_cubic( mr[k], mr[k+1], mra[k], mra[k+1], h, \
+                &p[12] );
+            for ( a = 8; a < 16; a++ ) p[a] *= hr;
+        }
+    }
+    
+}
+
+
+void interp2dquad_eval( struct interp2dquad *ip, double *i_rad, \
+        double *i_ang, int n_int, double *result ) {
+    
+    int m, nb, n, i, j, a, nr = ip->n_rad, na = ip->n_ang;
+    int cell[INTERP2DQUAD_BLOCK];
+    double e, r, t, A, B, *p, sum;
+    double sign[INTERP2DQUAD_BLOCK], w[4][INTERP2DQUAD_BLOCK];
+    double tp[4][INTERP2DQUAD_BLOCK];
+    
+    for ( m = 0; m < n_int; m += INTERP2DQUAD_BLOCK ) {
+        
+        nb = ( n_int - m < INTERP2DQUAD_BLOCK ) ? n_int - m : \
+            INTERP2DQUAD_BLOCK;
+            
+        // locate the cell of each query in the block, with its weights
+        for ( n = 0; n < nb; n++ ) {
+            
+            // fold eccentric anomaly into the quadrant
+            e = i_ang[m+n];
+            sign[n] = 1.;
+            if ( e > 0. ) {
+                e -= M_PI;
+                sign[n] *= ip->s2;
+            }
+            if ( e > -0.5 * M_PI ) {
+                e = -M_PI - e;
+                sign[n] *= ip->s1;
+            }
+            
+            // angular cell (estimate for a uniform grid, then corrected)
+            j = (int) ( ( e + M_PI ) / ip->dang );
+            if ( j < 0 ) j = 0;
+            if ( j > na - 2 ) j = na - 2;
+            while ( j > 0 && e < ip->ang[j] ) j--;
+            while ( j < na - 2 && e > ip->ang[j+1] ) j++;
+            t = e - ip->ang[j];
+            
+            // radial cell (logarithmic grid, corrected for rounding)
+            r = i_rad[m+n];
+            i = ( r > 0. ) ? (int) ( ( log( r ) - ip->lrad0 ) / ip->dlrad ) \
+                : 0;
+            if ( i < 0 ) i = 0;
+            if ( i > nr - 2 ) i = nr - 2;
+            while ( i > 0 && r < ip->rad[i] ) i--;
+            while ( i < nr - 2 && r > ip->rad[i+1] ) i++;
+            cell[n] = 16 * ( i * ( na - 1 ) + j );
+            
+            // radial weights of the natural spline, and powers of t
+            A = ( ip->rad[i+1] - r ) / ( ip->rad[i+1] - ip->rad[i] );
+            B = 1. - A;
+            w[0][n] = A;
+            w[1][n] = B;
+            w[2][n] = A * A * A - A;
+            w[3][n] = B * B * B - B;
+            tp[0][n] = 1.;
+            tp[1][n] = t;
+            tp[2][n] = t * t;
+            tp[3][n] = t * t * t;
+            
+        }
+        
+        // contract the 4x4 patch of each query, with no branches
+        for ( n = 0; n < nb; n++ ) {
+            p = &ip->coef[cell[n]];
+            sum = 0.;
+            for ( a = 0; a < 16; a++ ) sum += w[a/4][n] * p[a] * tp[a%4][n];
+            result[m+n] = sign[n] * sum;
+        }
+        
+    }
+    
+}
+
+
+void interp2dquad_free( struct interp2dquad *ip ) {
+    
+    free( ip->work );
+    ip->work = NULL;
+    
+}
@@ -0,0 +1,217 @@
+/* ----------------------------------------------------------------------------
+  INTERP2DSPEC
+    
+    Spectral interpolation of a map given on one quadrant of a polar grid,
+    eccentric anomaly -pi to -pi/2, that has the symmetries of a moment map:
+    s1 is the sign picked up on reflection about the minor axis and s2 the
+    sign picked up on rotation by pi (see jam_axi_interp).
+    
+    The map is expanded in Chebyshev polynomials of log radius times the
+    Fourier modes of phi = eccentric anomaly + pi that have its symmetry:
+    cos(2k phi) for s1=s2=1, sin((2k+1) phi) for s1=1, s2=-1, cos((2k+1) phi)
+    for s1=s2=-1 and sin((2k+2) phi) for s1=-1, s2=1.  The map must be given
+    on the nodes from interp2dspec_nodes (Chebyshev points in log radius,
+    midpoints in angle), where the coefficients follow from discrete cosine
+    and sine transforms.  interp2dspec_eval sums the expansion with the
+    Clenshaw recurrence in both directions, and interp2dspec_tail returns
+    the size of the last coefficients in each direction, relative to the
+    largest, as a measure of convergence.
+    
+    INPUTS (interp2dspec_nodes)
+      lrmin : log of the smallest radius of the expansion
+      lrmax : log of the largest radius of the expansion
+      n_rad : number of radial nodes
+      n_ang : number of angular nodes on the quadrant
+      rad   : array to hold the n_rad node radii
+      ang   : array to hold the n_ang node eccentric anomalies
+      
+    INPUTS (interp2dspec_init)
+      ip    : expansion structure to fill
+      quad  : map on the nodes [n_rad*n_ang]
+      lrmin : log of the smallest radius of the expansion
+      lrmax : log of the largest radius of the expansion
+      n_rad : number of radial nodes
+      n_ang : number of angular nodes on the quadrant
+      s1    : sign on reflection about the minor axis
+      s2    : sign on rotation by pi
+      
+    INPUTS (interp2dspec_eval)
+      ip     : expansion from interp2dspec_init
+      i_rad  : radii for interpolation
+      i_ang  : eccentric anomalies for interpolation (-pi to pi)
+      n_int  : number of interpolation points
+      result : array to hold the n_int interpolated values
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "interp.h"
+
+
+// frequency of the first angular mode, and whether the modes are sines
+static int interp2dspec_mode( int s1, int s2, int *sine ) {
+    
+    *sine = s1 * s2 < 0;
+    if ( *sine ) return ( s1 > 0 ) ? 1 : 2;
+    else return ( s1 > 0 ) ? 0 : 1;
+    
+}
+
+
+void interp2dspec_nodes( double lrmin, double lrmax, int n_rad, int n_ang, \
+        double *rad, double *ang ) {
+        
+    int i, j;
+    
+    for ( i = 0; i < n_rad; i++ ) rad[i] = exp( 0.5 * ( lrmin + lrmax ) \
+        - 0.5 * ( lrmax - lrmin ) * cos( ( i + 0.5 ) * M_PI / n_rad ) );
+    for ( j = 0; j < n_ang; j++ ) \
+        ang[j] = -M_PI + ( j + 0.5 ) * 0.5 * M_PI / n_ang;
+        
+}
+
+
+void interp2dspec_init( struct interp2dspec *ip, double *quad, \
+        double lrmin, double lrmax, int n_rad, int n_ang, int s1, int s2 ) {
+        
+    int i, j, k, l, m0, sine;
+    double *b, phi, th, w;
+    
+    ip->n_rad = n_rad;
+    ip->n_ang = n_ang;
+    ip->s1 = s1;
+    ip->s2 = s2;
+    ip->lrmin = lrmin;
+    ip->lrmax = lrmax;
+    ip->coef = (double *) malloc( n_rad * n_ang * sizeof( double ) );
+    b = (double *) malloc( n_rad * n_ang * sizeof( double ) );
+    
+    // angular transform along each radius
+    m0 = interp2dspec_mode( s1, s2, &sine );
+    for ( i = 0; i < n_rad; i++ ) {
+        for ( l = 0; l < n_ang; l++ ) {
+            w = 2. / n_ang;
+            if ( !sine && m0 + 2 * l == 0 ) w = 1. / n_ang;
+            if ( sine && m0 + 2 * l == 2 * n_ang ) w = 1. / n_ang;
+            b[i*n_ang+l] = 0.;
+            for ( j = 0; j < n_ang; j++ ) {
+                phi = ( j + 0.5 ) * 0.5 * M_PI / n_ang;
+                b[i*n_ang+l] += quad[i*n_ang+j] * ( sine ? \
+                    sin( ( m0 + 2 * l ) * phi ) : cos( ( m0 + 2 * l ) * phi ) );
+            }
+            b[i*n_ang+l] *= w;
+        }
+    }
+    
+    // Chebyshev transform of each angular mode (the nodes run from -1 to 1)
+    for ( l = 0; l < n_ang; l++ ) {
+        for ( k = 0; k < n_rad; k++ ) {
+            w = ( k == 0 ) ? 1. / n_rad : 2. / n_rad;
+            ip->coef[l*n_rad+k] = 0.;
+            for ( i = 0; i < n_rad; i++ ) {
+                th = M_PI - ( i + 0.5 ) * M_PI / n_rad;
+                ip->coef[l*n_rad+k] += b[i*n_ang+l] * cos( k * th );
+            }
+            ip->coef[l*n_rad+k] *= w;
+        }
+    }
+    
+    free( b );
+    
+}
+
+
+void interp2dspec_eval( struct interp2dspec *ip, double *i_rad, \
+        double *i_ang, int n_int, double *result ) {
+        
+    int n, k, l, m0, sine, nr = ip->n_rad, na = ip->n_ang;
+    double e, x, sign, y0, y1, y2, *c, *b, a, f0, f1;
+    
+    m0 = interp2dspec_mode( ip->s1, ip->s2, &sine );
+    b = (double *) malloc( na * sizeof( double ) );
+    
+    for ( n = 0; n < n_int; n++ ) {
+        
+        // fold eccentric anomaly into the quadrant
+        e = i_ang[n];
+        sign = 1.;
+        if ( e > 0. ) {
+            e -= M_PI;
+            sign *= ip->s2;
+        }
+        if ( e > -0.5 * M_PI ) {
+            e = -M_PI - e;
+            sign *= ip->s1;
+        }
+        e += M_PI;
+        
+        // Chebyshev variable, held inside the expansion range
+        x = ( i_rad[n] > 0. ) ? ( 2. * log( i_rad[n] ) - ip->lrmin \
+            - ip->lrmax ) / ( ip->lrmax - ip->lrmin ) : -1.;
+        if ( x < -1. ) x = -1.;
+        if ( x > 1. ) x = 1.;
+        
+        // Clenshaw sum in radius for each angular mode
+        for ( l = 0; l < na; l++ ) {
+            c = &ip->coef[l*nr];
+            y1 = y2 = 0.;
+            for ( k = nr - 1; k >= 1; k-- ) {
+                y0 = c[k] + 2. * x * y1 - y2;
+                y2 = y1;
+                y1 = y0;
+            }
+            b[l] = c[0] + x * y1 - y2;
+        }
+        
+        // Clenshaw sum in angle: the modes step by 2 in frequency, so
+        // f(l+1) = 2 cos(2 phi) f(l) - f(l-1)
+        a = 2. * cos( 2. * e );
+        f0 = sine ? sin( m0 * e ) : cos( m0 * e );
+        f1 = sine ? sin( ( m0 + 2 ) * e ) : cos( ( m0 + 2 ) * e );
+        y1 = y2 = 0.;
+        for ( l = na - 1; l >= 1; l-- ) {
+            y0 = b[l] + a * y1 - y2;
+            y2 = y1;
+            y1 = y0;
+        }
+        result[n] = sign * ( f0 * ( b[0] - y2 ) + f1 * y1 );
+        
+    }
+    
+    free( b );
+    
+}
+
+
+double interp2dspec_tail( struct interp2dspec *ip ) {
+    
+    int k, l, nr = ip->n_rad, na = ip->n_ang;
+    double big = 0., tail = 0., c;
+    
+    for ( l = 0; l < na; l++ ) {
+        for ( k = 0; k < nr; k++ ) {
+            c = fabs( ip->coef[l*nr+k] );
+            if ( c > big ) big = c;
+            if ( ( k == nr - 1 || l == na - 1 ) && c > tail ) tail = c;
+        }
+    }
+    
+    return ( big > 0. ) ? tail / big : 0.;
+    
+}
+
+
+void interp2dspec_free( struct interp2dspec *ip ) {
+    
+    free( ip->coef );
+    
+}
@@ -1,22 +1,115 @@
 /* -----------------------------------------------------------------------------
   JAM PROGRAMS
     
+    jam_axi_adapt       : refine a polar grid to meet a tolerance
+    jam_axi_cache_key   : content hash of a moment calculation
+    jam_axi_cost_calibrate : benchmark for the evaluation cost model
+    jam_axi_emu_eval    : evaluate moment emulator
+    jam_axi_emu_free    : free moment emulator
+    jam_axi_emu_train   : train moment emulator over a parameter box
+    jam_axi_fold        : fold positions onto one quadrant and merge them
+    jam_axi_graph_add   : add a task to a task graph
+    jam_axi_graph_free  : free task graph
+    jam_axi_graph_path  : critical path of a task graph that has been run
+    jam_axi_graph_run   : run a task graph on threads
+    jam_axi_grid        : polar interpolation grid
+    jam_axi_gsl_init    : turn off the default GSL error handler, once
+    jam_axi_grid_nodes  : nodes of a polar grid over a given range
+    jam_axi_grid_spec   : polar grid of nodes for a spectral expansion
+    jam_axi_interp      : interpolate a quadrant moment map to positions
+    jam_axi_lumterms    : tracer terms for moment integrands
+    jam_axi_map_write   : write moment maps to a FITS image
+    jam_axi_mmt         : first and second moments as a task graph
+    jam_axi_plan        : choose direct, grid or hybrid evaluation
+    jam_axi_plan_free   : free evaluation plan
+    jam_axi_plan_grid   : choose direct or grid evaluation
+    jam_axi_pool_free   : finish the jobs of a thread pool and stop it
+    jam_axi_pool_poll   : check whether a job has finished
+    jam_axi_pool_start  : start a thread pool for model evaluations
+    jam_axi_pool_submit : queue a job on a thread pool
+    jam_axi_pool_wait   : wait for a job to finish
+    jam_axi_posstat     : gather integration status at input positions
+    jam_axi_quadvec     : vector integral over given subintervals
+    jam_axi_potterms    : potential terms for moment integrands
     jam_axi_rms         : wrapper for second moments
+    jam_axi_rms_batch   : second moments for a batch of models
+    jam_axi_rms_cross   : second moments for sets of tracers and potentials
+    jam_axi_rms_eval    : second moments from precomputed terms and grid
+    jam_axi_rms_grad    : second moments and parameter derivatives
+    jam_axi_rms_map     : second moment map on a pixel grid
+    jam_axi_rms_mgegrad : parameter derivatives of second moment integrand
     jam_axi_rms_mgeint  : integrand for second moments
     jam_axi_rms_mmt     : second moments
+    jam_axi_rms_prog    : progressively refined second moments
+    jam_axi_rms_quad    : second moments on the nodes of a grid
+    jam_axi_rms_wgrad   : weighted second moments and their derivatives
     jam_axi_rms_wmmt    : weighted second moments
+    jam_axi_sentinel_err : interpolation error at accuracy sentinels
+    jam_axi_sentinel_pick : choose accuracy sentinels
+    jam_axi_shared_attach : attach to tables shared between processes
+    jam_axi_shared_detach : detach from tables shared between processes
+    jam_axi_stop_end    : end the budget of a calculation
+    jam_axi_stop_poll   : check the budget of a calculation
+    jam_axi_stop_start  : start the budget of a calculation
+    jam_axi_stop_tick   : count an integrand evaluation against the budget
+    jam_axi_terms_check : check that a model can be deprojected
     jam_axi_vel         : wrapper for first moments
+    jam_axi_vel_check   : check for a rotating, non-spherical component
+    jam_axi_vel_batch   : first moments for a batch of models
+    jam_axi_vel_cross   : first moments for sets of tracers and potentials
+    jam_axi_vel_eval    : first moments from precomputed terms and grid
+    jam_axi_vel_grad    : first moments and parameter derivatives
+    jam_axi_vel_map     : first moment maps on a pixel grid
+    jam_axi_vel_losgrad : parameter derivatives of outer first moment integrand
     jam_axi_vel_losint  : outer integrand for first moments
+    jam_axi_vel_mgegrad : anisotropy derivative of inner first moment integrand
     jam_axi_vel_mgeint  : inner integrand for first moments
     jam_axi_vel_mmt     : first moments
+    jam_axi_vel_prog    : progressively refined first moments
+    jam_axi_vel_quad    : first moments on the nodes of a grid
+    jam_axi_vel_wgrad   : weighted first moments and their derivatives
     jam_axi_vel_wmmt    : weighted first moments
+    jam_axi_ws_buf      : scratch buffer from a workspace
+    jam_axi_ws_free     : free workspace
+    jam_axi_ws_put      : give back a scratch buffer
+    jam_axi_ws_quad     : quadrature workspaces of a thread
+    jam_axi_ws_quad_put : give back quadrature workspaces
+    jam_axi_ws_reserve  : make room in a workspace for threads
+    jam_axi_ws_split    : workspaces for calculations run side by side
+    jam_cost            : evaluation cost model structure
+    jam_emu             : moment emulator structure
+    jam_graph           : task graph structure
+    jam_grid            : polar interpolation grid structure
+    jam_image           : pixel grid structure for maps
+    jam_job             : model evaluation job structure for a thread pool
+    jam_lumterms        : tracer terms structure
+    jam_model           : model parameter structure for batches
+    jam_opts            : evaluation options structure
+    jam_plan            : evaluation plan structure
+    jam_pool            : thread pool structure for model evaluations
+    jam_potterms        : potential terms structure
+    jam_shared          : tables shared between processes structure
+    jam_stop            : cancellation and budget of a calculation
+    jam_status          : status codes returned by the programs
+    jam_task            : task graph node structure
     jam_vel             : velocity vector structure
+    jam_workspace       : reusable memory for the integrals
+    jam_ws_buf          : scratch buffers in a workspace
+    jam_wsquad          : quadrature workspaces for one thread
     params_losint       : parameter structure for first moment LOS integration
     params_mgeint       : parameter structure for first moment MGE integration
     params_rmsint       : parameter structure for second moment intergration
 ----------------------------------------------------------------------------- */
 
 
+#include <pthread.h>
+#include <gsl/gsl_integration.h>
+#include "../mge/mge.h"
+#include "../emu/emu.h"
+#include "../cache/cache.h"
+#include "../store/store.h"
+
+
 // definitions
 
 #define True 1
@@ -28,32 +121,250 @@
 #define RA2DEG 57.29578             // degrees per radian
 #define pc2km  3.0856776e+13        // (km per parsec)
 
+#define JAM_EMU_INCL 0              // emulated inclination
+#define JAM_EMU_BETA 1              // emulated anisotropy
+#define JAM_EMU_KAPPA 2             // emulated rotation
+#define JAM_EMU_ML 3                // emulated mass-to-light ratio
+
+#define JAM_CACHE_CODE 1            // moment code version for cache keys
+
+#define JAM_ADAPT_MAXRAD 256        // most radii in an adaptive grid
+#define JAM_ADAPT_MAXANG 64         // most angles in an adaptive grid
+
+#define JAM_COST_RMS 2.6e-6         // second moment integral per position [s]
+#define JAM_COST_VEL 1.7e-3         // first moment integral per position [s]
+#define JAM_COST_INTERP 7.e-8       // interpolation per position [s]
+#define JAM_HYBRID_FRAC 0.01        // fraction at each end that may be outliers
+
+#define JAM_MAP_TILE 64             // pixels on a side of a map tile
+
+#define JAM_SENTINEL_SEED 1         // seed for choosing accuracy sentinels
+
+#define JAM_THREAD_CHUNK 4          // positions taken at a time by a thread
+
+#define JAM_PROG_STEP 10.           // tolerance ratio of progressive steps
+
+#define JAM_GRAPH_MAXDEP 8          // most dependencies of a graph task
+
+#define JAM_STOP_POLL 1024          // integrand evaluations between checks
+
+#define JAM_RETRY_LIMIT 10000       // subintervals to retry a failed integral
+
+
+// ----------------------------------------------------------------------------
+
+
+// status codes
+
+enum jam_status {
+    JAM_OK = 0,                     // success
+    JAM_ERR_IO,                     // file or shared memory failure
+    JAM_ERR_INCL,                   // inclination too low for a component
+    JAM_ERR_FLAT,                   // component too flat when deprojected
+    JAM_ERR_INPUT,                  // invalid argument
+    JAM_ERR_INTEGRAL,               // integration failure
+    JAM_ERR_CANCEL,                 // cancelled by the caller
+    JAM_ERR_BUDGET                  // over the time or evaluation budget
+};
+
+
+// scratch buffers in a workspace
+
+enum jam_ws_buf {
+    JAM_WS_XF,                      // folded x'
+    JAM_WS_YF,                      // folded y'
+    JAM_WS_REP,                     // position each folded one came from
+    JAM_WS_MAP,                     // folded position of each position
+    JAM_WS_MU,                      // weighted moments at folded positions
+    JAM_WS_IZ0,                     // z^0 line-of-sight integrals
+    JAM_WS_IZ1,                     // z^1 line-of-sight integrals
+    JAM_WS_PFLAG,                   // integration status at folded positions
+    JAM_WS_PERR,                    // integration error at folded positions
+    JAM_WS_RES,                     // moments of one model in plan order
+    JAM_WS_RFLAG,                   // integration status of one model
+    JAM_WS_RERR,                    // integration error of one model
+    JAM_WS_CMU,                     // moments as stored in the cache
+    JAM_WS_SIDX,                    // positions picked as sentinels
+    JAM_WS_SX,                      // x' of the sentinels
+    JAM_WS_SY,                      // y' of the sentinels
+    JAM_WS_SSURF,                   // surface brightness at the sentinels
+    JAM_WS_SMU,                     // direct moments at the sentinels
+    JAM_WS_IDX,                     // thread queues of positions
+    JAM_WS_QUEUE,                   // thread queue heads and tails
+    JAM_WS_COST,                    // predicted cost of each position
+    JAM_WS_LOAD,                    // predicted load of each thread
+    JAM_WS_COUNT,                   // positions dealt to each thread
+    JAM_WS_OWNER,                   // thread each position is dealt to
+    JAM_WS_THREADS,                 // thread handles
+    JAM_WS_PXP,                     // x' in the plan order
+    JAM_WS_PYP,                     // y' in the plan order
+    JAM_WS_PIDX,                    // input position of each in the plan
+    JAM_WS_PLR,                     // log elliptical radii for the plan
+    JAM_WS_PSRT,                    // sorted log elliptical radii
+    JAM_WS_POUT,                    // outliers of the plan
+    JAM_WS_FKEY,                    // sort keys for folding
+    JAM_WS_GR,                      // elliptical radii on a grid
+    JAM_WS_GE,                      // eccentric anomalies on a grid
+    JAM_WS_IQUAD,                   // interpolation patches and scratch
+    JAM_WS_NBUF                     // number of scratch buffers
+};
+
 
 // ----------------------------------------------------------------------------
 
 
 // structs
 
+struct jam_cost {
+    double rms, vel, interp;
+};
+
 struct jam_vel {
     double *vx, *vy, *vz;
 };
 
+struct jam_graph {
+    struct jam_task *task;
+    int ntask, maxtask;
+    double wall;
+};
+
+struct jam_grid {
+    int nrad, nang, npol, nxy, spec;
+    double qmed, lrmin, lrmax, *rad, *ang, *angvec, *xpol, *ypol, *r, *e;
+    struct jam_workspace *ws;
+};
+
+struct jam_emu {
+    struct emulator emu;
+    struct jam_grid gvel, grms;
+    struct multigaussexp *lum, *pot;
+    struct jam_workspace *ws;
+    double *xp, *yp, *surf, *beta, *kappa, incl, err;
+    int nxy, *ptype, *pcomp, *integrationFlag;
+};
+
+struct jam_image {
+    int nx, ny;
+    double x0, y0, dx, dy;
+};
+
+struct jam_job {
+    struct multigaussexp *lum, *pot;
+    struct jam_vel *vm;
+    struct jam_opts *opts;
+    struct jam_pool *pool;
+    struct jam_job *next;
+    double *xp, *yp, incl, *beta, *kappa, **rms;
+    int nxy, nrad, nang, vv, integrationFlag, done;
+    enum jam_status status;
+};
+
+struct jam_lumterms {
+    struct multigaussexp ilum;
+    double *kani, *s2l, *q2l, *s2q2l, *kappa;
+};
+
+struct jam_model {
+    struct multigaussexp *pot;
+    double incl, *beta, *kappa;
+};
+
+struct jam_opts {
+    struct cache *cache;
+    struct jam_cost *cost;
+    struct jam_workspace *ws;
+    struct jam_stop *stop;
+    volatile int *cancel;
+    int *posflag;
+    double *poserr;
+    double tol, quad, merge, err, sentmax[9], sentrms[9], timeout;
+    long maxeval;
+    int npol, spectral, hybrid, nsentinel, nthread;
+};
+
+struct jam_plan {
+    double *xp, *yp;
+    int ngrid, ndirect, *idx;
+    struct jam_workspace *ws;
+};
+
+struct jam_pool {
+    struct jam_job *head, *tail;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond, done;
+    int nthread, quit;
+};
+
+struct jam_potterms {
+    struct multigaussexp ipot;
+    double *s2p, *e2p;
+};
+
+struct jam_shared {
+    struct store *st;
+    struct jam_grid grms, gvel;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    double *surf, *surfrms, *surfvel;
+    int terms;
+};
+
+struct jam_stop {
+    volatile int *cancel;
+    volatile enum jam_status status;
+    double t1;
+    long maxeval, neval;
+    pthread_mutex_t lock;
+};
+
+struct jam_task {
+    char *name;
+    void (*fn)( void * );
+    void *arg;
+    double cost, rank, t0, t1;
+    int ndep, dep[JAM_GRAPH_MAXDEP], state;
+};
+
+struct jam_workspace {
+    struct jam_wsquad *quad;
+    struct jam_workspace *split;
+    void *buf[JAM_WS_NBUF];
+    size_t nbuf[JAM_WS_NBUF];
+    int nthread, nsplit;
+};
+
+struct jam_wsquad {
+    gsl_integration_workspace *outer, *inner, *retry;
+    gsl_integration_cquad_workspace *cquad;
+    int own;
+};
+
 struct params_losint {
     struct multigaussexp *lum, *pot;
     double xp, yp, incl, *bani, *s2l, *q2l, *s2q2l, *s2p, *e2p, *kappa;
-    double zpow;
+    double zpow, quad, *intj;
+    gsl_integration_workspace *w;
+    struct jam_stop *stop;
+    long neval;
     int* integrationFlag;
+    int retry;
 };
 
 struct params_mgeint {
     struct multigaussexp *pot;
     double r2, z2, bani, s2l, q2l, s2q2l, *s2p, *e2p;
+    struct jam_stop *stop;
+    long *neval;
 };
 
 struct params_rmsint {
     struct multigaussexp *lum, *pot;
     double *kani, *s2l, *q2l, *s2q2l, *s2p, *e2p;
     double x2, y2, xy, ci, si, ci2, si2, cisi;
+    struct jam_stop *stop;
+    long neval;
     int vv;
 };
 
@@ -63,43 +374,257 @@ struct params_rmsint {
 
 // programs
 
-void jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
+double* jam_axi_adapt( struct jam_grid *, struct jam_lumterms *, \
+    struct jam_potterms *, double, double *, int, double, double, int, \
+    struct jam_workspace *, struct jam_stop *, int*, struct jam_grid *, \
+    double * );
+
+void jam_axi_cache_key( struct cache_key *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, double *, double *, int );
+
+void jam_axi_cost_calibrate( struct jam_cost * );
+
+enum jam_status jam_axi_emu_eval( struct jam_emu *, double *, double, \
+    int *, int*, double *, double *, double *, double *, double *, double *, \
+    double *, double *, double * );
+
+void jam_axi_emu_free( struct jam_emu * );
+
+enum jam_status jam_axi_emu_train( struct jam_emu *, double *, double *, \
+    int, double, struct multigaussexp *, struct multigaussexp *, double *, \
+    double *, int, int *, int *, double *, double *, int *, int, int, int* );
+
+struct jam_grid jam_axi_grid( double *, double *, int, \
+    struct multigaussexp *, int, int, double, double, \
+    struct jam_workspace * );
+
+int jam_axi_fold( double *, double *, int, double, double *, double *, \
+    int *, int *, struct jam_workspace * );
+
+int jam_axi_graph_add( struct jam_graph *, char *, void (*)( void * ), \
+    void *, double, int, int * );
+
+void jam_axi_graph_free( struct jam_graph * );
+
+double jam_axi_graph_path( struct jam_graph *, int *, int * );
+
+void jam_axi_graph_run( struct jam_graph *, int );
+
+void jam_axi_grid_free( struct jam_grid * );
+
+void jam_axi_gsl_init( void );
+
+void jam_axi_grid_nodes( struct jam_grid *, int, int, double, double, \
+    double, double, int );
+
+struct jam_grid jam_axi_grid_spec( double *, double *, int, \
+    struct multigaussexp *, int, int, double, double, \
+    struct jam_workspace * );
+
+void jam_axi_interp( struct jam_grid *, double *, int, int, double *, \
+    struct jam_opts * );
+
+struct jam_lumterms jam_axi_lumterms( struct multigaussexp *, double, \
+    double *, double * );
+
+void jam_axi_lumterms_free( struct jam_lumterms * );
+
+enum jam_status jam_axi_map_write( char *, struct jam_image *, double **, \
+    int );
+
+enum jam_status jam_axi_mmt( double *, double *, int, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, double *, \
+    int, int, int*, struct jam_vel *, double **, struct jam_graph *, \
+    struct jam_opts * );
+
+void jam_axi_plan( struct jam_plan *, double *, double *, int, \
+    struct multigaussexp *, int, int, int, int, struct jam_opts * );
+
+void jam_axi_plan_free( struct jam_plan * );
+
+int jam_axi_plan_grid( int, struct multigaussexp *, int, int, int, int, \
+    struct jam_opts * );
+
+void jam_axi_pool_free( struct jam_pool * );
+
+int jam_axi_pool_poll( struct jam_job * );
+
+void jam_axi_pool_start( struct jam_pool *, int );
+
+void jam_axi_pool_submit( struct jam_pool *, struct jam_job * );
+
+enum jam_status jam_axi_pool_wait( struct jam_job * );
+
+void jam_axi_posstat( int, int *, int *, double *, int *, double * );
+
+struct jam_potterms jam_axi_potterms( struct multigaussexp *, double );
+
+void jam_axi_potterms_free( struct jam_potterms * );
+
+void jam_axi_quadvec( double *, double *, int, \
+    gsl_integration_glfixed_table *, void (*)( double, void *, double * ), \
+    void *, int, double *, double * );
+
+enum jam_status jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
     double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
     double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
     double *beta, int nrad, int nang, int* integrationFlag, \
     double *rxx, double *ryy, double *rzz, \
-    double *rxy, double *rxz, double *ryz);
+    double *rxy, double *rxz, double *ryz, int nthread);
 
-void jam_axi_rms_axes(double *xp, double *yp, int nxy, double incl, \
-    double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
-    double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
-    double *beta, int nrad, int nang, int* integrationFlag, \
+enum jam_status jam_axi_rms_axes(double *xp, double *yp, int nxy, \
+    double incl, double *lum_area, double *lum_sigma, double *lum_q, \
+    int lum_total, double *pot_area, double *pot_sigma, double *pot_q, \
+    int pot_total, double *beta, int nrad, int nang, int* integrationFlag, \
     double *rxx, double *ryy, double *rzz, \
     double *rxy, double *rxz, double *ryz, \
-    int xaxis, int yaxis, int zaxis);
+    int xaxis, int yaxis, int zaxis, int *posflag, double *poserr, \
+    int nthread);
+
+enum jam_status jam_axi_rms_batch( double *, double *, int, \
+    struct multigaussexp *, struct jam_model *, int, int, int, int, int, \
+    int*, double **, struct jam_opts * );
+
+enum jam_status jam_axi_rms_cross( double *, double *, int, double, \
+    struct multigaussexp *, double **, int, struct multigaussexp *, int, \
+    int, int, int, int*, double **, struct jam_opts * );
+
+void jam_axi_rms_eval( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, struct jam_grid *, \
+    double *, double *, int, int*, double *, struct jam_opts * );
+
+enum jam_status jam_axi_rms_grad( double *, double *, int, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, int, int, int, \
+    int*, double *, double * );
+
+enum jam_status jam_axi_rms_map( struct jam_image *, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, int, int, int, \
+    int, int*, double *, struct jam_opts * );
+
+void jam_axi_rms_mgegrad( double, void *, double * );
 
 double jam_axi_rms_mgeint( double, void * );
 
 double* jam_axi_rms_mmt( double *,double *, int, double, \
     struct multigaussexp *, struct multigaussexp *, double *, \
-    int, int, int, int*);
+    int, int, int, int*, struct jam_opts * );
+
+enum jam_status jam_axi_rms_prog( double *, double *, int, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, int, int, \
+    int, int, int *, int*, double *, \
+    int (*)( int, enum jam_status, double *, double, void * ), void *, \
+    struct jam_opts * );
+
+double* jam_axi_rms_quad( struct jam_grid *, struct jam_lumterms *, \
+    struct jam_potterms *, double, double *, int, int*, struct jam_grid *, \
+    struct jam_grid **, struct jam_opts * );
+
+void jam_axi_rms_wgrad( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, int, int*, double *, \
+    double * );
+
+void jam_axi_rms_wmmt( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, int, int*, double, int, \
+    double *, int *, double *, struct jam_stop *, struct jam_workspace * );
+
+void jam_axi_sentinel_err( double *, double *, int *, int, double *, \
+    double * );
+
+int jam_axi_sentinel_pick( double *, int, int, int * );
+
+enum jam_status jam_axi_shared_attach( struct jam_shared *, char *, \
+    double *, double *, int, struct multigaussexp *, int, int, double, \
+    struct multigaussexp *, double *, double * );
 
-double* jam_axi_rms_wmmt( double *, double *, int, double, \
-    struct multigaussexp *, struct multigaussexp *, double *, int, int*);
+void jam_axi_shared_detach( struct jam_shared * );
 
-void jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
+enum jam_status jam_axi_stop_end( struct jam_stop *, struct jam_opts *, int, \
+    enum jam_status );
+
+enum jam_status jam_axi_stop_poll( struct jam_stop *, long );
+
+int jam_axi_stop_start( struct jam_stop *, struct jam_opts * );
+
+int jam_axi_stop_tick( struct jam_stop *, long * );
+
+enum jam_status jam_axi_terms_check( struct multigaussexp *, \
+    struct multigaussexp *, double, double * );
+
+enum jam_status jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
     double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
     double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
     double *beta, double *kappa, int nrad, int nang, int* integrationFlag, \
-    double *vx, double *vy, double *vz);
+    double *vx, double *vy, double *vz, int *posflag, double *poserr, \
+    int nthread);
+
+int jam_axi_vel_check( struct multigaussexp *, struct multigaussexp *, \
+    double *, double * );
+
+enum jam_status jam_axi_vel_batch( double *, double *, int, \
+    struct multigaussexp *, struct jam_model *, int, int, int, int, int*, \
+    struct jam_vel *, struct jam_opts * );
+
+enum jam_status jam_axi_vel_cross( double *, double *, int, double, \
+    struct multigaussexp *, double **, double **, int, \
+    struct multigaussexp *, int, int, int, int*, struct jam_vel *, \
+    struct jam_opts * );
+
+void jam_axi_vel_eval( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, struct jam_grid *, \
+    double *, double *, int*, double *, double *, double *, \
+    struct jam_opts * );
+
+enum jam_status jam_axi_vel_grad( double *, double *, int, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, double *, \
+    int, int, int*, double *, double *, double *, double *, double *, \
+    double * );
+
+enum jam_status jam_axi_vel_map( struct jam_image *, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, double *, int, \
+    int, int, int*, struct jam_vel *, struct jam_opts * );
+
+void jam_axi_vel_losgrad( double, void *, double * );
 
 double jam_axi_vel_losint( double, void * );
 
+double jam_axi_vel_mgegrad( double, void * );
+
 double jam_axi_vel_mgeint( double, void * );
 
 struct jam_vel jam_axi_vel_mmt( double *, double *, int, double, \
     struct multigaussexp *, struct multigaussexp *, double *, double *, \
-    int, int, int*);
+    int, int, int*, struct jam_opts * );
+
+enum jam_status jam_axi_vel_prog( double *, double *, int, double, \
+    struct multigaussexp *, struct multigaussexp *, double *, double *, \
+    int, int, int, int *, int*, struct jam_vel *, \
+    int (*)( int, enum jam_status, struct jam_vel *, double, void * ), \
+    void *, struct jam_opts * );
+
+double* jam_axi_vel_quad( struct jam_grid *, struct jam_lumterms *, \
+    struct jam_potterms *, double, double *, int*, struct jam_grid *, \
+    struct jam_grid **, struct jam_opts * );
+
+void jam_axi_vel_wgrad( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, int*, struct jam_vel *, \
+    double * );
+
+void jam_axi_vel_wmmt( double *, double *, int, double, \
+    struct jam_lumterms *, struct jam_potterms *, int*, double, int, \
+    struct jam_vel *, int *, double *, struct jam_stop *, \
+    struct jam_workspace * );
+
+void *jam_axi_ws_buf( struct jam_workspace *, int, size_t );
+
+void jam_axi_ws_free( struct jam_workspace * );
+
+void jam_axi_ws_put( struct jam_workspace *, void * );
+
+struct jam_wsquad *jam_axi_ws_quad( struct jam_workspace *, int, \
+    struct jam_wsquad * );
+
+void jam_axi_ws_quad_put( struct jam_workspace *, struct jam_wsquad * );
+
+void jam_axi_ws_reserve( struct jam_workspace *, int );
 
-double** jam_axi_vel_wmmt( double *, double *, int, double, \
-    struct multigaussexp *, struct multigaussexp *, double *, double *, int*);
+struct jam_workspace *jam_axi_ws_split( struct jam_workspace *, int );
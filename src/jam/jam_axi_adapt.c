@@ -0,0 +1,450 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_ADAPT
+    
+    Refines a polar interpolation grid until the interpolated moment map
+    meets a given tolerance.  The moments are calculated at the midpoint (in
+    log radius) of every radial interval at each grid angle, and at the
+    midpoint of every angular interval at each grid radius, and compared
+    with the map interpolated from the grid nodes.  Each interval whose
+    largest difference, relative to the largest value in the map, is above
+    the tolerance is split at its midpoint.  The moments on most of the new
+    nodes are then already known, and only the nodes where a new radius
+    crosses a new angle need to be calculated.  This is repeated until every
+    interval meets the tolerance or the grid reaches JAM_ADAPT_MAXRAD radii
+    and JAM_ADAPT_MAXANG angles, in which case the worst intervals are split
+    first.  The moments on the starting grid are calculated exactly as for a
+    fixed grid, so if no refinement is needed the map is the same.  The
+    refinement also ends if the calculation is stopped (see jam_axi_stop)
+    or an integral fails, and the last grid whose nodes have all been
+    calculated is then returned, rather than one with new nodes that have
+    not (nodes of the starting grid that were not reached are zero).
+    
+    INPUTS
+      grid    : starting polar grid from jam_axi_grid
+      lt      : tracer terms from jam_axi_lumterms
+      pt      : potential terms from jam_axi_potterms
+      incl    : inclination [radians]
+      surfpol : surface brightness on the starting grid
+      vv      : moment selector (0 for first moments, otherwise the second
+                moment integral selector of jam_axi_rms_wmmt)
+      tol     : tolerance on the relative interpolation error
+      qtol    : factor on the relative tolerance of the integrals (see
+                jam_axi_rms_wmmt)
+      nthread : number of threads for the integrals (see jam_axi_rms_wmmt)
+      ws      : workspace for the integrals (or NULL, see jam_axi_ws)
+      stop    : budget of the calculation (or NULL for none)
+      agrid   : structure to hold the refined grid
+      err     : to hold the relative error estimate of the refined grid
+      
+    OUTPUTS
+      The moment map on the refined grid [agrid->npol], or for first moments
+      the vx, vy and vz maps one after the other [3*agrid->npol].
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../interp/interp.h"
+
+
+// moments calculated so far, tabulated on every radius and angle used
+struct adapt_table {
+    int nm, nr, na, maxr, maxa;
+    double *r, *a, *v;
+    char *done;
+};
+
+
+// calculate the moments at n points and store them in the table
+static void jam_axi_adapt_calc( struct adapt_table *t, int *ir, int *ia, \
+        int n, double *x, double *y, double *surf, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, int vv, \
+        double qtol, int nthread, struct jam_workspace *ws, \
+        struct jam_stop *stop, int *integrationFlag ) {
+        
+    int k, m;
+    double *wm, *v;
+    struct jam_vel wm1;
+    
+    if ( n == 0 ) return;
+    
+    // weighted moments, one after the other (zero at points not reached if
+    // the calculation is stopped)
+    wm = jam_axi_ws_buf( ws, JAM_WS_MU, t->nm * n * sizeof( double ) );
+    for ( k = 0; k < t->nm * n; k++ ) wm[k] = 0.;
+    
+    if ( vv == 0 ) {
+        wm1.vx = wm;
+        wm1.vy = &wm[n];
+        wm1.vz = &wm[2*n];
+        jam_axi_vel_wmmt( x, y, n, incl, lt, pt, integrationFlag, qtol, \
+            nthread, &wm1, NULL, NULL, stop, ws );
+        for ( k = 0; k < n; k++ ) {
+            v = &t->v[(ir[k]*t->maxa+ia[k])*t->nm];
+            for ( m = 0; m < 3; m++ ) v[m] = wm[m*n+k] / surf[k];
+            t->done[ir[k]*t->maxa+ia[k]] = 1;
+        }
+    }
+    
+    else {
+        jam_axi_rms_wmmt( x, y, n, incl, lt, pt, vv, integrationFlag, qtol, \
+            nthread, wm, NULL, NULL, stop, ws );
+        for ( k = 0; k < n; k++ ) {
+            v = &t->v[(ir[k]*t->maxa+ia[k])*t->nm];
+            if ( surf[k] != 0 ) v[0] = wm[k] / surf[k];
+            else v[0] = 0;
+            t->done[ir[k]*t->maxa+ia[k]] = 1;
+        }
+    }
+    
+    jam_axi_ws_put( ws, wm );
+    
+}
+
+
+// mark the intervals to split: those above the tolerance, worst first, but
+// no more than room of them
+static int jam_axi_adapt_mark( double *err, int n, double tol, int room, \
+        int *split ) {
+        
+    int i, k, count = 0;
+    
+    for ( i = 0; i < n; i++ ) {
+        split[i] = err[i] > tol;
+        count += split[i];
+    }
+    
+    while ( count > room ) {
+        k = -1;
+        for ( i = 0; i < n; i++ ) \
+            if ( split[i] && ( k < 0 || err[i] < err[k] ) ) k = i;
+        split[k] = 0;
+        count--;
+    }
+    
+    return count;
+    
+}
+
+
+// split the marked intervals of a list of n nodes at their midpoints, and
+// return the new number of nodes (new intervals have no midpoint yet)
+static int jam_axi_adapt_split( int *node, int *mid, int *split, int n, \
+        int *newnode, int *newmid ) {
+        
+    int i, k = 0;
+    
+    for ( i = 0; i < n - 1; i++ ) {
+        newnode[k] = node[i];
+        if ( split[i] ) {
+            newmid[k++] = -1;
+            newnode[k] = mid[i];
+            newmid[k] = -1;
+        }
+        else newmid[k] = mid[i];
+        k++;
+    }
+    newnode[k] = node[n-1];
+    
+    for ( i = 0; i < k; i++ ) {
+        node[i] = newnode[i];
+        mid[i] = newmid[i];
+    }
+    node[k] = newnode[k];
+    
+    return k + 1;
+    
+}
+
+
+double* jam_axi_adapt( struct jam_grid *grid, struct jam_lumterms *lt, \
+        struct jam_potterms *pt, double incl, double *surfpol, int vv, \
+        double tol, double qtol, int nthread, struct jam_workspace *ws, \
+        struct jam_stop *stop, int *integrationFlag, struct jam_grid *agrid, \
+        double *err ) {
+        
+    struct adapt_table t;
+    struct multigaussexp plum;
+    struct interp2dquad ip;
+    int i, j, k, m, n, nr, na, nm, nsplit, s1[3], s2[3];
+    int *ri, *ai, *rm, *am, *nri, *nai, *nrm, *nam, *rsplit, *asplit, *pr, *pa;
+    int *fri, *fai, fnr, fna;
+    double *rad, *ang, *quad, *errr, *erra, *x, *y, *surf, *tr, *ta, *res;
+    double scale, d;
+    
+    // symmetries of the maps
+    nm = ( vv == 0 ) ? 3 : 1;
+    s1[0] = 1;
+    s2[0] = ( vv == 0 ) ? -1 : 1;
+    s1[1] = s2[1] = s1[2] = s2[2] = -1;
+    
+    // table of moments, with room for every node and midpoint
+    t.nm = nm;
+    t.maxr = 2 * ( grid->nrad > JAM_ADAPT_MAXRAD ? grid->nrad : \
+        JAM_ADAPT_MAXRAD );
+    t.maxa = 2 * ( grid->nang > JAM_ADAPT_MAXANG ? grid->nang : \
+        JAM_ADAPT_MAXANG );
+    t.r = (double *) malloc( t.maxr * sizeof( double ) );
+    t.a = (double *) malloc( t.maxa * sizeof( double ) );
+    t.v = (double *) calloc( t.maxr * t.maxa * nm, sizeof( double ) );
+    t.done = (char *) calloc( t.maxr * t.maxa, sizeof( char ) );
+    
+    // grid nodes and interval midpoints, as indices into the table
+    ri = (int *) malloc( t.maxr * sizeof( int ) );
+    rm = (int *) malloc( t.maxr * sizeof( int ) );
+    ai = (int *) malloc( t.maxa * sizeof( int ) );
+    am = (int *) malloc( t.maxa * sizeof( int ) );
+    nri = (int *) malloc( t.maxr * sizeof( int ) );
+    nai = (int *) malloc( t.maxa * sizeof( int ) );
+    nrm = (int *) malloc( t.maxr * sizeof( int ) );
+    nam = (int *) malloc( t.maxa * sizeof( int ) );
+    fri = (int *) malloc( t.maxr * sizeof( int ) );
+    fai = (int *) malloc( t.maxa * sizeof( int ) );
+    rsplit = (int *) malloc( t.maxr * sizeof( int ) );
+    asplit = (int *) malloc( t.maxa * sizeof( int ) );
+    errr = (double *) malloc( t.maxr * sizeof( double ) );
+    erra = (double *) malloc( t.maxa * sizeof( double ) );
+    rad = (double *) malloc( t.maxr * sizeof( double ) );
+    ang = (double *) malloc( t.maxa * sizeof( double ) );
+    
+    // points to calculate (or test) in each pass
+    n = 2 * t.maxr * t.maxa;
+    pr = (int *) malloc( n * sizeof( int ) );
+    pa = (int *) malloc( n * sizeof( int ) );
+    x = (double *) malloc( n * sizeof( double ) );
+    y = (double *) malloc( n * sizeof( double ) );
+    tr = (double *) malloc( n * sizeof( double ) );
+    ta = (double *) malloc( n * sizeof( double ) );
+    res = (double *) malloc( n * sizeof( double ) );
+    quad = (double *) malloc( nm * t.maxr * t.maxa * sizeof( double ) );
+    
+    // moments on the starting grid
+    nr = t.nr = grid->nrad;
+    na = t.na = grid->nang;
+    for ( i = 0; i < nr; i++ ) {
+        t.r[i] = grid->rad[i];
+        ri[i] = i;
+        rm[i] = -1;
+    }
+    for ( j = 0; j < na; j++ ) {
+        t.a[j] = grid->ang[j];
+        ai[j] = j;
+        am[j] = -1;
+    }
+    for ( k = 0; k < grid->npol; k++ ) {
+        pr[k] = k / na;
+        pa[k] = k % na;
+    }
+    jam_axi_adapt_calc( &t, pr, pa, grid->npol, grid->xpol, grid->ypol, \
+        surfpol, incl, lt, pt, vv, qtol, nthread, ws, stop, integrationFlag );
+    fnr = nr;
+    fna = na;
+    for ( i = 0; i < nr; i++ ) fri[i] = ri[i];
+    for ( j = 0; j < na; j++ ) fai[j] = ai[j];
+    
+    // surface brightness for the new points
+    plum = mge_project( &lt->ilum, incl );
+    
+    *err = 0.;
+    while ( *integrationFlag == 0 && jam_axi_stop_poll( stop, 0 ) == JAM_OK ) {
+        
+        // midpoints of new intervals
+        for ( i = 0; i < nr - 1; i++ ) if ( rm[i] < 0 ) {
+            rm[i] = t.nr;
+            t.r[t.nr++] = sqrt( t.r[ri[i]] * t.r[ri[i+1]] );
+        }
+        for ( j = 0; j < na - 1; j++ ) if ( am[j] < 0 ) {
+            am[j] = t.na;
+            t.a[t.na++] = 0.5 * ( t.a[ai[j]] + t.a[ai[j+1]] );
+        }
+        
+        // nodes and midpoints that have not been calculated yet
+        n = 0;
+        for ( i = 0; i < 2 * nr - 1; i++ ) {
+            for ( j = 0; j < 2 * na - 1; j++ ) {
+                if ( i % 2 == 1 && j % 2 == 1 ) continue;
+                pr[n] = ( i % 2 == 0 ) ? ri[i/2] : rm[i/2];
+                pa[n] = ( j % 2 == 0 ) ? ai[j/2] : am[j/2];
+                if ( t.done[pr[n]*t.maxa+pa[n]] ) continue;
+                x[n] = t.r[pr[n]] * cos( t.a[pa[n]] );
+                y[n] = t.r[pr[n]] * sin( t.a[pa[n]] ) * grid->qmed;
+                n++;
+            }
+        }
+        surf = mge_surf( &plum, x, y, n );
+        jam_axi_adapt_calc( &t, pr, pa, n, x, y, surf, incl, lt, pt, vv, \
+            qtol, nthread, ws, stop, integrationFlag );
+        free( surf );
+        if ( *integrationFlag != 0 || jam_axi_stop_poll( stop, 0 ) != JAM_OK ) \
+            break;
+            
+        // every node of the current grid is now known
+        fnr = nr;
+        fna = na;
+        for ( i = 0; i < nr; i++ ) fri[i] = ri[i];
+        for ( j = 0; j < na; j++ ) fai[j] = ai[j];
+        
+        // maps on the current grid
+        scale = 0.;
+        for ( m = 0; m < nm; m++ ) {
+            for ( i = 0; i < nr; i++ ) {
+                for ( j = 0; j < na; j++ ) {
+                    d = t.v[(ri[i]*t.maxa+ai[j])*nm+m];
+                    quad[(m*nr+i)*na+j] = d;
+                    if ( fabs( d ) > scale ) scale = fabs( d );
+                }
+            }
+        }
+        if ( scale == 0. ) scale = 1.;
+        for ( i = 0; i < nr; i++ ) rad[i] = t.r[ri[i]];
+        for ( j = 0; j < na; j++ ) ang[j] = t.a[ai[j]];
+        
+        // test points: radial midpoints then angular midpoints
+        n = 0;
+        for ( i = 0; i < nr - 1; i++ ) {
+            for ( j = 0; j < na; j++ ) {
+                pr[n] = rm[i];
+                pa[n] = ai[j];
+                n++;
+            }
+        }
+        for ( i = 0; i < nr; i++ ) {
+            for ( j = 0; j < na - 1; j++ ) {
+                pr[n] = ri[i];
+                pa[n] = am[j];
+                n++;
+            }
+        }
+        for ( k = 0; k < n; k++ ) {
+            tr[k] = t.r[pr[k]];
+            ta[k] = t.a[pa[k]];
+        }
+        
+        // interpolation error in each interval
+        for ( i = 0; i < nr - 1; i++ ) errr[i] = 0.;
+        for ( j = 0; j < na - 1; j++ ) erra[j] = 0.;
+        for ( m = 0; m < nm; m++ ) {
+            interp2dquad_init( &ip, &quad[m*nr*na], rad, ang, nr, na, \
+                s1[m], s2[m], NULL );
+            interp2dquad_eval( &ip, tr, ta, n, res );
+            interp2dquad_free( &ip );
+            for ( k = 0; k < n; k++ ) {
+                d = fabs( res[k] - t.v[(pr[k]*t.maxa+pa[k])*nm+m] ) / scale;
+                if ( k < ( nr - 1 ) * na ) {
+                    i = k / na;
+                    if ( d > errr[i] ) errr[i] = d;
+                } else {
+                    j = ( k - ( nr - 1 ) * na ) % ( na - 1 );
+                    if ( d > erra[j] ) erra[j] = d;
+                }
+            }
+        }
+        *err = 0.;
+        for ( i = 0; i < nr - 1; i++ ) if ( errr[i] > *err ) *err = errr[i];
+        for ( j = 0; j < na - 1; j++ ) if ( erra[j] > *err ) *err = erra[j];
+        if ( *err <= tol ) break;
+        
+        // split the intervals that fail, as far as the grid size allows
+        nsplit = jam_axi_adapt_mark( errr, nr - 1, tol, \
+            ( nr > JAM_ADAPT_MAXRAD ? nr : JAM_ADAPT_MAXRAD ) - nr, rsplit );
+        nsplit += jam_axi_adapt_mark( erra, na - 1, tol, \
+            ( na > JAM_ADAPT_MAXANG ? na : JAM_ADAPT_MAXANG ) - na, asplit );
+        if ( nsplit == 0 ) break;
+        
+        nr = jam_axi_adapt_split( ri, rm, rsplit, nr, nri, nrm );
+        na = jam_axi_adapt_split( ai, am, asplit, na, nai, nam );
+        
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // refined grid, the last one with every node calculated
+    nr = fnr;
+    na = fna;
+    for ( i = 0; i < nr; i++ ) ri[i] = fri[i];
+    for ( j = 0; j < na; j++ ) ai[j] = fai[j];
+    agrid->nrad = nr;
+    agrid->nang = na;
+    agrid->npol = nr * na;
+    agrid->nxy = grid->nxy;
+    agrid->spec = 0;
+    agrid->lrmin = grid->lrmin;
+    agrid->lrmax = grid->lrmax;
+    agrid->qmed = grid->qmed;
+    agrid->rad = (double *) malloc( nr * sizeof( double ) );
+    agrid->ang = (double *) malloc( na * sizeof( double ) );
+    agrid->angvec = NULL;
+    agrid->xpol = (double *) malloc( agrid->npol * sizeof( double ) );
+    agrid->ypol = (double *) malloc( agrid->npol * sizeof( double ) );
+    agrid->r = (double *) malloc( grid->nxy * sizeof( double ) );
+    agrid->e = (double *) malloc( grid->nxy * sizeof( double ) );
+    agrid->ws = NULL;
+    for ( i = 0; i < nr; i++ ) agrid->rad[i] = t.r[ri[i]];
+    for ( j = 0; j < na; j++ ) agrid->ang[j] = t.a[ai[j]];
+    for ( i = 0; i < nr; i++ ) {
+        for ( j = 0; j < na; j++ ) {
+            agrid->xpol[i*na+j] = agrid->rad[i] * cos( agrid->ang[j] );
+            agrid->ypol[i*na+j] = agrid->rad[i] * sin( agrid->ang[j] ) \
+                * grid->qmed;
+        }
+    }
+    for ( k = 0; k < grid->nxy; k++ ) {
+        agrid->r[k] = grid->r[k];
+        agrid->e[k] = grid->e[k];
+    }
+    
+    // maps on the refined grid
+    res = (double *) realloc( res, nm * agrid->npol * sizeof( double ) );
+    for ( m = 0; m < nm; m++ ) {
+        for ( i = 0; i < nr; i++ ) {
+            for ( j = 0; j < na; j++ ) res[(m*nr+i)*na+j] = \
+                t.v[(ri[i]*t.maxa+ai[j])*nm+m];
+        }
+    }
+    
+    free( plum.area );
+    free( plum.sigma );
+    free( plum.q );
+    free( t.r );
+    free( t.a );
+    free( t.v );
+    free( t.done );
+    free( ri );
+    free( rm );
+    free( ai );
+    free( am );
+    free( nri );
+    free( nai );
+    free( nrm );
+    free( nam );
+    free( fri );
+    free( fai );
+    free( rsplit );
+    free( asplit );
+    free( errr );
+    free( erra );
+    free( rad );
+    free( ang );
+    free( pr );
+    free( pa );
+    free( x );
+    free( y );
+    free( tr );
+    free( ta );
+    free( quad );
+    
+    return res;
+    
+}
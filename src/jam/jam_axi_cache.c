@@ -0,0 +1,66 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_CACHE
+    
+    Content hash of a moment calculation for the on-disk cache.  The key
+    covers everything the moment maps depend on: the moment type, the
+    inclination, the intrinsic tracer and potential MGEs, the anisotropy and
+    rotation, the positions at which the integrals are done and the version
+    of the integration code (which fixes the quadrature tolerances).
+    
+    INPUTS
+      key  : hash to fill
+      type : moment type (0 for first moments, vv for second moments)
+      incl : inclination [radians]
+      lt   : tracer terms from jam_axi_lumterms
+      pt   : potential terms from jam_axi_potterms
+      x    : x' positions of the integrals (input positions or polar grid)
+      y    : y' positions of the integrals (input positions or polar grid)
+      n    : number of positions
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+void jam_axi_cache_key( struct cache_key *key, int type, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, double *x, \
+        double *y, int n ) {
+        
+    int code = JAM_CACHE_CODE, nl = lt->ilum.ntotal, np = pt->ipot.ntotal;
+    
+    cache_key_init( key );
+    cache_key_add( key, &code, sizeof( int ) );
+    cache_key_add( key, &type, sizeof( int ) );
+    cache_key_add( key, &incl, sizeof( double ) );
+    
+    // tracer
+    cache_key_add( key, &nl, sizeof( int ) );
+    cache_key_add( key, lt->ilum.area, nl * sizeof( double ) );
+    cache_key_add( key, lt->ilum.sigma, nl * sizeof( double ) );
+    cache_key_add( key, lt->ilum.q, nl * sizeof( double ) );
+    cache_key_add( key, lt->kani, nl * sizeof( double ) );
+    if ( lt->kappa != NULL ) \
+        cache_key_add( key, lt->kappa, nl * sizeof( double ) );
+        
+    // potential
+    cache_key_add( key, &np, sizeof( int ) );
+    cache_key_add( key, pt->ipot.area, np * sizeof( double ) );
+    cache_key_add( key, pt->ipot.sigma, np * sizeof( double ) );
+    cache_key_add( key, pt->ipot.q, np * sizeof( double ) );
+    
+    // positions
+    cache_key_add( key, &n, sizeof( int ) );
+    cache_key_add( key, x, n * sizeof( double ) );
+    cache_key_add( key, y, n * sizeof( double ) );
+    
+}
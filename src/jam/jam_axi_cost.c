@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_COST
+    
+    Calibrates the cost model used by jam_axi_plan with a short benchmark
+    (a few hundredths of a second): the time per position of a second and
+    a first moment integral for a single tracer and potential component,
+    and of the interpolation of one map.  The result can be passed to the
+    moment functions through opts->cost; without it, the built-in defaults
+    JAM_COST_RMS, JAM_COST_VEL and JAM_COST_INTERP are used.
+    
+    INPUTS
+      cost : cost structure to fill
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+static double jam_axi_cost_now( void ) {
+    
+    struct timespec ts;
+    
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    
+}
+
+
+void jam_axi_cost_calibrate( struct jam_cost *cost ) {
+    
+    struct multigaussexp mge;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_grid grid;
+    struct jam_vel wm1;
+    double area = 1.e4, sigma = 10., q = 0.8, beta = 0.1, kappa = 1.;
+    double incl = 1., xp[2000], yp[2000], mu[2000], *map, t;
+    int i, nrms = 16, nvel = 4, nint = 2000, flag = 0;
+    
+    mge.area = &area;
+    mge.sigma = &sigma;
+    mge.q = &q;
+    mge.ntotal = 1;
+    lt = jam_axi_lumterms( &mge, incl, &beta, &kappa );
+    pt = jam_axi_potterms( &mge, incl );
+    
+    // positions spread over a few scale lengths
+    for ( i = 0; i < nint; i++ ) {
+        xp[i] = sigma * 3. * cos( 2.39996 * i ) * sqrt( ( i + 0.5 ) / nint );
+        yp[i] = sigma * 3. * sin( 2.39996 * i ) * sqrt( ( i + 0.5 ) / nint );
+    }
+    
+    // second moment integrals
+    t = jam_axi_cost_now();
+    jam_axi_rms_wmmt( xp, yp, nrms, incl, &lt, &pt, 3, &flag, 1., 0, mu, \
+        NULL, NULL, NULL, NULL );
+    cost->rms = ( jam_axi_cost_now() - t ) / nrms;
+    
+    // first moment integrals
+    wm1.vx = mu;
+    wm1.vy = &mu[nvel];
+    wm1.vz = &mu[2*nvel];
+    t = jam_axi_cost_now();
+    jam_axi_vel_wmmt( xp, yp, nvel, incl, &lt, &pt, &flag, 1., 0, &wm1, \
+        NULL, NULL, NULL, NULL );
+    cost->vel = ( jam_axi_cost_now() - t ) / nvel;
+    
+    // interpolation of one map
+    grid = jam_axi_grid( xp, yp, nint, &mge, 10, 4, -0.1, 0.1, NULL );
+    map = mge_surf( &mge, grid.xpol, grid.ypol, grid.npol );
+    t = jam_axi_cost_now();
+    jam_axi_interp( &grid, map, 1, 1, mu, NULL );
+    cost->interp = ( jam_axi_cost_now() - t ) / nint;
+    free( map );
+    jam_axi_grid_free( &grid );
+    
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    
+}
@@ -0,0 +1,383 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_EMU
+    
+    Emulator of the first and second moments over a box in model parameter
+    space.  The polar interpolation grids depend only on the positions and
+    the tracer MGE, so the moment maps on the grids are smooth functions of
+    the model parameters alone.  jam_axi_emu_train fits a Chebyshev emulator
+    (see emu/emu_train.c) to all nine moment maps over the box, and
+    jam_axi_emu_eval evaluates it and interpolates the maps to the input
+    positions.  Outside the box, or when the estimated emulator error is
+    larger than the requested tolerance, jam_axi_emu_eval falls back to the
+    exact moment calculation.
+    
+    Each emulated parameter has a type (JAM_EMU_INCL, JAM_EMU_BETA,
+    JAM_EMU_KAPPA or JAM_EMU_ML) and a component: the luminous MGE component
+    for beta and kappa, the potential MGE component for ml, or -1 to apply
+    the parameter to all components.  ml scales the given potential areas.
+    
+    INPUTS (jam_axi_emu_train)
+      je    : emulator structure to fill
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians] (unless emulated)
+      lum   : projected luminous MGE (must stay valid while emulator is used)
+      pot   : projected potential MGE (must stay valid while emulator is used)
+      beta  : velocity anisotropy (1 - vz^2 / vr^2) (unless emulated)
+      kappa : rotation parameter (unless emulated)
+      ndim  : number of emulated parameters
+      ptype : type of each emulated parameter
+      pcomp : MGE component of each emulated parameter, or -1 for all
+      lo    : lower limits of the parameter box
+      hi    : upper limits of the parameter box
+      nord  : number of Chebyshev nodes per parameter
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      
+    OUTPUTS (jam_axi_emu_train)
+      JAM_OK, or the status from jam_axi_terms_check if the model cannot be
+      deprojected somewhere in the box (at the lowest inclination and
+      largest anisotropies), in which case nothing is trained and je must
+      not be used or freed.
+      
+    INPUTS (jam_axi_emu_eval)
+      je    : trained emulator
+      par   : emulated parameters
+      tol   : largest acceptable relative emulator error
+      exact : set to 1 if the moments were calculated exactly, 0 if they
+              were emulated (or NULL)
+      vx, vy, vz : arrays to hold the first moments
+      rxx, ryy, rzz, rxy, rxz, ryz : arrays to hold the second moments
+      
+    OUTPUTS (jam_axi_emu_eval)
+      JAM_OK, the status of the exact calculation (see jam_axi_vel_cross
+      and jam_axi_rms_cross) if it was needed, or the status from
+      jam_axi_terms_check if it was needed but the model cannot be
+      deprojected (the moments are then zero).
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../emu/emu.h"
+
+
+// model inputs for a point in parameter space
+static void jam_axi_emu_params( struct jam_emu *je, double *par, \
+        double *incl, double *beta, double *kappa, double *potarea ) {
+    
+    int d, i;
+    
+    *incl = je->incl;
+    for ( i = 0; i < je->lum->ntotal; i++ ) {
+        beta[i] = je->beta[i];
+        kappa[i] = je->kappa[i];
+    }
+    for ( i = 0; i < je->pot->ntotal; i++ ) potarea[i] = je->pot->area[i];
+    
+    for ( d = 0; d < je->emu.ndim; d++ ) {
+        switch ( je->ptype[d] ) {
+            case JAM_EMU_INCL:
+                *incl = par[d];
+                break;
+            case JAM_EMU_BETA:
+                for ( i = 0; i < je->lum->ntotal; i++ ) \
+                    if ( je->pcomp[d] < 0 || je->pcomp[d] == i ) \
+                        beta[i] = par[d];
+                break;
+            case JAM_EMU_KAPPA:
+                for ( i = 0; i < je->lum->ntotal; i++ ) \
+                    if ( je->pcomp[d] < 0 || je->pcomp[d] == i ) \
+                        kappa[i] = par[d];
+                break;
+            case JAM_EMU_ML:
+                for ( i = 0; i < je->pot->ntotal; i++ ) \
+                    if ( je->pcomp[d] < 0 || je->pcomp[d] == i ) \
+                        potarea[i] = je->pot->area[i] * par[d];
+                break;
+        }
+    }
+    
+}
+
+
+// moment maps on the polar grids for a point in parameter space
+static void jam_axi_emu_model( double *par, void *params, double *out ) {
+    
+    struct jam_emu *je = params;
+    struct multigaussexp pot;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_vel wm1;
+    double incl, *beta, *kappa, *surf;
+    int k, v, vv, npol;
+    
+    beta = (double *) malloc( je->lum->ntotal * sizeof( double ) );
+    kappa = (double *) malloc( je->lum->ntotal * sizeof( double ) );
+    pot = *je->pot;
+    pot.area = (double *) malloc( pot.ntotal * sizeof( double ) );
+    jam_axi_emu_params( je, par, &incl, beta, kappa, pot.area );
+    
+    lt = jam_axi_lumterms( je->lum, incl, beta, kappa );
+    pt = jam_axi_potterms( &pot, incl );
+    
+    // first moments on the first-moment grid
+    npol = je->gvel.npol;
+    if ( jam_axi_vel_check( je->lum, &pot, beta, kappa ) > 0 ) {
+        wm1.vx = out;
+        wm1.vy = &out[npol];
+        wm1.vz = &out[2*npol];
+        jam_axi_vel_wmmt( je->gvel.xpol, je->gvel.ypol, npol, incl, &lt, \
+            &pt, je->integrationFlag, 1., 0, &wm1, NULL, NULL, NULL, \
+            je->ws );
+        surf = mge_surf( je->lum, je->gvel.xpol, je->gvel.ypol, npol );
+        for ( v = 0; v < 3; v++ ) \
+            for ( k = 0; k < npol; k++ ) out[v*npol+k] /= surf[k];
+        free( surf );
+    } else {
+        for ( k = 0; k < 3 * npol; k++ ) out[k] = 0.;
+    }
+    
+    // second moments on the second-moment grid
+    out += 3 * npol;
+    npol = je->grms.npol;
+    surf = mge_surf( je->lum, je->grms.xpol, je->grms.ypol, npol );
+    for ( vv = 1; vv <= 6; vv++ ) {
+        jam_axi_rms_wmmt( je->grms.xpol, je->grms.ypol, npol, incl, &lt, \
+            &pt, vv, je->integrationFlag, 1., 0, &out[(vv-1)*npol], NULL, \
+            NULL, NULL, je->ws );
+        for ( k = 0; k < npol; k++ ) {
+            if ( surf[k] != 0 ) out[(vv-1)*npol+k] /= surf[k];
+            else out[(vv-1)*npol+k] = 0.;
+        }
+    }
+    free( surf );
+    
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    free( beta );
+    free( kappa );
+    free( pot.area );
+    
+}
+
+
+enum jam_status jam_axi_emu_train( struct jam_emu *je, double *xp, double *yp, \
+        int nxy, double incl, struct multigaussexp *lum, \
+        struct multigaussexp *pot, double *beta, double *kappa, int ndim, \
+        int *ptype, int *pcomp, double *lo, double *hi, int *nord, int nrad, \
+        int nang, int* integrationFlag ) {
+    
+    int i, o, v, d, nmap;
+    double c0, tail, wincl, *wbeta;
+    enum jam_status status;
+    struct jam_workspace ws = { NULL };
+    
+    // check that the model can be deprojected over the whole box: the
+    // lowest inclination and the largest anisotropies are the worst case
+    wincl = incl;
+    wbeta = (double *) malloc( lum->ntotal * sizeof( double ) );
+    for ( i = 0; i < lum->ntotal; i++ ) wbeta[i] = beta[i];
+    for ( d = 0; d < ndim; d++ ) {
+        if ( ptype[d] == JAM_EMU_INCL ) wincl = lo[d];
+        if ( ptype[d] == JAM_EMU_BETA ) for ( i = 0; i < lum->ntotal; i++ ) \
+            if ( pcomp[d] < 0 || pcomp[d] == i ) wbeta[i] = hi[d];
+    }
+    status = jam_axi_terms_check( lum, pot, wincl, wbeta );
+    free( wbeta );
+    if ( status != JAM_OK ) return status;
+    
+    // copy inputs
+    je->nxy = nxy;
+    je->incl = incl;
+    je->lum = lum;
+    je->pot = pot;
+    je->integrationFlag = integrationFlag;
+    je->xp = (double *) malloc( nxy * sizeof( double ) );
+    je->yp = (double *) malloc( nxy * sizeof( double ) );
+    for ( i = 0; i < nxy; i++ ) {
+        je->xp[i] = xp[i];
+        je->yp[i] = yp[i];
+    }
+    je->beta = (double *) malloc( lum->ntotal * sizeof( double ) );
+    je->kappa = (double *) malloc( lum->ntotal * sizeof( double ) );
+    for ( i = 0; i < lum->ntotal; i++ ) {
+        je->beta[i] = beta[i];
+        je->kappa[i] = kappa[i];
+    }
+    je->ptype = (int *) malloc( ndim * sizeof( int ) );
+    je->pcomp = (int *) malloc( ndim * sizeof( int ) );
+    for ( i = 0; i < ndim; i++ ) {
+        je->ptype[i] = ptype[i];
+        je->pcomp[i] = pcomp[i];
+    }
+    
+    // polar grids (as used by the first and second moment calculations)
+    je->gvel = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, -0.1, 0.1, \
+        NULL );
+    je->grms = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, log( 0.99 ), \
+        log( 1.01 ), NULL );
+    je->surf = mge_surf( lum, xp, yp, nxy );
+    
+    // train on all nine moment maps, reusing the memory for the integrals
+    // from one node to the next
+    je->ws = &ws;
+    emu_train( &je->emu, ndim, lo, hi, nord, 9 * je->grms.npol, \
+        &jam_axi_emu_model, je );
+    je->ws = NULL;
+    jam_axi_ws_free( &ws );
+    
+    // relative error estimate: largest truncation error in each map
+    // relative to the largest mean value in that map
+    je->err = 0.;
+    nmap = je->grms.npol;
+    for ( v = 0; v < 9; v++ ) {
+        c0 = 0.;
+        tail = 0.;
+        for ( o = v * nmap; o < ( v + 1 ) * nmap; o++ ) {
+            if ( fabs( je->emu.coef[o] ) > c0 ) c0 = fabs( je->emu.coef[o] );
+            if ( je->emu.tail[o] > tail ) tail = je->emu.tail[o];
+        }
+        if ( c0 > 0. && tail / c0 > je->err ) je->err = tail / c0;
+    }
+    
+    return JAM_OK;
+    
+}
+
+
+enum jam_status jam_axi_emu_eval( struct jam_emu *je, double *par, \
+        double tol, int *exact, int* integrationFlag, double *vx, \
+        double *vy, double *vz, double *rxx, double *ryy, double *rzz, \
+        double *rxy, double *rxz, double *ryz ) {
+    
+    struct multigaussexp pot;
+    struct jam_vel vm;
+    double incl, *beta, *kappa, *maps, *mu[9];
+    int i, v, nxy, npol;
+    enum jam_status status, s;
+    
+    nxy = je->nxy;
+    mu[0] = vx;
+    mu[1] = vy;
+    mu[2] = vz;
+    mu[3] = rxx;
+    mu[4] = ryy;
+    mu[5] = rzz;
+    mu[6] = rxy;
+    mu[7] = rxz;
+    mu[8] = ryz;
+    
+    // emulated moment maps, if inside the box and accurate enough
+    maps = (double *) malloc( je->emu.nout * sizeof( double ) );
+    if ( je->err <= tol && emu_eval( &je->emu, par, maps ) == 0 ) {
+        
+        npol = je->grms.npol;
+        for ( v = 0; v < 9; v++ ) {
+            
+            if ( v == 0 ) jam_axi_interp( &je->gvel, maps, 1, -1, mu[v], \
+                NULL );
+            else if ( v < 3 ) jam_axi_interp( &je->gvel, &maps[v*npol], -1, \
+                -1, mu[v], NULL );
+            else jam_axi_interp( &je->grms, &maps[v*npol], 1, 1, mu[v], \
+                NULL );
+            
+            for ( i = 0; i < nxy; i++ ) {
+                
+                // second moments are zero where surface brightness is zero
+                if ( v >= 3 && je->surf[i] == 0 ) mu[v][i] = 0.;
+                
+                // fix signs of xy and xz second moments
+                if ( v == 6 && je->xp[i] * je->yp[i] >= 0. ) mu[v][i] *= -1.;
+                if ( v == 7 && je->xp[i] * je->yp[i] < 0. ) mu[v][i] *= -1.;
+                
+            }
+            
+        }
+        
+        free( maps );
+        if ( exact != NULL ) *exact = 0;
+        return JAM_OK;
+        
+    }
+    free( maps );
+    
+    
+    // ---------------------------------
+    
+    
+    // otherwise fall back to the exact calculation
+    if ( exact != NULL ) *exact = 1;
+    beta = (double *) malloc( je->lum->ntotal * sizeof( double ) );
+    kappa = (double *) malloc( je->lum->ntotal * sizeof( double ) );
+    pot = *je->pot;
+    pot.area = (double *) malloc( pot.ntotal * sizeof( double ) );
+    jam_axi_emu_params( je, par, &incl, beta, kappa, pot.area );
+    
+    // zero moments for a model that cannot be deprojected
+    status = jam_axi_terms_check( je->lum, &pot, incl, beta );
+    if ( status != JAM_OK ) {
+        for ( v = 0; v < 9; v++ ) for ( i = 0; i < nxy; i++ ) mu[v][i] = 0.;
+        free( beta );
+        free( kappa );
+        free( pot.area );
+        return status;
+    }
+    
+    // moments straight into the output arrays
+    if ( jam_axi_vel_check( je->lum, &pot, beta, kappa ) > 0 ) {
+        vm.vx = vx;
+        vm.vy = vy;
+        vm.vz = vz;
+        status = jam_axi_vel_cross( je->xp, je->yp, nxy, incl, je->lum, \
+            &beta, &kappa, 1, &pot, 1, je->gvel.nrad, je->gvel.nang, \
+            integrationFlag, &vm, NULL );
+    } else {
+        for ( i = 0; i < nxy; i++ ) {
+            vx[i] = 0.;
+            vy[i] = 0.;
+            vz[i] = 0.;
+        }
+    }
+    
+    for ( v = 3; v < 9; v++ ) {
+        s = jam_axi_rms_cross( je->xp, je->yp, nxy, incl, je->lum, &beta, \
+            1, &pot, 1, je->grms.nrad, je->grms.nang, v - 2, \
+            integrationFlag, &mu[v], NULL );
+        if ( status == JAM_OK ) status = s;
+    }
+    
+    free( beta );
+    free( kappa );
+    free( pot.area );
+    
+    return status;
+    
+}
+
+
+void jam_axi_emu_free( struct jam_emu *je ) {
+    
+    emu_free( &je->emu );
+    jam_axi_grid_free( &je->gvel );
+    jam_axi_grid_free( &je->grms );
+    free( je->xp );
+    free( je->yp );
+    free( je->surf );
+    free( je->beta );
+    free( je->kappa );
+    free( je->ptype );
+    free( je->pcomp );
+    
+}
@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_FOLD
+    
+    Folds positions onto the first quadrant (the moments are symmetric about
+    both projected axes, up to sign) and merges those that coincide, so
+    that the moments need only be integrated once for each unique folded
+    position.  With merge = 0 only exact duplicates are merged; otherwise
+    positions that fall in the same cell of a log-polar grid, with cells
+    merge wide in log radius and in angle (so about merge times the radius
+    on a side), are merged and take the moments of the first of them.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      merge : relative size of the cells within which positions are merged
+      xf    : array [nxy] to hold the unique folded x' [pc]
+      yf    : array [nxy] to hold the unique folded y' [pc]
+      rep   : array [nxy] to hold the index of the position that each unique
+              folded position was taken from
+      map   : array [nxy] to hold the index in xf and yf of each position
+      ws    : workspace for the sort keys (or NULL, see jam_axi_ws)
+      
+    OUTPUTS
+      The number of unique folded positions.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+
+
+struct fold_key {
+    double k1, k2;
+    int i;
+};
+
+
+static int jam_axi_fold_cmp( const void *a, const void *b ) {
+    
+    const struct fold_key *ka = a, *kb = b;
+    
+    if ( ka->k1 != kb->k1 ) return ( ka->k1 > kb->k1 ) - ( ka->k1 < kb->k1 );
+    if ( ka->k2 != kb->k2 ) return ( ka->k2 > kb->k2 ) - ( ka->k2 < kb->k2 );
+    return ka->i - kb->i;
+    
+}
+
+
+int jam_axi_fold( double *xp, double *yp, int nxy, double merge, \
+        double *xf, double *yf, int *rep, int *map, \
+        struct jam_workspace *ws ) {
+        
+    struct fold_key *key;
+    double x, y, r;
+    int i, n;
+    
+    // sort keys: the folded position itself, or its log-polar cell
+    key = jam_axi_ws_buf( ws, JAM_WS_FKEY, nxy * sizeof( struct fold_key ) );
+    for ( i = 0; i < nxy; i++ ) {
+        x = fabs( xp[i] );
+        y = fabs( yp[i] );
+        if ( merge > 0. ) {
+            r = sqrt( x * x + y * y );
+            key[i].k1 = ( r > 0. ) ? floor( log( r ) / merge ) : -HUGE_VAL;
+            key[i].k2 = floor( atan2( y, x ) / merge );
+        }
+        else {
+            key[i].k1 = x;
+            key[i].k2 = y;
+        }
+        key[i].i = i;
+    }
+    qsort( key, nxy, sizeof( struct fold_key ), jam_axi_fold_cmp );
+    
+    // one folded position for each run of equal keys
+    n = 0;
+    for ( i = 0; i < nxy; i++ ) {
+        if ( i == 0 || key[i].k1 != key[i-1].k1 || key[i].k2 != key[i-1].k2 ) {
+            rep[n] = key[i].i;
+            xf[n] = fabs( xp[key[i].i] );
+            yf[n] = fabs( yp[key[i].i] );
+            n++;
+        }
+        map[key[i].i] = n - 1;
+    }
+    
+    jam_axi_ws_put( ws, key );
+    
+    return n;
+    
+}
@@ -0,0 +1,270 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_GRAPH
+    
+    A small task-graph runtime, for running the independent stages of a
+    moment calculation (terms, grids, surface densities, integrals and
+    interpolation for several moments) at the same time.  A graph starts
+    empty ( struct jam_graph g = { NULL } ) and tasks are added with
+    jam_axi_graph_add, each with the tasks it depends on, which must have
+    been added before it; so the order of addition is always a valid serial
+    order.
+    
+    jam_axi_graph_run runs the graph on nthread threads (the calling thread
+    and nthread-1 more).  Whenever a thread is free it takes, of the tasks
+    whose dependencies are all done, the one with the longest predicted
+    path to the end of the graph (its own predicted cost plus that of its
+    most expensive chain of dependents), so the tasks on the critical path
+    start first.  The start and end times of each task are recorded, and the
+    wall time of the run goes in graph->wall.
+    
+    jam_axi_graph_path finds the critical path of a graph that has been run
+    from the measured times: the chain of dependent tasks with the largest
+    total time, which bounds the wall time from below however many threads
+    are used.  It returns the length of the path and puts the tasks on it,
+    first to last, in path.
+    
+    INPUTS (jam_axi_graph_add)
+      graph : task graph
+      name  : name of the task (not copied)
+      fn    : function to run
+      arg   : argument passed to fn
+      cost  : predicted cost of the task (in any units, only the ratios
+              between tasks matter)
+      ndep  : number of tasks the task depends on (up to JAM_GRAPH_MAXDEP)
+      dep   : indices of the tasks the task depends on
+      
+    OUTPUTS (jam_axi_graph_add)
+      The index of the new task.
+      
+    INPUTS (jam_axi_graph_run)
+      graph   : task graph
+      nthread : number of threads (0 or 1 for one, negative to use all
+                available processors)
+                
+    INPUTS (jam_axi_graph_path)
+      graph : task graph that has been run
+      path  : array [graph->ntask] to hold the tasks on the critical path
+      npath : set to the number of tasks on the critical path
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "jam.h"
+
+
+// state shared between threads
+struct graph_run {
+    struct jam_graph *graph;
+    double t0;
+    int ndone;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+
+static double jam_axi_graph_now( void ) {
+    
+    struct timespec ts;
+    
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    
+}
+
+
+int jam_axi_graph_add( struct jam_graph *graph, char *name, \
+        void (*fn)( void * ), void *arg, double cost, int ndep, int *dep ) {
+        
+    struct jam_task *t;
+    int i;
+    
+    if ( graph->ntask == graph->maxtask ) {
+        graph->maxtask = ( graph->maxtask > 0 ) ? 2 * graph->maxtask : 16;
+        graph->task = (struct jam_task *) realloc( graph->task, \
+            graph->maxtask * sizeof( struct jam_task ) );
+    }
+    
+    t = &graph->task[graph->ntask];
+    t->name = name;
+    t->fn = fn;
+    t->arg = arg;
+    t->cost = cost;
+    t->rank = cost;
+    t->t0 = t->t1 = 0.;
+    t->state = 0;
+    t->ndep = 0;
+    for ( i = 0; i < ndep && i < JAM_GRAPH_MAXDEP; i++ ) \
+        if ( dep[i] >= 0 && dep[i] < graph->ntask ) t->dep[t->ndep++] = dep[i];
+        
+    return graph->ntask++;
+    
+}
+
+
+// the ready task with the longest path to the end, or -1 if there is none
+static int jam_axi_graph_next( struct jam_graph *graph ) {
+    
+    struct jam_task *t;
+    int i, d, best = -1;
+    
+    for ( i = 0; i < graph->ntask; i++ ) {
+        t = &graph->task[i];
+        if ( t->state != 0 ) continue;
+        for ( d = 0; d < t->ndep; d++ ) \
+            if ( graph->task[t->dep[d]].state != 2 ) break;
+        if ( d < t->ndep ) continue;
+        if ( best < 0 || t->rank > graph->task[best].rank ) best = i;
+    }
+    
+    return best;
+    
+}
+
+
+static void *jam_axi_graph_worker( void *arg ) {
+    
+    struct graph_run *run = arg;
+    struct jam_graph *graph = run->graph;
+    struct jam_task *t;
+    int i;
+    
+    pthread_mutex_lock( &run->lock );
+    while ( run->ndone < graph->ntask ) {
+        
+        // wait for a task whose dependencies are done
+        i = jam_axi_graph_next( graph );
+        if ( i < 0 ) {
+            pthread_cond_wait( &run->cond, &run->lock );
+            continue;
+        }
+        t = &graph->task[i];
+        t->state = 1;
+        t->t0 = jam_axi_graph_now() - run->t0;
+        pthread_mutex_unlock( &run->lock );
+        
+        t->fn( t->arg );
+        
+        pthread_mutex_lock( &run->lock );
+        t->t1 = jam_axi_graph_now() - run->t0;
+        t->state = 2;
+        run->ndone++;
+        pthread_cond_broadcast( &run->cond );
+        
+    }
+    pthread_mutex_unlock( &run->lock );
+    
+    return NULL;
+    
+}
+
+
+void jam_axi_graph_run( struct jam_graph *graph, int nthread ) {
+    
+    struct graph_run run;
+    pthread_t *threads;
+    int i, d, t, nrun;
+    
+    // longest predicted path from each task to the end (dependents always
+    // come later, so one backward pass will do)
+    for ( i = 0; i < graph->ntask; i++ ) {
+        graph->task[i].rank = graph->task[i].cost;
+        graph->task[i].state = 0;
+    }
+    for ( i = graph->ntask - 1; i >= 0; i-- ) \
+        for ( d = 0; d < graph->task[i].ndep; d++ ) {
+            t = graph->task[i].dep[d];
+            if ( graph->task[t].cost + graph->task[i].rank \
+                    > graph->task[t].rank ) graph->task[t].rank = \
+                graph->task[t].cost + graph->task[i].rank;
+        }
+        
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread > graph->ntask ) nthread = graph->ntask;
+    if ( nthread < 1 ) nthread = 1;
+    
+    run.graph = graph;
+    run.ndone = 0;
+    run.t0 = jam_axi_graph_now();
+    pthread_mutex_init( &run.lock, NULL );
+    pthread_cond_init( &run.cond, NULL );
+    
+    // the calling thread is one of the workers
+    threads = (pthread_t *) malloc( nthread * sizeof( pthread_t ) );
+    if ( threads == NULL ) nthread = 1;
+    // a thread that cannot be created stops the rest, and those running
+    // (at least the calling thread) take on its share of the work
+    for ( nrun = 1; nrun < nthread; nrun++ ) if ( pthread_create( \
+        &threads[nrun], NULL, jam_axi_graph_worker, &run ) != 0 ) break;
+    jam_axi_graph_worker( &run );
+    for ( t = 1; t < nrun; t++ ) pthread_join( threads[t], NULL );
+    
+    graph->wall = jam_axi_graph_now() - run.t0;
+    
+    free( threads );
+    pthread_mutex_destroy( &run.lock );
+    pthread_cond_destroy( &run.cond );
+    
+}
+
+
+double jam_axi_graph_path( struct jam_graph *graph, int *path, int *npath ) {
+    
+    double *fin, f, len = -1.;
+    int i, d, last, *prev;
+    
+    *npath = 0;
+    if ( graph->ntask == 0 ) return 0.;
+    
+    // longest chain of measured times ending at each task
+    fin = (double *) malloc( graph->ntask * sizeof( double ) );
+    prev = (int *) malloc( graph->ntask * sizeof( int ) );
+    last = 0;
+    for ( i = 0; i < graph->ntask; i++ ) {
+        f = 0.;
+        prev[i] = -1;
+        for ( d = 0; d < graph->task[i].ndep; d++ ) \
+            if ( fin[graph->task[i].dep[d]] > f ) {
+                f = fin[graph->task[i].dep[d]];
+                prev[i] = graph->task[i].dep[d];
+            }
+        fin[i] = f + graph->task[i].t1 - graph->task[i].t0;
+        if ( fin[i] > len ) {
+            len = fin[i];
+            last = i;
+        }
+    }
+    
+    // walk back from the end of the longest chain
+    for ( i = last; i >= 0; i = prev[i] ) path[(*npath)++] = i;
+    for ( i = 0; i < *npath / 2; i++ ) {
+        d = path[i];
+        path[i] = path[*npath-1-i];
+        path[*npath-1-i] = d;
+    }
+    
+    free( fin );
+    free( prev );
+    
+    return len;
+    
+}
+
+
+void jam_axi_graph_free( struct jam_graph *graph ) {
+    
+    free( graph->task );
+    graph->task = NULL;
+    graph->ntask = graph->maxtask = 0;
+    
+}
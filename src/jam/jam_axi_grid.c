@@ -0,0 +1,170 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_GRID
+    
+    Sets up the polar interpolation grid for a set of projected positions,
+    along with the elliptical radius and eccentric anomaly of each position.
+    The grid depends only on the positions and the tracer MGE, so it can be
+    shared by all models with the same tracer.
+    
+    jam_axi_grid_spec sets up the nodes of a spectral expansion over the same
+    range instead (Chebyshev points in log radius, midpoints in eccentric
+    anomaly, see interp2dspec), on which nrad and nang are the numbers of
+    radial and angular terms.
+    
+    jam_axi_grid_nodes sets up the nodes alone, for a radial range and a
+    median flattening (grid->qmed) that are already known, and leaves the
+    positions (r, e and nxy) to the caller.
+    
+    The elliptical radii and eccentric anomalies of the positions, which
+    grow with their number, come from ws if it is given and are given back
+    by jam_axi_grid_free; the nodes are always allocated.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      lum   : projected luminous MGE
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      lopad : padding of inner grid radius [log pc]
+      hipad : padding of outer grid radius [log pc]
+      ws    : workspace (or NULL, see jam_axi_ws)
+      
+    INPUTS (jam_axi_grid_nodes)
+      grid  : grid structure to fill, with qmed set
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      rmin  : smallest elliptical radius to cover [pc]
+      rmax  : largest elliptical radius to cover [pc]
+      lopad : padding of inner grid radius [log pc]
+      hipad : padding of outer grid radius [log pc]
+      spec  : set for the nodes of a spectral expansion
+    
+  Mark den Brok
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../tools/tools.h"
+#include "../interp/interp.h"
+
+
+// elliptical radius and eccentric anomaly of the inputs, and their range
+static void jam_axi_grid_pos( double *xp, double *yp, int nxy, \
+        struct multigaussexp *lum, struct jam_grid *grid, double *rmin, \
+        double *rmax, struct jam_workspace *ws ) {
+    
+    int i;
+    
+    grid->nxy = nxy;
+    grid->qmed = mge_qmed( lum, maximum( xp, nxy ) );
+    grid->ws = ws;
+    grid->r = jam_axi_ws_buf( ws, JAM_WS_GR, nxy * sizeof( double ) );
+    grid->e = jam_axi_ws_buf( ws, JAM_WS_GE, nxy * sizeof( double ) );
+    for ( i = 0; i < nxy; i++ ) {
+        grid->r[i] = sqrt( pow( xp[i], 2. ) + pow( yp[i] / grid->qmed, 2. ) );
+        grid->e[i] = atan2( yp[i] / grid->qmed, xp[i] );
+    }
+    *rmin = minimum( grid->r, nxy );
+    *rmax = maximum( grid->r, nxy );
+    
+}
+
+
+void jam_axi_grid_nodes( struct jam_grid *grid, int nrad, int nang, \
+        double rmin, double rmax, double lopad, double hipad, int spec ) {
+    
+    double step, *lograd;
+    int i, j;
+    
+    grid->nrad = nrad;
+    grid->nang = nang;
+    grid->npol = nrad * nang;
+    grid->spec = spec;
+    
+    // set interpolation grid parameters
+    step = rmin;
+    if ( step <= 0.001 ) step = 0.001;          // minimum radius of 0.001 pc
+    
+    // make linear grid in log of elliptical radius
+    lograd = range( log( step ) + lopad, log( rmax ) + hipad, nrad, False );
+    grid->lrmin = log( step ) + lopad;
+    grid->lrmax = log( rmax ) + hipad;
+    grid->rad = (double *) malloc( nrad * sizeof( double ) );
+    for ( i = 0; i < nrad; i++ ) grid->rad[i] = exp( lograd[i] );
+    
+    // make linear grid in eccentric anomaly
+    grid->ang = range( -M_PI, -M_PI / 2., nang, False );
+    grid->angvec = range( -M_PI, M_PI, 4 * nang - 3, False );
+    
+    // or move the nodes for a spectral expansion
+    if ( spec ) interp2dspec_nodes( grid->lrmin, grid->lrmax, nrad, nang, \
+        grid->rad, grid->ang );
+    
+    // convert grid to cartesians
+    grid->xpol = (double *) malloc( grid->npol * sizeof( double ) );
+    grid->ypol = (double *) malloc( grid->npol * sizeof( double ) );
+    for ( i = 0; i < nrad; i++ ) {
+        for ( j = 0; j < nang; j++ ) {
+            grid->xpol[i*nang+j] = grid->rad[i] * cos( grid->ang[j] );
+            grid->ypol[i*nang+j] = grid->rad[i] * sin( grid->ang[j] ) \
+                * grid->qmed;
+        }
+    }
+    
+    free( lograd );
+    
+}
+
+
+struct jam_grid jam_axi_grid( double *xp, double *yp, int nxy, \
+        struct multigaussexp *lum, int nrad, int nang, double lopad, \
+        double hipad, struct jam_workspace *ws ) {
+    
+    struct jam_grid grid;
+    double rmin, rmax;
+    
+    jam_axi_grid_pos( xp, yp, nxy, lum, &grid, &rmin, &rmax, ws );
+    jam_axi_grid_nodes( &grid, nrad, nang, rmin, rmax, lopad, hipad, 0 );
+    
+    return grid;
+    
+}
+
+
+struct jam_grid jam_axi_grid_spec( double *xp, double *yp, int nxy, \
+        struct multigaussexp *lum, int nrad, int nang, double lopad, \
+        double hipad, struct jam_workspace *ws ) {
+    
+    struct jam_grid grid;
+    double rmin, rmax;
+    
+    jam_axi_grid_pos( xp, yp, nxy, lum, &grid, &rmin, &rmax, ws );
+    jam_axi_grid_nodes( &grid, nrad, nang, rmin, rmax, lopad, hipad, 1 );
+    
+    return grid;
+    
+}
+
+
+void jam_axi_grid_free( struct jam_grid *grid ) {
+    
+    free( grid->rad );
+    free( grid->ang );
+    free( grid->angvec );
+    free( grid->xpol );
+    free( grid->ypol );
+    jam_axi_ws_put( grid->ws, grid->r );
+    jam_axi_ws_put( grid->ws, grid->e );
+    
+}
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_GSL
+    
+    Turns off the default GSL error handler, which aborts the program, so
+    that a failed integral is reported by its return code (and counted in
+    the integration flag) instead.  This is done only once per process,
+    however many threads call it at the same time, and a handler that the
+    caller has installed is left in place.
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <gsl/gsl_errno.h>
+#include "jam.h"
+
+
+static pthread_once_t jam_axi_gsl_once = PTHREAD_ONCE_INIT;
+
+
+static void jam_axi_gsl_off( void ) {
+    
+    gsl_error_handler_t *old;
+    
+    // restore the caller's own handler, if there was one
+    old = gsl_set_error_handler_off();
+    if ( old != NULL ) gsl_set_error_handler( old );
+    
+}
+
+
+void jam_axi_gsl_init( void ) {
+    
+    pthread_once( &jam_axi_gsl_once, jam_axi_gsl_off );
+    
+}
@@ -0,0 +1,75 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_INTERP
+    
+    Interpolates a moment map given on one quadrant of the polar grid to the
+    input positions of the grid.  The positions are folded onto the quadrant
+    using the symmetry of the moment: s1 is the sign picked up on reflection
+    about the minor axis and s2 the sign picked up on rotation by pi (the
+    sign on reflection about the major axis is then s1*s2).  Second moments
+    have s1=s2=1; first moments have s1=1, s2=-1 for vx and s1=s2=-1 for vy
+    and vz.  The interpolation uses bicubic patches precomputed once for the
+    map (see interp2dquad), so the cost per position does not depend on the
+    size of the grid; the patches are made in opts->ws, if it is set.  On a
+    grid from jam_axi_grid_spec the spectral expansion is summed instead
+    (see interp2dspec), and the relative size of its last coefficients is
+    reported in opts->err.
+    
+    INPUTS
+      grid : polar grid from jam_axi_grid or jam_axi_grid_spec
+      quad : moment on the quadrant grid points [nrad*nang]
+      s1   : sign on reflection about the minor axis
+      s2   : sign on rotation by pi
+      mu   : array [grid->nxy] to hold the moment at the input positions
+      opts : evaluation options (or NULL for defaults)
+    
+  Mark den Brok
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "jam.h"
+#include "../interp/interp.h"
+
+
+void jam_axi_interp( struct jam_grid *grid, double *quad, int s1, int s2, \
+        double *mu, struct jam_opts *opts ) {
+    
+    struct interp2dquad ip;
+    struct interp2dspec sp;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    double tail, *work;
+    
+    // sum the spectral expansion, and report its convergence
+    if ( grid->spec ) {
+        interp2dspec_init( &sp, quad, grid->lrmin, grid->lrmax, grid->nrad, \
+            grid->nang, s1, s2 );
+        interp2dspec_eval( &sp, grid->r, grid->e, grid->nxy, mu );
+        if ( opts != NULL ) {
+            tail = interp2dspec_tail( &sp );
+            if ( tail > opts->err ) opts->err = tail;
+            if ( grid->npol > opts->npol ) opts->npol = grid->npol;
+        }
+        interp2dspec_free( &sp );
+        return;
+    }
+    
+    // patch coefficients on the quadrant, in the workspace if there is one
+    work = ( ws == NULL ) ? NULL : jam_axi_ws_buf( ws, JAM_WS_IQUAD, \
+        interp2dquad_work( grid->nrad, grid->nang ) * sizeof( double ) );
+    interp2dquad_init( &ip, quad, grid->rad, grid->ang, grid->nrad, \
+        grid->nang, s1, s2, work );
+    
+    // interpolate to input positions
+    interp2dquad_eval( &ip, grid->r, grid->e, grid->nxy, mu );
+    
+    interp2dquad_free( &ip );
+    jam_axi_ws_put( ws, work );
+    
+}
@@ -0,0 +1,704 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_MAP
+    
+    Calculates moment maps on a regular Cartesian grid of pixels, e.g. for
+    comparison with an IFU cube or for mock images, from a specification of
+    the grid rather than a list of positions.  Pixel (i,j) is centred on
+    x' = x0 + i dx, y' = y0 + j dy and the maps are stored row by row, so
+    that pixel (i,j) is element j*nx+i.
+    
+    The moments have the symmetry of the projected model about both axes,
+    so only one pixel of each set of mirror images about the axes (where the
+    pixel grid has them) is calculated and the others are copied with the
+    appropriate sign.  The coordinates are separable, so elliptical radius,
+    eccentric anomaly and surface density are built from quantities computed
+    once per column and once per row.  The interpolation grid (or spectral
+    nodes, or adaptive grid, following opts) is set up once, and the pixels
+    are then interpolated in tiles of JAM_MAP_TILE x JAM_MAP_TILE shared out
+    between threads.  Small maps, where interpolation does not pay, are
+    calculated directly (see jam_axi_plan_grid).  Each thread works in a
+    workspace of its own (see jam_axi_ws), which is kept in opts->ws, if it
+    is set, for the next map.  The integration status and error estimate at
+    each position (opts->posflag and opts->poserr) are not reported for
+    maps.
+    
+    jam_axi_rms_map calculates one second moment map, jam_axi_vel_map the
+    three first moment maps, and jam_axi_map_write writes maps to a FITS
+    image (a cube if there is more than one map).
+    
+    INPUTS
+      img     : pixel grid
+      incl    : inclination [radians]
+      lum     : projected luminous MGE
+      pot     : projected potential MGE
+      beta    : velocity anisotropy (1 - vz^2 / vR^2)
+      kappa   : rotation parameter (first moments only)
+      nrad    : number of radial bins in interpolation grid
+      nang    : number of angular bins in interpolation grid
+      vv      : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz,
+                6=yz; second moments only)
+      nthread : number of threads (0 for one, negative to use all
+                available processors)
+      integrationFlag : integration flag
+      map     : array of nx*ny values to hold the second moments, or
+                velocity structure with arrays of nx*ny values allocated
+                to hold the first moments
+      opts    : evaluation options (or NULL for defaults)
+      
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check for a model that cannot be
+      deprojected (the maps are then left untouched), JAM_ERR_INPUT for an
+      invalid vv, JAM_ERR_INTEGRAL if the integration flag is set, or
+      JAM_ERR_CANCEL or JAM_ERR_BUDGET if the calculation was stopped (see
+      jam_axi_stop), in which case the maps are not meaningful.
+      
+    INPUTS (jam_axi_map_write)
+      file    : path to output FITS file
+      img     : pixel grid
+      maps    : nmap arrays of nx*ny values
+      nmap    : number of maps
+      
+    OUTPUTS (jam_axi_map_write)
+      JAM_OK, or JAM_ERR_IO if the file cannot be written in full (a
+      partly written file is removed).
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+// pixels along one axis that are calculated, and their mirror images
+struct map_axis {
+    int np, *pix, *mirror;
+    double *c;
+};
+
+// work shared between threads
+struct map_work {
+    struct jam_image *img;
+    struct map_axis ax, ay;
+    struct jam_grid *grid;
+    struct jam_opts *opts;
+    struct jam_workspace *ws;
+    double *quad, *val, *x2, *yq, *yq2, *ex, *ey, *area, **map;
+    int nmap, ncomp, s1[3], s2[3], m1[3], m2[3], fix, sgn, zero, ntx, ntile;
+    int next, nstart;
+    pthread_mutex_t lock;
+};
+
+
+static void jam_axi_map_axis( struct map_axis *a, int n, double c0, \
+        double d ) {
+        
+    int i, k, m, mid;
+    double c;
+    
+    a->pix = (int *) malloc( n * sizeof( int ) );
+    a->mirror = (int *) malloc( n * sizeof( int ) );
+    a->c = (double *) malloc( n * sizeof( double ) );
+    
+    // pixel i mirrors pixel mid-i if the axis falls on a pixel centre or
+    // edge
+    c = -2. * c0 / d;
+    mid = ( fabs( c - floor( c + 0.5 ) ) < 1.e-6 ) ? (int) floor( c + 0.5 ) \
+        : -1;
+        
+    // calculate pixels on the negative side, and those on the positive side
+    // that have no mirror image
+    a->np = 0;
+    for ( i = 0; i < n; i++ ) {
+        m = ( mid >= 0 ) ? mid - i : -1;
+        if ( c0 + i * d > 0. && m >= 0 && m < n ) continue;
+        k = a->np++;
+        a->pix[k] = i;
+        a->c[k] = c0 + i * d;
+        a->mirror[k] = ( m != i && m >= 0 && m < n ) ? m : -1;
+    }
+    
+}
+
+
+static void jam_axi_map_axis_free( struct map_axis *a ) {
+    
+    free( a->pix );
+    free( a->mirror );
+    free( a->c );
+    
+}
+
+
+// sign of the xy and xz second moments relative to their folded maps
+static double jam_axi_map_fix( int fix, double x, double y ) {
+    
+    if ( fix == 4 ) return ( x * y >= 0. ) ? -1. : 1.;
+    if ( fix == 5 ) return ( x * y < 0. ) ? -1. : 1.;
+    return 1.;
+    
+}
+
+
+static void *jam_axi_map_worker( void *arg ) {
+    
+    struct map_work *w = arg;
+    struct jam_image *img = w->img;
+    struct jam_grid tg;
+    struct jam_opts opts = { NULL }, *op = &opts;
+    struct jam_workspace wown = { NULL }, *ws;
+    double *r, *e, *res, v, s, sf, z, x, y, xm, ym;
+    int t, i, j, i0, j0, i1, j1, n, l, m, k, kx, ky, px, py, np, nt;
+    
+    // workspace of this thread, kept in that of the caller if there is one
+    pthread_mutex_lock( &w->lock );
+    t = w->nstart++;
+    pthread_mutex_unlock( &w->lock );
+    ws = ( w->ws != NULL ) ? &w->ws[t] : &wown;
+    
+    // private copy of the options, so that threads report separately and
+    // do not each start threads of their own
+    if ( w->opts != NULL ) {
+        opts = *w->opts;
+        opts.npol = 0;
+        opts.err = 0.;
+    }
+    opts.ws = ws;
+    opts.nthread = 1;
+    
+    nt = JAM_MAP_TILE * JAM_MAP_TILE;
+    r = jam_axi_ws_buf( ws, JAM_WS_GR, nt * sizeof( double ) );
+    e = jam_axi_ws_buf( ws, JAM_WS_GE, nt * sizeof( double ) );
+    res = jam_axi_ws_buf( ws, JAM_WS_RES, w->nmap * nt * sizeof( double ) );
+    np = w->ax.np * w->ay.np;
+    
+    while ( 1 ) {
+        
+        // take the next tile
+        pthread_mutex_lock( &w->lock );
+        t = w->next++;
+        pthread_mutex_unlock( &w->lock );
+        if ( t >= w->ntile ) break;
+        
+        i0 = ( t % w->ntx ) * JAM_MAP_TILE;
+        j0 = ( t / w->ntx ) * JAM_MAP_TILE;
+        i1 = ( i0 + JAM_MAP_TILE < w->ax.np ) ? i0 + JAM_MAP_TILE : w->ax.np;
+        j1 = ( j0 + JAM_MAP_TILE < w->ay.np ) ? j0 + JAM_MAP_TILE : w->ay.np;
+        n = ( i1 - i0 ) * ( j1 - j0 );
+        
+        // interpolate to the pixels of the tile
+        if ( w->grid != NULL ) {
+            k = 0;
+            for ( j = j0; j < j1; j++ ) {
+                for ( i = i0; i < i1; i++ ) {
+                    r[k] = sqrt( w->x2[i] + w->yq2[j] );
+                    e[k] = atan2( w->yq[j], w->ax.c[i] );
+                    k++;
+                }
+            }
+            tg = *w->grid;
+            tg.r = r;
+            tg.e = e;
+            tg.nxy = n;
+            for ( m = 0; m < w->nmap; m++ ) jam_axi_interp( &tg, \
+                &w->quad[m*w->grid->npol], w->s1[m], w->s2[m], &res[m*nt], \
+                op );
+        }
+        
+        // or take the values calculated directly
+        else {
+            for ( m = 0; m < w->nmap; m++ ) {
+                k = 0;
+                for ( j = j0; j < j1; j++ ) for ( i = i0; i < i1; i++ ) \
+                    res[m*nt+k++] = w->val[m*np+j*w->ax.np+i];
+            }
+        }
+        
+        // copy each value to the pixel and its mirror images
+        k = 0;
+        for ( j = j0; j < j1; j++ ) {
+            for ( i = i0; i < i1; i++ ) {
+                
+                x = w->ax.c[i];
+                y = w->ay.c[j];
+                
+                // zero where the surface density is zero
+                z = 1.;
+                if ( w->zero ) {
+                    v = 0.;
+                    for ( l = 0; l < w->ncomp; l++ ) v += w->area[l] \
+                        * w->ex[l*w->ax.np+i] * w->ey[l*w->ay.np+j];
+                    if ( v == 0. ) z = 0.;
+                }
+                
+                for ( m = 0; m < w->nmap; m++ ) {
+                    v = z * res[m*nt+k];
+                    sf = w->sgn ? jam_axi_map_fix( w->fix, x, y ) : 1.;
+                    for ( ky = 0; ky < 2; ky++ ) {
+                        py = ky ? w->ay.mirror[j] : w->ay.pix[j];
+                        if ( py < 0 ) continue;
+                        ym = ky ? -y : y;
+                        for ( kx = 0; kx < 2; kx++ ) {
+                            px = kx ? w->ax.mirror[i] : w->ax.pix[i];
+                            if ( px < 0 ) continue;
+                            xm = kx ? -x : x;
+                            
+                            // signs on reflection about each axis, and of
+                            // the xy and xz folded maps
+                            s = 1.;
+                            if ( kx ) s *= w->m1[m];
+                            if ( ky ) s *= w->m1[m] * w->m2[m];
+                            if ( w->fix ) s *= sf * jam_axi_map_fix( \
+                                w->fix, xm, ym );
+                            w->map[m][py*img->nx+px] = s * v;
+                            
+                        }
+                    }
+                }
+                k++;
+                
+            }
+        }
+        
+    }
+    
+    jam_axi_ws_put( ws, r );
+    jam_axi_ws_put( ws, e );
+    jam_axi_ws_put( ws, res );
+    jam_axi_ws_free( &wown );
+    
+    // largest adaptive grid and error over all threads
+    if ( w->opts != NULL ) {
+        pthread_mutex_lock( &w->lock );
+        if ( opts.npol > w->opts->npol ) w->opts->npol = opts.npol;
+        if ( opts.err > w->opts->err ) w->opts->err = opts.err;
+        pthread_mutex_unlock( &w->lock );
+    }
+    
+    return NULL;
+    
+}
+
+
+// pixel axes, and column and row terms of radius and surface density
+static void jam_axi_map_setup( struct map_work *w, struct jam_image *img, \
+        struct multigaussexp *lum, double *qmed ) {
+        
+    int i, j, l;
+    double xmax;
+    
+    w->img = img;
+    jam_axi_map_axis( &w->ax, img->nx, img->x0, img->dx );
+    jam_axi_map_axis( &w->ay, img->ny, img->y0, img->dy );
+    
+    // median flattening as for the positions of all the pixels
+    xmax = img->x0;
+    if ( img->x0 + ( img->nx - 1 ) * img->dx > xmax ) \
+        xmax = img->x0 + ( img->nx - 1 ) * img->dx;
+    *qmed = mge_qmed( lum, xmax );
+    
+    w->x2 = (double *) malloc( w->ax.np * sizeof( double ) );
+    w->yq = (double *) malloc( w->ay.np * sizeof( double ) );
+    w->yq2 = (double *) malloc( w->ay.np * sizeof( double ) );
+    for ( i = 0; i < w->ax.np; i++ ) w->x2[i] = pow( w->ax.c[i], 2. );
+    for ( j = 0; j < w->ay.np; j++ ) {
+        w->yq[j] = w->ay.c[j] / *qmed;
+        w->yq2[j] = pow( w->yq[j], 2. );
+    }
+    
+    // each surface density component is a product of column and row terms
+    w->ncomp = lum->ntotal;
+    w->area = lum->area;
+    w->ex = (double *) malloc( lum->ntotal * w->ax.np * sizeof( double ) );
+    w->ey = (double *) malloc( lum->ntotal * w->ay.np * sizeof( double ) );
+    for ( l = 0; l < lum->ntotal; l++ ) {
+        for ( i = 0; i < w->ax.np; i++ ) w->ex[l*w->ax.np+i] = exp( -0.5 \
+            / pow( lum->sigma[l], 2 ) * w->ax.c[i] * w->ax.c[i] );
+        for ( j = 0; j < w->ay.np; j++ ) w->ey[l*w->ay.np+j] = exp( -0.5 \
+            / pow( lum->sigma[l], 2 ) * pow( w->ay.c[j] / lum->q[l], 2 ) );
+    }
+    
+    w->grid = NULL;
+    w->quad = NULL;
+    w->val = NULL;
+    w->zero = 0;
+    w->fix = 0;
+    w->sgn = 1;
+    w->ntx = ( w->ax.np + JAM_MAP_TILE - 1 ) / JAM_MAP_TILE;
+    w->ntile = w->ntx * ( ( w->ay.np + JAM_MAP_TILE - 1 ) / JAM_MAP_TILE );
+    w->next = 0;
+    pthread_mutex_init( &w->lock, NULL );
+    
+}
+
+
+// polar grid (or spectral nodes) over the range of the calculated pixels
+static void jam_axi_map_grid( struct map_work *w, struct jam_grid *grid, \
+        double qmed, int nrad, int nang, double lopad, double hipad ) {
+        
+    int i;
+    double x2min, x2max, y2min, y2max;
+    
+    x2min = x2max = w->x2[0];
+    for ( i = 1; i < w->ax.np; i++ ) {
+        if ( w->x2[i] < x2min ) x2min = w->x2[i];
+        if ( w->x2[i] > x2max ) x2max = w->x2[i];
+    }
+    y2min = y2max = w->yq2[0];
+    for ( i = 1; i < w->ay.np; i++ ) {
+        if ( w->yq2[i] < y2min ) y2min = w->yq2[i];
+        if ( w->yq2[i] > y2max ) y2max = w->yq2[i];
+    }
+    
+    grid->qmed = qmed;
+    grid->nxy = 0;
+    grid->r = NULL;
+    grid->e = NULL;
+    grid->ws = NULL;
+    jam_axi_grid_nodes( grid, nrad, nang, sqrt( x2min + y2min ), \
+        sqrt( x2max + y2max ), lopad, hipad, \
+        w->opts != NULL && w->opts->spectral );
+        
+}
+
+
+// positions of the calculated pixels, for direct calculation
+static void jam_axi_map_pos( struct map_work *w, double **xp, double **yp ) {
+    
+    int i, j, n = w->ax.np * w->ay.np;
+    
+    *xp = (double *) malloc( n * sizeof( double ) );
+    *yp = (double *) malloc( n * sizeof( double ) );
+    for ( j = 0; j < w->ay.np; j++ ) {
+        for ( i = 0; i < w->ax.np; i++ ) {
+            (*xp)[j*w->ax.np+i] = w->ax.c[i];
+            (*yp)[j*w->ax.np+i] = w->ay.c[j];
+        }
+    }
+    
+}
+
+
+static void jam_axi_map_run( struct map_work *w, int nthread ) {
+    
+    pthread_t *threads;
+    struct jam_workspace *ws = w->opts == NULL ? NULL : w->opts->ws;
+    int t, nrun;
+    
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread > w->ntile ) nthread = w->ntile;
+    if ( nthread < 1 ) nthread = 1;
+    threads = jam_axi_ws_buf( ws, JAM_WS_THREADS, \
+        nthread * sizeof( pthread_t ) );
+    if ( threads == NULL ) nthread = 1;
+    
+    // each thread has a workspace of its own, kept in the caller's
+    w->ws = jam_axi_ws_split( ws, nthread );
+    w->nstart = 0;
+    // a thread that cannot be created stops the rest, and those running
+    // (at least the calling thread) take on its share of the work
+    for ( nrun = 1; nrun < nthread; nrun++ ) if ( pthread_create( \
+        &threads[nrun], NULL, &jam_axi_map_worker, w ) != 0 ) break;
+    jam_axi_map_worker( w );
+    for ( t = 1; t < nrun; t++ ) pthread_join( threads[t], NULL );
+    jam_axi_ws_put( ws, threads );
+    
+}
+
+
+static void jam_axi_map_free( struct map_work *w ) {
+    
+    pthread_mutex_destroy( &w->lock );
+    jam_axi_map_axis_free( &w->ax );
+    jam_axi_map_axis_free( &w->ay );
+    free( w->x2 );
+    free( w->yq );
+    free( w->yq2 );
+    free( w->ex );
+    free( w->ey );
+    
+}
+
+
+enum jam_status jam_axi_rms_map( struct jam_image *img, double incl, \
+        struct multigaussexp *lum, struct multigaussexp *pot, double *beta, \
+        int nrad, int nang, int vv, int nthread, int* integrationFlag, \
+        double *map, struct jam_opts *opts ) {
+        
+    struct map_work w;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_grid grid, agrid, *gp;
+    struct jam_opts o;
+    double qmed, *surf, *surfpol, *xp, *yp;
+    int n, spec, own;
+    enum jam_status status;
+    struct jam_stop stop;
+    
+    // check that integration flag is zero or don't proceed
+    if ( *integrationFlag != 0 ) return JAM_ERR_INTEGRAL;
+    
+    // check that the model can be deprojected before doing any work
+    if ( vv < 1 || vv > 6 ) return JAM_ERR_INPUT;
+    status = jam_axi_terms_check( lum, pot, incl, beta );
+    if ( status != JAM_OK ) return status;
+    
+    own = jam_axi_stop_start( &stop, opts );
+    w.opts = opts;
+    jam_axi_map_setup( &w, img, lum, &qmed );
+    n = w.ax.np * w.ay.np;
+    w.nmap = 1;
+    w.map = &map;
+    w.s1[0] = w.s2[0] = w.m1[0] = w.m2[0] = 1;
+    if ( vv == 4 || vv == 5 ) w.fix = vv;
+    
+    lt = jam_axi_lumterms( lum, incl, beta, NULL );
+    pt = jam_axi_potterms( pot, incl );
+    
+    // second moment on the interpolation grid
+    if ( jam_axi_plan_grid( n, lum, pot->ntotal, nrad, nang, 0, opts ) ) {
+        jam_axi_map_grid( &w, &grid, qmed, nrad, nang, log( 0.99 ), \
+            log( 1.01 ) );
+        surfpol = mge_surf( lum, grid.xpol, grid.ypol, grid.npol );
+        w.quad = jam_axi_rms_quad( &grid, &lt, &pt, incl, surfpol, vv, \
+            integrationFlag, &agrid, &gp, opts );
+        w.grid = gp;
+        w.zero = 1;
+        
+        // the xy and xz moments on a spectral grid come out signed,
+        // otherwise they are signed pixel by pixel
+        spec = gp->spec && ( vv == 4 || vv == 5 );
+        if ( spec ) w.s1[0] = -1;
+        else w.sgn = 0;
+        
+        jam_axi_map_run( &w, nthread );
+        
+        if ( gp != &grid ) jam_axi_grid_free( &agrid );
+        jam_axi_grid_free( &grid );
+        free( surfpol );
+        free( w.quad );
+    }
+    
+    // or directly at the calculated pixels
+    else {
+        jam_axi_map_pos( &w, &xp, &yp );
+        surf = mge_surf( lum, xp, yp, n );
+        w.val = (double *) malloc( n * sizeof( double ) );
+        if ( opts != NULL ) {
+            o = *opts;
+            o.posflag = NULL;
+            o.poserr = NULL;
+        }
+        jam_axi_rms_eval( xp, yp, n, incl, &lt, &pt, NULL, surf, NULL, vv, \
+            integrationFlag, w.val, opts == NULL ? NULL : &o );
+        jam_axi_map_run( &w, nthread );
+        free( w.val );
+        free( surf );
+        free( xp );
+        free( yp );
+    }
+    
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    jam_axi_map_free( &w );
+    
+    status = ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    return jam_axi_stop_end( &stop, opts, own, status );
+    
+}
+
+
+enum jam_status jam_axi_vel_map( struct jam_image *img, double incl, \
+        struct multigaussexp *lum, struct multigaussexp *pot, double *beta, \
+        double *kappa, int nrad, int nang, int nthread, int* integrationFlag, \
+        struct jam_vel *map, struct jam_opts *opts ) {
+        
+    struct map_work w;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_grid grid, agrid, *gp;
+    struct jam_opts o;
+    double qmed, *surf, *surfpol, *xp, *yp, *mp[3];
+    int i, n, m, own;
+    enum jam_status status;
+    struct jam_stop stop;
+    
+    // check that integration flag is zero or don't proceed
+    if ( *integrationFlag != 0 ) return JAM_ERR_INTEGRAL;
+    
+    // check that the model can be deprojected before doing any work
+    status = jam_axi_terms_check( lum, pot, incl, beta );
+    if ( status != JAM_OK ) return status;
+    
+    // check for at least 1 rotating, non-spherical, non-isotropic component
+    if ( jam_axi_vel_check( lum, pot, beta, kappa ) == 0 ) {
+        for ( i = 0; i < img->nx * img->ny; i++ ) {
+            map->vx[i] = 0.;
+            map->vy[i] = 0.;
+            map->vz[i] = 0.;
+        }
+        return JAM_OK;
+    }
+    
+    own = jam_axi_stop_start( &stop, opts );
+    w.opts = opts;
+    jam_axi_map_setup( &w, img, lum, &qmed );
+    n = w.ax.np * w.ay.np;
+    w.nmap = 3;
+    mp[0] = map->vx;
+    mp[1] = map->vy;
+    mp[2] = map->vz;
+    w.map = mp;
+    for ( m = 0; m < 3; m++ ) {
+        w.s1[m] = w.m1[m] = ( m == 0 ) ? 1 : -1;
+        w.s2[m] = w.m2[m] = -1;
+    }
+    
+    lt = jam_axi_lumterms( lum, incl, beta, kappa );
+    pt = jam_axi_potterms( pot, incl );
+    
+    // first moments on the interpolation grid
+    if ( jam_axi_plan_grid( n, lum, pot->ntotal, nrad, nang, 1, opts ) ) {
+        jam_axi_map_grid( &w, &grid, qmed, nrad, nang, -0.1, 0.1 );
+        surfpol = mge_surf( lum, grid.xpol, grid.ypol, grid.npol );
+        w.quad = jam_axi_vel_quad( &grid, &lt, &pt, incl, surfpol, \
+            integrationFlag, &agrid, &gp, opts );
+        w.grid = gp;
+        jam_axi_map_run( &w, nthread );
+        if ( gp != &grid ) jam_axi_grid_free( &agrid );
+        jam_axi_grid_free( &grid );
+        free( surfpol );
+        free( w.quad );
+    }
+    
+    // or directly at the calculated pixels
+    else {
+        jam_axi_map_pos( &w, &xp, &yp );
+        surf = mge_surf( lum, xp, yp, n );
+        w.val = (double *) malloc( 3 * n * sizeof( double ) );
+        if ( opts != NULL ) {
+            o = *opts;
+            o.posflag = NULL;
+            o.poserr = NULL;
+        }
+        jam_axi_vel_eval( xp, yp, n, incl, &lt, &pt, NULL, surf, NULL, \
+            integrationFlag, w.val, &w.val[n], &w.val[2*n], \
+            opts == NULL ? NULL : &o );
+        jam_axi_map_run( &w, nthread );
+        free( w.val );
+        free( surf );
+        free( xp );
+        free( yp );
+    }
+    
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    jam_axi_map_free( &w );
+    
+    status = ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    return jam_axi_stop_end( &stop, opts, own, status );
+    
+}
+
+
+// one 80-character FITS header card
+static void jam_axi_map_card( char *hdr, int *ncard, char *key, char *val ) {
+    
+    char card[81];
+    
+    // strings start in column 11, other values end in column 30
+    if ( val[0] == '\'' ) snprintf( card, 81, "%-8.8s= %s", key, val );
+    else snprintf( card, 81, "%-8.8s= %20s", key, val );
+    memset( card + strlen( card ), ' ', 80 - strlen( card ) );
+    memcpy( hdr + 80 * ( *ncard )++, card, 80 );
+    
+}
+
+
+enum jam_status jam_axi_map_write( char *file, struct jam_image *img, \
+        double **maps, int nmap ) {
+        
+    FILE *fp;
+    char *hdr, val[32];
+    unsigned char *b, *p;
+    int i, j, m, k, ncard = 0, nblock, big, ok;
+    long n, npad;
+    double one = 1.;
+    
+    fp = fopen( file, "wb" );
+    if ( fp == NULL ) return JAM_ERR_IO;
+    
+    // header: 36 cards per 2880-byte block
+    hdr = (char *) malloc( 2880 );
+    memset( hdr, ' ', 2880 );
+    jam_axi_map_card( hdr, &ncard, "SIMPLE", "T" );
+    jam_axi_map_card( hdr, &ncard, "BITPIX", "-64" );
+    snprintf( val, 32, "%d", ( nmap > 1 ) ? 3 : 2 );
+    jam_axi_map_card( hdr, &ncard, "NAXIS", val );
+    snprintf( val, 32, "%d", img->nx );
+    jam_axi_map_card( hdr, &ncard, "NAXIS1", val );
+    snprintf( val, 32, "%d", img->ny );
+    jam_axi_map_card( hdr, &ncard, "NAXIS2", val );
+    if ( nmap > 1 ) {
+        snprintf( val, 32, "%d", nmap );
+        jam_axi_map_card( hdr, &ncard, "NAXIS3", val );
+    }
+    
+    // pixel coordinates in pc
+    jam_axi_map_card( hdr, &ncard, "CRPIX1", "1.0" );
+    snprintf( val, 32, "%.15G", img->x0 );
+    jam_axi_map_card( hdr, &ncard, "CRVAL1", val );
+    snprintf( val, 32, "%.15G", img->dx );
+    jam_axi_map_card( hdr, &ncard, "CDELT1", val );
+    jam_axi_map_card( hdr, &ncard, "CUNIT1", "'pc      '" );
+    jam_axi_map_card( hdr, &ncard, "CRPIX2", "1.0" );
+    snprintf( val, 32, "%.15G", img->y0 );
+    jam_axi_map_card( hdr, &ncard, "CRVAL2", val );
+    snprintf( val, 32, "%.15G", img->dy );
+    jam_axi_map_card( hdr, &ncard, "CDELT2", val );
+    jam_axi_map_card( hdr, &ncard, "CUNIT2", "'pc      '" );
+    memcpy( hdr + 80 * ncard, "END", 3 );
+    ok = fwrite( hdr, 1, 2880, fp ) == 2880;
+    
+    // data: big-endian doubles, padded to a whole number of blocks
+    p = (unsigned char *) &one;
+    big = ( p[0] == 0x3f );
+    n = (long) img->nx * img->ny;
+    b = (unsigned char *) malloc( 8 * img->nx );
+    for ( m = 0; ok && m < nmap; m++ ) {
+        for ( j = 0; ok && j < img->ny; j++ ) {
+            for ( i = 0; i < img->nx; i++ ) {
+                p = (unsigned char *) &maps[m][j*img->nx+i];
+                for ( k = 0; k < 8; k++ ) b[8*i+k] = big ? p[k] : p[7-k];
+            }
+            ok = fwrite( b, 1, 8 * img->nx, fp ) == (size_t) ( 8 * img->nx );
+        }
+    }
+    free( b );
+    nblock = (int) ( ( 8 * n * nmap + 2879 ) / 2880 );
+    npad = 2880L * nblock - 8 * n * nmap;
+    memset( hdr, 0, 2880 );
+    ok = ok && fwrite( hdr, 1, npad, fp ) == (size_t) npad;
+    free( hdr );
+    
+    // a file that could not be written in full is removed
+    if ( !ok ) fclose( fp );
+    else ok = fclose( fp ) == 0;
+    if ( !ok ) {
+        remove( file );
+        return JAM_ERR_IO;
+    }
+    return JAM_OK;
+    
+}
@@ -0,0 +1,398 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_MMT
+    
+    Calculates the first moments and all six second moments of one model as
+    a task graph (see jam_axi_graph), so that the independent stages run at
+    the same time on opts->nthread threads: the potential terms, the tracer
+    terms, plans, surface densities and interpolation grids for the first
+    and for the second moments, and then, for each moment, the integrals on
+    the grid with the interpolation, the direct integrals and the gathering
+    of the two into the output.  This gives a speed-up on several cores even
+    for a few positions, where sharing out the positions themselves is too
+    fine-grained.  Each moment is calculated exactly as by jam_axi_vel_mmt
+    and jam_axi_rms_mmt.
+    
+    The tasks are started in order of their predicted path to the end of the
+    graph, using the cost model of jam_axi_plan, so the expensive first
+    moment integrals start first.  The second moment integrals are each done
+    on one thread; the first moment integrals, which usually dominate, are
+    still shared out between opts->nthread threads of their own.  If graph
+    is not NULL, the graph that was run is left there so that the caller can
+    look at the times of the tasks and the critical path with
+    jam_axi_graph_path (only the names and times of the tasks should be
+    used); free it with jam_axi_graph_free.  The report members of opts
+    hold the largest values over all the moments, except the sentinel
+    errors, which are kept for each moment in sentmax and sentrms in the
+    order vx, vy, vz, xx, yy, zz, xy, xz, yz; opts->posflag and
+    opts->poserr, if set, hold the worst over all the moments (see
+    jam_axi_rms_eval).
+    
+    As the tasks run side by side, they cannot share a workspace: if
+    opts->ws is set, it is split (see jam_axi_ws_split) into one for the
+    plan and grid of each order of moment and one for each of the integrals
+    on the grid and direct integrals of each moment, so that a sampler that
+    calls this over and over reuses their memory.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      kappa : rotation parameter
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      vm    : structure of arrays [nxy] to hold the first moments, or NULL
+              to calculate only the second moments
+      rms   : six arrays [nxy] to hold the xx, yy, zz, xy, xz and yz second
+              moments
+      graph : task graph structure to hold the graph that was run (or NULL)
+      opts  : evaluation options (or NULL for defaults)
+      
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check if the model cannot be
+      deprojected (checked before any work is done, and then no graph is
+      run), JAM_ERR_INTEGRAL if the integration flag is set, or
+      JAM_ERR_CANCEL or JAM_ERR_BUDGET if the calculation was stopped (see
+      jam_axi_stop), in which case the moments are incomplete.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+// what is shared by the moments of one order
+struct mmt_part {
+    struct multigaussexp *lum, *pot;
+    struct jam_potterms *pt;
+    struct jam_lumterms lt;
+    struct jam_plan plan;
+    struct jam_grid grid;
+    struct jam_opts o;
+    double *xp, *yp, incl, *beta, *kappa, *surf, *surfpol;
+    int nxy, nrad, nang, vel;
+};
+
+
+// one moment
+struct mmt_task {
+    struct mmt_part *p;
+    struct jam_opts o, od;
+    double *res, *mu[3], *pe;
+    int vv, flag[2], *pf;
+};
+
+
+// the data for the potential terms task
+struct mmt_pot {
+    struct multigaussexp *pot;
+    struct jam_potterms pt;
+    double incl;
+};
+
+
+static void jam_axi_mmt_pot( void *arg ) {
+    
+    struct mmt_pot *mp = arg;
+    
+    mp->pt = jam_axi_potterms( mp->pot, mp->incl );
+    
+}
+
+
+static void jam_axi_mmt_terms( void *arg ) {
+    
+    struct mmt_part *p = arg;
+    
+    p->lt = jam_axi_lumterms( p->lum, p->incl, p->beta, \
+        p->vel ? p->kappa : NULL );
+        
+}
+
+
+static void jam_axi_mmt_plan( void *arg ) {
+    
+    struct mmt_part *p = arg;
+    
+    jam_axi_plan( &p->plan, p->xp, p->yp, p->nxy, p->lum, p->pot->ntotal, \
+        p->nrad, p->nang, p->vel, &p->o );
+        
+}
+
+
+// surface brightness at all positions (second moments) or at the positions
+// to calculate directly (first moments)
+static void jam_axi_mmt_surf( void *arg ) {
+    
+    struct mmt_part *p = arg;
+    int ng = p->plan.ngrid;
+    
+    p->surf = NULL;
+    if ( !p->vel ) p->surf = mge_surf( p->lum, p->plan.xp, p->plan.yp, \
+        p->nxy );
+    else if ( p->plan.ndirect > 0 ) p->surf = mge_surf( p->lum, \
+        &p->plan.xp[ng], &p->plan.yp[ng], p->plan.ndirect );
+        
+}
+
+
+// interpolation grid (or spectral nodes), and surface brightness on it
+static void jam_axi_mmt_grid( void *arg ) {
+    
+    struct mmt_part *p = arg;
+    double lo = p->vel ? -0.1 : log( 0.99 ), hi = p->vel ? 0.1 : log( 1.01 );
+    int ng = p->plan.ngrid;
+    
+    p->surfpol = NULL;
+    if ( ng == 0 ) return;
+    if ( p->o.spectral ) p->grid = jam_axi_grid_spec( p->plan.xp, \
+        p->plan.yp, ng, p->lum, p->nrad, p->nang, lo, hi, p->o.ws );
+    else p->grid = jam_axi_grid( p->plan.xp, p->plan.yp, ng, p->lum, \
+        p->nrad, p->nang, lo, hi, p->o.ws );
+    p->surfpol = mge_surf( p->lum, p->grid.xpol, p->grid.ypol, p->grid.npol );
+    
+}
+
+
+// moment at the positions to interpolate
+static void jam_axi_mmt_ongrid( void *arg ) {
+    
+    struct mmt_task *t = arg;
+    struct mmt_part *p = t->p;
+    int ng = p->plan.ngrid, n = p->nxy;
+    
+    if ( ng == 0 ) return;
+    if ( p->vel ) jam_axi_vel_eval( p->plan.xp, p->plan.yp, ng, p->incl, \
+        &p->lt, p->pt, &p->grid, NULL, p->surfpol, &t->flag[0], t->res, \
+        &t->res[n], &t->res[2*n], &t->o );
+    else jam_axi_rms_eval( p->plan.xp, p->plan.yp, ng, p->incl, &p->lt, \
+        p->pt, &p->grid, p->surf, p->surfpol, t->vv, &t->flag[0], t->res, \
+        &t->o );
+        
+}
+
+
+// moment at the positions to calculate directly
+static void jam_axi_mmt_direct( void *arg ) {
+    
+    struct mmt_task *t = arg;
+    struct mmt_part *p = t->p;
+    int ng = p->plan.ngrid, n = p->nxy;
+    
+    if ( p->plan.ndirect == 0 ) return;
+    t->od.posflag = ( t->pf == NULL ) ? NULL : &t->pf[ng];
+    t->od.poserr = ( t->pe == NULL ) ? NULL : &t->pe[ng];
+    if ( p->vel ) jam_axi_vel_eval( &p->plan.xp[ng], &p->plan.yp[ng], \
+        p->plan.ndirect, p->incl, &p->lt, p->pt, NULL, p->surf, NULL, \
+        &t->flag[1], &t->res[ng], &t->res[n+ng], &t->res[2*n+ng], &t->od );
+    else jam_axi_rms_eval( &p->plan.xp[ng], &p->plan.yp[ng], \
+        p->plan.ndirect, p->incl, &p->lt, p->pt, NULL, &p->surf[ng], NULL, \
+        t->vv, &t->flag[1], &t->res[ng], &t->od );
+        
+}
+
+
+// moments back in the order of the input positions
+static void jam_axi_mmt_put( void *arg ) {
+    
+    struct mmt_task *t = arg;
+    struct mmt_part *p = t->p;
+    int i, k;
+    
+    for ( k = 0; k < ( p->vel ? 3 : 1 ); k++ ) for ( i = 0; i < p->nxy; i++ ) \
+        t->mu[k][p->plan.idx[i]] = t->res[k*p->nxy+i];
+        
+}
+
+
+enum jam_status jam_axi_mmt( double *xp, double *yp, int nxy, double incl, \
+        struct multigaussexp *lum, struct multigaussexp *pot, double *beta, \
+        double *kappa, int nrad, int nang, int* integrationFlag, \
+        struct jam_vel *vm, double **rms, struct jam_graph *graph, \
+        struct jam_opts *opts ) {
+        
+    static char *name[7][3] = { \
+        { "vel on grid", "vel direct", "vel out" }, \
+        { "xx on grid", "xx direct", "xx out" }, \
+        { "yy on grid", "yy direct", "yy out" }, \
+        { "zz on grid", "zz direct", "zz out" }, \
+        { "xy on grid", "xy direct", "xy out" }, \
+        { "xz on grid", "xz direct", "xz out" }, \
+        { "yz on grid", "yz direct", "yz out" } };
+    struct jam_graph g = { NULL };
+    struct jam_cost cost;
+    struct jam_stop stop;
+    struct mmt_pot mp;
+    struct mmt_part part[2];
+    struct mmt_task task[7];
+    struct jam_workspace *ws;
+    double c, cs;
+    enum jam_status status;
+    int i, k, v, nthread, dep[4], tpot, tterms[2], tplan[2], tsurf[2];
+    int tgrid[2], tq, td, vel, own;
+    
+    // check that integration flag is zero or don't proceed
+    if (*integrationFlag!=0) return JAM_ERR_INTEGRAL;
+    
+    // check that the model can be deprojected before doing any work
+    status = jam_axi_terms_check( lum, pot, incl, beta );
+    if ( status != JAM_OK ) return status;
+    
+    // budget for all the moments, shared by the tasks through their options
+    own = jam_axi_stop_start( &stop, opts );
+    
+    if ( opts != NULL && opts->cost != NULL ) cost = *opts->cost;
+    else {
+        cost.rms = JAM_COST_RMS;
+        cost.vel = JAM_COST_VEL;
+        cost.interp = JAM_COST_INTERP;
+    }
+    nthread = opts == NULL ? 0 : opts->nthread;
+    cs = cost.interp * nxy;
+    
+    // first moments only if there is rotation to see
+    vel = vm != NULL && jam_axi_vel_check( lum, pot, beta, kappa ) > 0;
+    if ( vm != NULL && !vel ) for ( i = 0; i < nxy; i++ ) \
+        vm->vx[i] = vm->vy[i] = vm->vz[i] = 0.;
+        
+    // workspaces for the tasks that run side by side: the grid and direct
+    // integrals of each moment, then the plan and grid of each order
+    ws = jam_axi_ws_split( opts == NULL ? NULL : opts->ws, 2 * 7 + 2 );
+    
+    // terms, plans, surface densities and grids
+    mp.pot = pot;
+    mp.incl = incl;
+    tpot = jam_axi_graph_add( &g, "potential terms", jam_axi_mmt_pot, &mp, \
+        cs, 0, NULL );
+    for ( k = !vel; k < 2; k++ ) {
+        part[k].lum = lum;
+        part[k].pot = pot;
+        part[k].pt = &mp.pt;
+        part[k].o = ( opts != NULL ) ? *opts : (struct jam_opts) { NULL };
+        part[k].o.ws = ( ws == NULL ) ? NULL : &ws[2*7+k];
+        part[k].xp = xp;
+        part[k].yp = yp;
+        part[k].incl = incl;
+        part[k].beta = beta;
+        part[k].kappa = kappa;
+        part[k].nxy = nxy;
+        part[k].nrad = nrad;
+        part[k].nang = nang;
+        part[k].vel = ( k == 0 );
+        tterms[k] = jam_axi_graph_add( &g, k == 0 ? "vel terms" : \
+            "rms terms", jam_axi_mmt_terms, &part[k], cs, 0, NULL );
+        tplan[k] = jam_axi_graph_add( &g, k == 0 ? "vel plan" : "rms plan", \
+            jam_axi_mmt_plan, &part[k], cs, 0, NULL );
+        tsurf[k] = jam_axi_graph_add( &g, k == 0 ? "vel surface" : \
+            "rms surface", jam_axi_mmt_surf, &part[k], cs, 1, &tplan[k] );
+        tgrid[k] = jam_axi_graph_add( &g, k == 0 ? "vel grid" : "rms grid", \
+            jam_axi_mmt_grid, &part[k], cs, 1, &tplan[k] );
+    }
+    
+    // each moment: integrals on the grid and directly, then the output
+    for ( v = !vel; v < 7; v++ ) {
+        k = ( v > 0 );
+        task[v].p = &part[k];
+        task[v].o = ( opts != NULL ) ? *opts : (struct jam_opts) { NULL };
+        if ( v > 0 ) task[v].o.nthread = 1;
+        task[v].o.ws = ( ws == NULL ) ? NULL : &ws[2*v];
+        
+        // integration status in the plan order, with the direct integrals
+        // given options (and a workspace) of their own as they run beside
+        // those on the grid
+        task[v].pf = NULL;
+        task[v].pe = NULL;
+        if ( opts != NULL && opts->posflag != NULL ) task[v].pf = \
+            jam_axi_ws_buf( task[v].o.ws, JAM_WS_RFLAG, nxy * sizeof( int ) );
+        if ( opts != NULL && opts->poserr != NULL ) task[v].pe = \
+            jam_axi_ws_buf( task[v].o.ws, JAM_WS_RERR, \
+            nxy * sizeof( double ) );
+        task[v].o.posflag = task[v].pf;
+        task[v].o.poserr = task[v].pe;
+        task[v].od = task[v].o;
+        task[v].od.ws = ( ws == NULL ) ? NULL : &ws[2*v+1];
+        
+        task[v].vv = v;
+        task[v].flag[0] = task[v].flag[1] = 0;
+        task[v].res = jam_axi_ws_buf( task[v].o.ws, JAM_WS_RES, \
+            ( k ? 1 : 3 ) * nxy * sizeof( double ) );
+        if ( k ) task[v].mu[0] = rms[v-1];
+        else {
+            task[v].mu[0] = vm->vx;
+            task[v].mu[1] = vm->vy;
+            task[v].mu[2] = vm->vz;
+        }
+        c = ( k ? cost.rms : cost.vel ) * lum->ntotal * pot->ntotal;
+        dep[0] = tpot;
+        dep[1] = tterms[k];
+        dep[2] = tsurf[k];
+        dep[3] = tgrid[k];
+        tq = jam_axi_graph_add( &g, name[v][0], jam_axi_mmt_ongrid, &task[v], \
+            c * nrad * nang, 4, dep );
+        td = jam_axi_graph_add( &g, name[v][1], jam_axi_mmt_direct, \
+            &task[v], c * JAM_HYBRID_FRAC * nxy, 3, dep );
+        dep[0] = tq;
+        dep[1] = td;
+        jam_axi_graph_add( &g, name[v][2], jam_axi_mmt_put, &task[v], cs, \
+            2, dep );
+    }
+    
+    jam_axi_graph_run( &g, nthread );
+    
+    // integration flags and report members from all the moments
+    if ( opts != NULL && opts->posflag != NULL ) \
+        for ( i = 0; i < nxy; i++ ) opts->posflag[i] = 0;
+    if ( opts != NULL && opts->poserr != NULL ) \
+        for ( i = 0; i < nxy; i++ ) opts->poserr[i] = 0.;
+    for ( v = !vel; v < 7; v++ ) {
+        *integrationFlag += task[v].flag[0] + task[v].flag[1];
+        if ( opts != NULL ) {
+            jam_axi_posstat( nxy, task[v].p->plan.idx, task[v].pf, \
+                task[v].pe, opts->posflag, opts->poserr );
+            if ( task[v].o.npol > opts->npol ) opts->npol = task[v].o.npol;
+            if ( task[v].o.err > opts->err ) opts->err = task[v].o.err;
+            
+            // sentinel errors of each moment, in the order of the moments
+            for ( i = 0; i < ( v ? 1 : 3 ); i++ ) {
+                k = v ? v + 2 : i;
+                if ( task[v].o.sentmax[i] > opts->sentmax[k] ) \
+                    opts->sentmax[k] = task[v].o.sentmax[i];
+                if ( task[v].o.sentrms[i] > opts->sentrms[k] ) \
+                    opts->sentrms[k] = task[v].o.sentrms[i];
+            }
+        }
+        jam_axi_ws_put( task[v].o.ws, task[v].res );
+        if ( task[v].pf != NULL ) jam_axi_ws_put( task[v].o.ws, task[v].pf );
+        if ( task[v].pe != NULL ) jam_axi_ws_put( task[v].o.ws, task[v].pe );
+    }
+    
+    // tidy up
+    for ( k = !vel; k < 2; k++ ) {
+        if ( part[k].plan.ngrid > 0 ) jam_axi_grid_free( &part[k].grid );
+        free( part[k].surf );
+        free( part[k].surfpol );
+        jam_axi_lumterms_free( &part[k].lt );
+        jam_axi_plan_free( &part[k].plan );
+    }
+    jam_axi_potterms_free( &mp.pt );
+    
+    if ( graph != NULL ) *graph = g;
+    else jam_axi_graph_free( &g );
+    
+    status = ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    return jam_axi_stop_end( &stop, opts, own, status );
+    
+}
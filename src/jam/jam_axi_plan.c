@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_PLAN
+    
+    Chooses how to calculate the moments at a set of positions: directly at
+    every position, by interpolation from a polar grid, or (if opts->hybrid
+    is set) a hybrid in which positions at extreme radii are calculated
+    directly and the rest are interpolated from a grid that covers only
+    them.  The choice is the cheapest under a simple cost model:
+      
+      direct : nxy integrals
+      grid   : npol integrals (twice that for an adaptive grid), plus nxy
+               interpolations
+      hybrid : npol integrals, plus one integral for each outlier and one
+               interpolation for each of the other positions
+               
+    where the cost of an integral scales with the number of tracer and
+    potential components and the per-position costs come from opts->cost
+    (see jam_axi_cost_calibrate) or from built-in defaults.  An outlier is a
+    position whose log elliptical radius lies more than one grid step outside
+    the range of the central positions (all but the JAM_HYBRID_FRAC at each
+    end); a hybrid is only used if it is cheaper than a full grid with the
+    same radial resolution as the grid on the central positions.
+    
+    The positions are reordered so that the first ngrid are interpolated and
+    the other ndirect are calculated directly; idx gives the original index
+    of each reordered position.  The arrays of the plan, and the scratch
+    used to make it, come from opts->ws if it is set, and are given back by
+    jam_axi_plan_free.
+    
+    jam_axi_plan_grid makes the choice between direct calculation and a grid
+    alone, for callers that do not have the positions to hand (e.g. maps);
+    it returns 1 if the grid is cheaper.
+    
+    INPUTS
+      plan  : plan structure to fill
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      lum   : projected luminous MGE
+      npc   : number of potential MGE components
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      vel   : set for first moments, zero for second moments
+      opts  : evaluation options (or NULL for defaults)
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../tools/tools.h"
+
+
+// cost of one integral and of one interpolation, and number of integrals on
+// the grid
+static void jam_axi_plan_cost( struct multigaussexp *lum, int npc, int nrad, \
+        int nang, int vel, struct jam_opts *opts, double *c, double *ci, \
+        double *nint ) {
+    
+    struct jam_cost cost;
+    
+    if ( opts != NULL && opts->cost != NULL ) cost = *opts->cost;
+    else {
+        cost.rms = JAM_COST_RMS;
+        cost.vel = JAM_COST_VEL;
+        cost.interp = JAM_COST_INTERP;
+    }
+    
+    *c = ( vel ? cost.vel : cost.rms ) * lum->ntotal * npc;
+    *ci = ( vel ? 3. : 1. ) * cost.interp;
+    *nint = nrad * nang;
+    if ( opts != NULL && opts->tol > 0. && !opts->spectral ) *nint *= 2.;
+    
+}
+
+
+static int jam_axi_plan_cmp( const void *a, const void *b ) {
+    
+    double d = *(double *) a - *(double *) b;
+    return ( d > 0. ) - ( d < 0. );
+    
+}
+
+
+void jam_axi_plan( struct jam_plan *plan, double *xp, double *yp, int nxy, \
+        struct multigaussexp *lum, int npc, int nrad, int nang, int vel, \
+        struct jam_opts *opts ) {
+        
+    double qmed, *lr, *srt, lo, hi, step, cmin, cmax, c, ci, nint;
+    double tdirect, tgrid, thybrid, tfull;
+    int i, k, nout, *out;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    
+    jam_axi_plan_cost( lum, npc, nrad, nang, vel, opts, &c, &ci, &nint );
+    tdirect = nxy * c;
+    tgrid = nint * c + nxy * ci;
+    
+    // log elliptical radius of each position, as used for the grid
+    qmed = mge_qmed( lum, maximum( xp, nxy ) );
+    lr = jam_axi_ws_buf( ws, JAM_WS_PLR, nxy * sizeof( double ) );
+    srt = jam_axi_ws_buf( ws, JAM_WS_PSRT, nxy * sizeof( double ) );
+    for ( i = 0; i < nxy; i++ ) {
+        lr[i] = 0.5 * log( xp[i] * xp[i] + yp[i] * yp[i] / qmed / qmed );
+        if ( lr[i] < log( 0.001 ) ) lr[i] = log( 0.001 );
+        srt[i] = lr[i];
+    }
+    qsort( srt, nxy, sizeof( double ), jam_axi_plan_cmp );
+    
+    // outliers beyond the range of the central positions
+    out = jam_axi_ws_buf( ws, JAM_WS_POUT, nxy * sizeof( int ) );
+    for ( i = 0; i < nxy; i++ ) out[i] = 0;
+    nout = 0;
+    thybrid = tfull = tdirect;
+    if ( opts != NULL && opts->hybrid && nxy > 1 ) {
+        lo = srt[(int) floor( JAM_HYBRID_FRAC * ( nxy - 1 ) )];
+        hi = srt[(int) ceil( ( 1. - JAM_HYBRID_FRAC ) * ( nxy - 1 ) )];
+        step = ( nrad > 1 ) ? ( hi - lo ) / ( nrad - 1 ) : 0.;
+        cmin = hi;
+        cmax = lo;
+        for ( i = 0; i < nxy; i++ ) {
+            out[i] = lr[i] < lo - step || lr[i] > hi + step;
+            nout += out[i];
+            if ( !out[i] && lr[i] < cmin ) cmin = lr[i];
+            if ( !out[i] && lr[i] > cmax ) cmax = lr[i];
+        }
+        
+        // compare with a full grid at the resolution of the central grid
+        if ( nout > 0 && cmax > cmin ) {
+            thybrid = ( nint + nout ) * c + ( nxy - nout ) * ci;
+            tfull = nint * ( srt[nxy-1] - srt[0] ) / ( cmax - cmin ) * c \
+                + nxy * ci;
+        }
+    }
+    
+    // reorder positions: interpolated first, then direct
+    plan->ws = ws;
+    plan->xp = jam_axi_ws_buf( ws, JAM_WS_PXP, nxy * sizeof( double ) );
+    plan->yp = jam_axi_ws_buf( ws, JAM_WS_PYP, nxy * sizeof( double ) );
+    plan->idx = jam_axi_ws_buf( ws, JAM_WS_PIDX, nxy * sizeof( int ) );
+    
+    if ( nout > 0 && thybrid < tfull && thybrid < tdirect ) {
+        plan->ngrid = nxy - nout;
+        k = 0;
+        for ( i = 0; i < nxy; i++ ) if ( !out[i] ) plan->idx[k++] = i;
+        for ( i = 0; i < nxy; i++ ) if ( out[i] ) plan->idx[k++] = i;
+    }
+    else {
+        plan->ngrid = ( tgrid < tdirect ) ? nxy : 0;
+        for ( i = 0; i < nxy; i++ ) plan->idx[i] = i;
+    }
+    plan->ndirect = nxy - plan->ngrid;
+    
+    for ( i = 0; i < nxy; i++ ) {
+        plan->xp[i] = xp[plan->idx[i]];
+        plan->yp[i] = yp[plan->idx[i]];
+    }
+    
+    jam_axi_ws_put( ws, lr );
+    jam_axi_ws_put( ws, srt );
+    jam_axi_ws_put( ws, out );
+    
+}
+
+
+int jam_axi_plan_grid( int nxy, struct multigaussexp *lum, int npc, \
+        int nrad, int nang, int vel, struct jam_opts *opts ) {
+    
+    double c, ci, nint;
+    
+    jam_axi_plan_cost( lum, npc, nrad, nang, vel, opts, &c, &ci, &nint );
+    return nint * c + nxy * ci < nxy * c;
+    
+}
+
+
+void jam_axi_plan_free( struct jam_plan *plan ) {
+    
+    jam_axi_ws_put( plan->ws, plan->xp );
+    jam_axi_ws_put( plan->ws, plan->yp );
+    jam_axi_ws_put( plan->ws, plan->idx );
+    
+}
@@ -0,0 +1,246 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_POOL
+    
+    A thread pool for evaluating models in the background, so that a sampler
+    can have several models in flight while it proposes the next parameters
+    and does its own bookkeeping.  jam_axi_pool_start starts nthread worker
+    threads, each of which takes one job at a time from the queue (in the
+    order submitted) and keeps a workspace (see jam_axi_ws) that it reuses
+    for all its jobs.  A job is one model, filled in by the caller:
+      
+      struct jam_job job = { NULL };
+      job.xp = xp; job.yp = yp; job.nxy = nxy; job.lum = &lum; ...
+      jam_axi_pool_submit( &pool, &job );
+      ... other work, or jam_axi_pool_poll( &job ) ...
+      status = jam_axi_pool_wait( &job );
+      
+    jam_axi_pool_submit queues the job and returns at once; the job and all
+    it points to must be left alone until jam_axi_pool_wait has returned,
+    as the moments are written straight into the arrays of the job.  With
+    vv = 0 and rms given, the job calculates all six second moments (and
+    the first moments, if vm is given) as jam_axi_mmt does; otherwise it
+    calculates the first moments, if vm is given, and the second moment vv
+    in rms[0], if rms is given, as jam_axi_vel_cross and jam_axi_rms_cross
+    do for one model.  The integration flag of the job starts at zero.
+    
+    The options of a job (or NULL for defaults) are only read, so one set
+    can be shared by many jobs; each job runs on opts->nthread threads of
+    its own (one by default), in the workspace of its worker in place of
+    opts->ws, and the report members of opts and the status at each
+    position (opts->posflag and opts->poserr) are not filled.  The budget
+    in opts (see jam_axi_stop) is for each job, so a sampler can abandon
+    all the jobs that share a cancellation token by setting it.
+    
+    A pool with no threads (nthread = 0) runs each job in the calling thread
+    when it is submitted.  jam_axi_pool_free finishes all the jobs that have
+    been submitted and then stops the threads.
+    
+    INPUTS (jam_axi_pool_start)
+      pool    : structure to hold the thread pool
+      nthread : number of worker threads (0 for none, negative to use all
+                available processors)
+                
+    INPUTS (jam_axi_pool_submit)
+      pool  : thread pool
+      job   : job to run
+      
+    INPUTS (jam_axi_pool_poll, jam_axi_pool_wait)
+      job   : job that has been submitted
+      
+    OUTPUTS (jam_axi_pool_poll)
+      Non-zero if the job has finished.
+      
+    OUTPUTS (jam_axi_pool_wait)
+      The status of the job (see jam_axi_mmt, jam_axi_vel_cross and
+      jam_axi_rms_cross).
+      
+    INPUTS (jam_axi_pool_free)
+      pool  : thread pool
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "jam.h"
+
+
+// run one job in the given workspace
+static void jam_axi_pool_run( struct jam_job *job, \
+        struct jam_workspace *ws ) {
+        
+    struct jam_opts o = { NULL };
+    enum jam_status status;
+    int flag = 0;
+    
+    // private copy of the options, as they may be shared between jobs
+    if ( job->opts != NULL ) o = *job->opts;
+    o.ws = ws;
+    o.stop = NULL;
+    o.posflag = NULL;
+    o.poserr = NULL;
+    
+    job->integrationFlag = 0;
+    if ( job->vv == 0 && job->rms != NULL ) {
+        job->status = jam_axi_mmt( job->xp, job->yp, job->nxy, job->incl, \
+            job->lum, job->pot, job->beta, job->kappa, job->nrad, \
+            job->nang, &job->integrationFlag, job->vm, job->rms, NULL, &o );
+        return;
+    }
+    
+    job->status = JAM_OK;
+    if ( job->vm != NULL ) job->status = jam_axi_vel_cross( job->xp, \
+        job->yp, job->nxy, job->incl, job->lum, &job->beta, &job->kappa, 1, \
+        job->pot, 1, job->nrad, job->nang, &job->integrationFlag, job->vm, \
+        &o );
+        
+    // second moment, with its own flag as a set flag stops the calculation
+    if ( job->rms != NULL && ( job->status == JAM_OK \
+            || job->status == JAM_ERR_INTEGRAL ) ) {
+        status = jam_axi_rms_cross( job->xp, job->yp, job->nxy, job->incl, \
+            job->lum, &job->beta, 1, job->pot, 1, job->nrad, job->nang, \
+            job->vv, &flag, job->rms, &o );
+        job->integrationFlag += flag;
+        if ( job->status == JAM_OK ) job->status = status;
+    }
+    
+}
+
+
+static void *jam_axi_pool_worker( void *arg ) {
+    
+    struct jam_pool *pool = arg;
+    struct jam_workspace ws = { NULL };
+    struct jam_job *job;
+    
+    while ( 1 ) {
+        
+        // take the next job, or stop once there are none left
+        pthread_mutex_lock( &pool->lock );
+        while ( pool->head == NULL && !pool->quit ) \
+            pthread_cond_wait( &pool->cond, &pool->lock );
+        job = pool->head;
+        if ( job != NULL ) {
+            pool->head = job->next;
+            if ( pool->head == NULL ) pool->tail = NULL;
+        }
+        pthread_mutex_unlock( &pool->lock );
+        if ( job == NULL ) break;
+        
+        jam_axi_pool_run( job, &ws );
+        
+        pthread_mutex_lock( &pool->lock );
+        job->done = 1;
+        pthread_cond_broadcast( &pool->done );
+        pthread_mutex_unlock( &pool->lock );
+        
+    }
+    
+    jam_axi_ws_free( &ws );
+    
+    return NULL;
+    
+}
+
+
+void jam_axi_pool_start( struct jam_pool *pool, int nthread ) {
+    
+    int t;
+    
+    pool->head = pool->tail = NULL;
+    pool->quit = 0;
+    pthread_mutex_init( &pool->lock, NULL );
+    pthread_cond_init( &pool->cond, NULL );
+    pthread_cond_init( &pool->done, NULL );
+    
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread < 0 ) nthread = 0;
+    pool->threads = NULL;
+    if ( nthread > 0 ) pool->threads = (pthread_t *) malloc( nthread \
+        * sizeof( pthread_t ) );
+    if ( pool->threads == NULL ) nthread = 0;
+    
+    // without any threads, the jobs are run as they are submitted
+    for ( t = 0; t < nthread; t++ ) if ( pthread_create( &pool->threads[t], \
+        NULL, &jam_axi_pool_worker, pool ) != 0 ) break;
+    pool->nthread = t;
+    
+}
+
+
+void jam_axi_pool_submit( struct jam_pool *pool, struct jam_job *job ) {
+    
+    job->pool = pool;
+    job->next = NULL;
+    job->done = 0;
+    
+    if ( pool->nthread == 0 ) {
+        jam_axi_pool_run( job, NULL );
+        job->done = 1;
+        return;
+    }
+    
+    pthread_mutex_lock( &pool->lock );
+    if ( pool->tail == NULL ) pool->head = job;
+    else pool->tail->next = job;
+    pool->tail = job;
+    pthread_cond_signal( &pool->cond );
+    pthread_mutex_unlock( &pool->lock );
+    
+}
+
+
+int jam_axi_pool_poll( struct jam_job *job ) {
+    
+    int done;
+    
+    pthread_mutex_lock( &job->pool->lock );
+    done = job->done;
+    pthread_mutex_unlock( &job->pool->lock );
+    
+    return done;
+    
+}
+
+
+enum jam_status jam_axi_pool_wait( struct jam_job *job ) {
+    
+    struct jam_pool *pool = job->pool;
+    
+    pthread_mutex_lock( &pool->lock );
+    while ( !job->done ) pthread_cond_wait( &pool->done, &pool->lock );
+    pthread_mutex_unlock( &pool->lock );
+    
+    return job->status;
+    
+}
+
+
+void jam_axi_pool_free( struct jam_pool *pool ) {
+    
+    int t;
+    
+    // the threads finish the jobs in the queue before they stop
+    pthread_mutex_lock( &pool->lock );
+    pool->quit = 1;
+    pthread_cond_broadcast( &pool->cond );
+    pthread_mutex_unlock( &pool->lock );
+    for ( t = 0; t < pool->nthread; t++ ) \
+        pthread_join( pool->threads[t], NULL );
+        
+    free( pool->threads );
+    pool->threads = NULL;
+    pool->nthread = 0;
+    pthread_mutex_destroy( &pool->lock );
+    pthread_cond_destroy( &pool->cond );
+    pthread_cond_destroy( &pool->done );
+    
+}
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_POSSTAT
+    
+    Gathers the integration status and error estimate of one moment, in the
+    order of the plan that calculated it, into those of the input positions
+    (opts->posflag and opts->poserr), keeping the worst over all the moments
+    gathered so far, so that a position is reported as failed if any of its
+    moments failed.  The caller sets the status and error to zero before the
+    first moment is gathered.
+    
+    INPUTS
+      n       : number of positions
+      idx     : input position of each position in the plan order
+      pf      : integration status in the plan order (or NULL)
+      pe      : relative error estimate in the plan order (or NULL)
+      posflag : integration status at the input positions (or NULL)
+      poserr  : relative error estimate at the input positions (or NULL)
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "jam.h"
+
+
+void jam_axi_posstat( int n, int *idx, int *pf, double *pe, int *posflag, \
+        double *poserr ) {
+        
+    int i;
+    
+    if ( pf != NULL && posflag != NULL ) for ( i = 0; i < n; i++ ) \
+        if ( pf[i] > posflag[idx[i]] ) posflag[idx[i]] = pf[i];
+        
+    if ( pe != NULL && poserr != NULL ) for ( i = 0; i < n; i++ ) \
+        if ( pe[i] > poserr[idx[i]] ) poserr[idx[i]] = pe[i];
+        
+}
@@ -0,0 +1,230 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_PROG
+    
+    Calculates the moments progressively, for interactive use or for early
+    rejection of models in a sampler: a rough answer is returned quickly and
+    then improved step by step.  The first of nstep steps uses a grid with
+    nrad and nang halved nstep-1 times (but no fewer than 4 radii and 3
+    angles) and integrals whose relative tolerance is JAM_PROG_STEP^(nstep-1)
+    times looser (opts->quad, and opts->tol for an adaptive grid); each step
+    doubles the grid and tightens the tolerances by JAM_PROG_STEP, and the
+    last step is the same as jam_axi_rms_mmt or jam_axi_vel_mmt with the
+    given grid and options.
+    
+    After each step, the moments are passed to the callback fn along with the
+    step number (from 0), the status of the step (JAM_ERR_INTEGRAL if any of
+    its integrals failed), an error estimate and the data pointer.  Each step
+    has an integration flag of its own, which is added to integrationFlag
+    once the step is done, so a failed integral in one step does not stop
+    the later steps (as a set flag would in jam_axi_rms_cross).  The error
+    estimate is the largest change from the previous step relative to the
+    largest moment (the largest over the three components for first
+    moments), which is a conservative estimate since the change is dominated
+    by the error of the coarser step; it is -1 on the first step.  If fn
+    returns non-zero, no further steps are made.  mu holds the moments of
+    the last step made, and the report members of opts are those of that
+    step.  A budget set in opts (see jam_axi_stop) is for all the steps
+    together: the step during which the calculation is stopped does not
+    count, and mu is put back to the moments of the step before it (zero if
+    there was none), so a deadline gives the best answer that could be had
+    in the time.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      kappa : rotation parameter (first moments only)
+      nrad  : number of radial bins in the final interpolation grid
+      nang  : number of angular bins in the final interpolation grid
+      vv    : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz,
+              6=yz; second moments only)
+      nstep : number of steps
+      ndone : number of steps made (or NULL)
+      integrationFlag : integration flag, the sum of those of the steps
+      mu    : array [nxy] (or structure of arrays for first moments) to hold
+              the moments
+      fn    : callback after each step (or NULL)
+      data  : pointer passed to fn
+      opts  : evaluation options (or NULL for defaults)
+      
+    OUTPUTS
+      The status of the last step made (see jam_axi_rms_cross and
+      jam_axi_vel_cross), JAM_ERR_CANCEL or JAM_ERR_BUDGET if the steps were
+      stopped, or the status from jam_axi_terms_check if the model is
+      rejected (or JAM_ERR_INTEGRAL if integrationFlag is not zero to start
+      with), in which case no steps are made.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+// options and grid size for one step
+static void jam_axi_prog_step( struct jam_opts *base, int s, int nstep, \
+        int nrad, int nang, struct jam_opts *o, int *nr, int *na ) {
+        
+    double f = pow( JAM_PROG_STEP, nstep - 1 - s );
+    
+    *o = *base;
+    o->quad = ( base->quad > 0. ? base->quad : 1. ) * f;
+    if ( base->tol > 0. ) o->tol = base->tol * f;
+    
+    *nr = nrad >> ( nstep - 1 - s );
+    *na = nang >> ( nstep - 1 - s );
+    if ( *nr < 4 ) *nr = nrad < 4 ? nrad : 4;
+    if ( *na < 3 ) *na = nang < 3 ? nang : 3;
+    
+}
+
+
+// largest change from the previous moments, relative to the largest moment,
+// keeping the moments for the next step
+static double jam_axi_prog_diff( double *mu, double *prev, int nxy ) {
+    
+    double big = 0., dmax = 0.;
+    int i;
+    
+    for ( i = 0; i < nxy; i++ ) {
+        if ( fabs( mu[i] ) > big ) big = fabs( mu[i] );
+        if ( fabs( mu[i] - prev[i] ) > dmax ) dmax = fabs( mu[i] - prev[i] );
+        prev[i] = mu[i];
+    }
+    
+    return big > 0. ? dmax / big : 0.;
+    
+}
+
+
+// copy the report members of the last step back to the caller
+static void jam_axi_prog_done( struct jam_opts *opts, struct jam_opts *base, \
+        struct jam_opts *o ) {
+        
+    if ( opts == NULL ) return;
+    *opts = *o;
+    opts->quad = base->quad;
+    opts->tol = base->tol;
+    opts->stop = base->stop;
+    
+}
+
+
+enum jam_status jam_axi_rms_prog( double *xp, double *yp, int nxy, \
+        double incl, struct multigaussexp *lum, struct multigaussexp *pot, \
+        double *beta, int nrad, int nang, int vv, int nstep, int *ndone, \
+        int* integrationFlag, double *mu, int (*fn)( int, enum jam_status, \
+        double *, double, void * ), void *data, struct jam_opts *opts ) {
+        
+    struct jam_opts base = { NULL }, o;
+    struct jam_stop budget;
+    double *prev, err;
+    int i, s, nr, na, flag, stop = 0, own;
+    enum jam_status status = JAM_OK;
+    
+    // check that integration flag is zero or don't proceed
+    if ( *integrationFlag != 0 ) return JAM_ERR_INTEGRAL;
+    
+    if ( opts != NULL ) base = *opts;
+    own = jam_axi_stop_start( &budget, &base );
+    o = base;
+    prev = (double *) calloc( nxy, sizeof( double ) );
+    
+    for ( s = 0; s < nstep && !stop; s++ ) {
+        
+        jam_axi_prog_step( &base, s, nstep, nrad, nang, &o, &nr, &na );
+        flag = 0;
+        status = jam_axi_rms_cross( xp, yp, nxy, incl, lum, &beta, 1, pot, \
+            1, nr, na, vv, &flag, &mu, &o );
+        *integrationFlag += flag;
+        if ( status == JAM_ERR_CANCEL || status == JAM_ERR_BUDGET ) {
+            for ( i = 0; i < nxy; i++ ) mu[i] = prev[i];
+            break;
+        }
+        if ( status != JAM_OK && status != JAM_ERR_INTEGRAL ) break;
+            
+        err = jam_axi_prog_diff( mu, prev, nxy );
+        if ( s == 0 ) err = -1.;
+        if ( fn != NULL ) stop = fn( s, status, mu, err, data );
+        
+    }
+    
+    if ( ndone != NULL ) *ndone = s;
+    status = jam_axi_stop_end( &budget, &base, own, status );
+    jam_axi_prog_done( opts, &base, &o );
+    free( prev );
+    
+    return status;
+    
+}
+
+
+enum jam_status jam_axi_vel_prog( double *xp, double *yp, int nxy, \
+        double incl, struct multigaussexp *lum, struct multigaussexp *pot, \
+        double *beta, double *kappa, int nrad, int nang, int nstep, \
+        int *ndone, int* integrationFlag, struct jam_vel *mu, \
+        int (*fn)( int, enum jam_status, struct jam_vel *, double, void * ), \
+        void *data, struct jam_opts *opts ) {
+        
+    struct jam_opts base = { NULL }, o;
+    struct jam_stop budget;
+    double *prev, err, e;
+    int i, s, nr, na, flag, stop = 0, own;
+    enum jam_status status = JAM_OK;
+    
+    // check that integration flag is zero or don't proceed
+    if ( *integrationFlag != 0 ) return JAM_ERR_INTEGRAL;
+    
+    if ( opts != NULL ) base = *opts;
+    own = jam_axi_stop_start( &budget, &base );
+    o = base;
+    prev = (double *) calloc( 3 * nxy, sizeof( double ) );
+    
+    for ( s = 0; s < nstep && !stop; s++ ) {
+        
+        jam_axi_prog_step( &base, s, nstep, nrad, nang, &o, &nr, &na );
+        flag = 0;
+        status = jam_axi_vel_cross( xp, yp, nxy, incl, lum, &beta, &kappa, \
+            1, pot, 1, nr, na, &flag, mu, &o );
+        *integrationFlag += flag;
+        if ( status == JAM_ERR_CANCEL || status == JAM_ERR_BUDGET ) {
+            for ( i = 0; i < nxy; i++ ) {
+                mu->vx[i] = prev[i];
+                mu->vy[i] = prev[nxy+i];
+                mu->vz[i] = prev[2*nxy+i];
+            }
+            break;
+        }
+        if ( status != JAM_OK && status != JAM_ERR_INTEGRAL ) break;
+            
+        err = jam_axi_prog_diff( mu->vx, prev, nxy );
+        e = jam_axi_prog_diff( mu->vy, &prev[nxy], nxy );
+        if ( e > err ) err = e;
+        e = jam_axi_prog_diff( mu->vz, &prev[2*nxy], nxy );
+        if ( e > err ) err = e;
+        if ( s == 0 ) err = -1.;
+        if ( fn != NULL ) stop = fn( s, status, mu, err, data );
+        
+    }
+    
+    if ( ndone != NULL ) *ndone = s;
+    status = jam_axi_stop_end( &budget, &base, own, status );
+    jam_axi_prog_done( opts, &base, &o );
+    free( prev );
+    
+    return status;
+    
+}
@@ -0,0 +1,55 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_QUADVEC
+    
+    Integrates a vector-valued integrand over a given set of subintervals
+    with a fixed Gauss-Legendre rule on each.  Used for the derivatives of
+    the moments, which are integrated over the subintervals chosen by the
+    adaptive integration of the moments themselves, so that all derivatives
+    share a single set of integrand evaluations.  The Gauss-Legendre table
+    and the scratch array for the integrand values are given by the caller,
+    so that they are made once for all the positions.
+    
+    INPUTS
+      lo     : lower limits of the subintervals
+      hi     : upper limits of the subintervals
+      nint   : number of subintervals
+      t      : Gauss-Legendre table (from gsl_integration_glfixed_table_alloc)
+      f      : integrand, called as f( x, params, values )
+      params : parameters passed through to the integrand
+      n      : number of values returned by the integrand
+      val    : scratch array of n values
+      res    : array of n values to hold the integrals
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gsl/gsl_integration.h>
+#include "jam.h"
+
+
+void jam_axi_quadvec( double *lo, double *hi, int nint, \
+        gsl_integration_glfixed_table *t, \
+        void (*f)( double, void *, double * ), void *params, int n, \
+        double *val, double *res ) {
+        
+    double x, w;
+    int i, k, m;
+    
+    for ( m = 0; m < n; m++ ) res[m] = 0.;
+    for ( i = 0; i < nint; i++ ) {
+        for ( k = 0; k < (int) t->n; k++ ) {
+            gsl_integration_glfixed_point( lo[i], hi[i], k, &x, &w, t );
+            f( x, params, val );
+            for ( m = 0; m < n; m++ ) res[m] += w * val[m];
+        }
+    }
+    
+}
@@ -23,6 +23,13 @@
       rxy : array to hold the xy second moments calculated
       rxz : array to hold the xz second moments calculated
       ryz : array to hold the yz second moments calculated
+      nthread : number of threads for the integrals (0 or 1 for one,
+        negative to use all available processors)
+    
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check if the model cannot be
+      deprojected (checked before any work is done), or JAM_ERR_INTEGRAL if
+      the integration flag is set.
 ---------------------------------------------------------------------------- */
 
 #include <stdio.h>
@@ -32,18 +39,17 @@
 #include "../mge/mge.h"
 
 
-void jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
+enum jam_status jam_axi_rms(double *xp, double *yp, int nxy, double incl, \
 double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
 double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
 double *beta, int nrad, int nang, int* integrationFlag, \
-double *rxx, double *ryy, double *rzz, double *rxy, double *rxz, double *ryz) {
+double *rxx, double *ryy, double *rzz, double *rxy, double *rxz, double *ryz,
+int nthread) {
     
-    jam_axi_rms_axes(xp, yp, nxy, incl,
+    return jam_axi_rms_axes(xp, yp, nxy, incl,
         lum_area, lum_sigma, lum_q, lum_total,
         pot_area, pot_sigma, pot_q, pot_total,
         beta, nrad, nang, integrationFlag,
         rxx, ryy, rzz, rxy, rxz, ryz,
-        1, 1, 1);
-    
-    return;
+        1, 1, 1, NULL, NULL, nthread);
 }
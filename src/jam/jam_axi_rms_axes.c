@@ -2,6 +2,7 @@
   JAM_AXI_RMS_AXES
     
     Wrapper for second moment calculator designed to interface with Python, calculating only requested moments.
+    The moments are written straight into the arrays given.
     
     INPUTS
       xp : projected x' [pc]
@@ -26,6 +27,20 @@
       xaxis : whether to calculate moments involving x
       yaxis : whether to calculate moments involving y
       zaxis : whether to calculate moments involving z
+      posflag : array to hold the integration status at each position, the
+        worst over the moments calculated, 0 if all its integrals succeeded
+        (or NULL; see jam_axi_rms_cross)
+      poserr : array to hold the relative error estimate at each position,
+        the largest over the moments calculated (or NULL)
+      nthread : number of threads for the integrals (0 or 1 for one,
+        negative to use all available processors)
+    
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check if the model cannot be
+      deprojected (checked before any work is done), or JAM_ERR_INTEGRAL if
+      the integration flag is set, in which case posflag shows which
+      positions failed and the moments at the others are still good.  A
+      failure in one moment does not stop the others being calculated.
 ---------------------------------------------------------------------------- */
 
 #include <stdio.h>
@@ -35,22 +50,41 @@
 #include "../mge/mge.h"
 
 
-void jam_axi_rms_axes(double *xp, double *yp, int nxy, double incl, \
+enum jam_status jam_axi_rms_axes(double *xp, double *yp, int nxy, double incl, \
 double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
 double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
 double *beta, int nrad, int nang, int* integrationFlag, \
 double *rxx, double *ryy, double *rzz, double *rxy, double *rxz, double *ryz,
-int xaxis, int yaxis, int zaxis) {
+int xaxis, int yaxis, int zaxis, int *posflag, double *poserr, \
+int nthread) {
     
     struct multigaussexp lum, pot;
-    double* mu;
-    int i, check;
+    struct jam_opts opts = { NULL };
+    double *mu[6] = {rxx, ryy, rzz, rxy, rxz, ryz}, *iso, *pe = NULL;
+    int want[6], *pf = NULL;
+    enum jam_status status;
+    int i, v, check, flag;
     
     // if there are no moments requested, exit immediately
     if (!xaxis && !yaxis && !zaxis) {
-        return;
+        return JAM_OK;
     }
     
+    // evaluation options
+    opts.nthread = nthread;
+    
+    // status of each moment, kept as the worst over the moments
+    if (posflag!=NULL) {
+        pf = (int *) malloc(nxy * sizeof(int));
+        for (i=0; i<nxy; i++) posflag[i] = 0;
+    }
+    if (poserr!=NULL) {
+        pe = (double *) malloc(nxy * sizeof(double));
+        for (i=0; i<nxy; i++) poserr[i] = 0.;
+    }
+    opts.posflag = pf;
+    opts.poserr = pe;
+    
     // put luminous MGE components into structure
     lum.area = lum_area;
     lum.sigma = lum_sigma;
@@ -63,60 +97,60 @@ int xaxis, int yaxis, int zaxis) {
     pot.q = pot_q;
     pot.ntotal = pot_total;
     
+    // reject models that cannot be deprojected
+    status = jam_axi_terms_check(&lum, &pot, incl, beta);
+    if (status!=JAM_OK) {
+        free(pf);
+        free(pe);
+        return status;
+    }
+    
     // check for any non-zero beta or non-unity flattening
     check = 0;
     for (i=0; i<lum.ntotal; i++) if (beta[i]!=0.) check++;
     for (i=0; i<lum.ntotal; i++) if (lum_q[i]!=1.) check++;
     for (i=0; i<pot.ntotal; i++) if (pot_q[i]!=1.) check++;
     
-    // for anisotropic models, calculate each requested moment
+    // requested moments (xx, yy, zz, xy, xz, yz)
+    want[0] = xaxis;
+    want[1] = yaxis;
+    want[2] = zaxis;
+    want[3] = xaxis && yaxis;
+    want[4] = xaxis && zaxis;
+    want[5] = yaxis && zaxis;
+    
+    // for anisotropic models, calculate each requested moment straight
+    // into its results array (each with its own flag, as a set flag stops
+    // the calculation)
     if (check>0) {
-        if (xaxis) {
-            // calculate xx moments and put into results array
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                1, integrationFlag);
-            for (i=0; i<nxy; i++) rxx[i] = mu[i];
-        }
-        if (yaxis) {
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                2, integrationFlag);
-            for (i=0; i<nxy; i++) ryy[i] = mu[i];
-        }
-        if (zaxis) {
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                3, integrationFlag);
-            for (i=0; i<nxy; i++) rzz[i] = mu[i];
-        }
-        if (xaxis && yaxis) {
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                4, integrationFlag);
-            for (i=0; i<nxy; i++) rxy[i] = mu[i];
-        }
-        if (xaxis && zaxis) {
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                5, integrationFlag);
-            for (i=0; i<nxy; i++) rxz[i] = mu[i];
-        }
-        if (yaxis && zaxis) {
-            mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, \
-                6, integrationFlag);
-            for (i=0; i<nxy; i++) ryz[i] = mu[i];
+        for (v=0; v<6; v++) if (want[v]) {
+            flag = 0;
+            jam_axi_rms_cross(xp, yp, nxy, incl, &lum, &beta, 1, &pot, 1,
+                nrad, nang, v+1, &flag, &mu[v], &opts);
+            *integrationFlag += flag;
+            if (pf!=NULL) for (i=0; i<nxy; i++)
+                if (pf[i]>posflag[i]) posflag[i] = pf[i];
+            if (pe!=NULL) for (i=0; i<nxy; i++)
+                if (pe[i]>poserr[i]) poserr[i] = pe[i];
         }
     }
-    // otherwise just calculate one and propagate
+    // otherwise just calculate one (into the first requested diagonal
+    // moment) and propagate
     else {
-        mu = jam_axi_rms_mmt(xp, yp, nxy, incl, &lum, &pot, beta, nrad, nang, 1, \
-            integrationFlag);
-        if (xaxis) for (i=0; i<nxy; i++) rxx[i] = mu[i];
-        if (yaxis) for (i=0; i<nxy; i++) ryy[i] = mu[i];
-        if (zaxis) for (i=0; i<nxy; i++) rzz[i] = mu[i];
-        if (xaxis && yaxis) for (i=0; i<nxy; i++) rxy[i] = 0.;
-        if (xaxis && zaxis) for (i=0; i<nxy; i++) rxz[i] = 0.;
-        if (yaxis && zaxis) for (i=0; i<nxy; i++) ryz[i] = 0.;
+        for (v=0; !want[v]; v++);
+        iso = mu[v];
+        opts.posflag = posflag;
+        opts.poserr = poserr;
+        jam_axi_rms_cross(xp, yp, nxy, incl, &lum, &beta, 1, &pot, 1,
+            nrad, nang, 1, integrationFlag, &iso, &opts);
+        for (v=0; v<3; v++) if (want[v] && mu[v]!=iso)
+            for (i=0; i<nxy; i++) mu[v][i] = iso[i];
+        for (v=3; v<6; v++) if (want[v])
+            for (i=0; i<nxy; i++) mu[v][i] = 0.;
     }
     
-    // free memory
-    free(mu);
+    free(pf);
+    free(pe);
     
-    return;
+    return (*integrationFlag!=0) ? JAM_ERR_INTEGRAL : JAM_OK;
 }
@@ -0,0 +1,275 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_RMS_EVAL
+    
+    Calculates second moment for one tracer and one potential from their
+    precomputed terms, either directly at the input positions or on a
+    precomputed polar grid followed by interpolation.  If opts->nsentinel
+    is set, the interpolated moments are also calculated directly at that
+    many sentinel positions (see jam_axi_sentinel), and the errors are
+    reported in opts->sentmax[0] and opts->sentrms[0].  Direct calculation
+    folds the positions onto one quadrant and integrates each unique folded
+    position once (merging those within opts->merge, see jam_axi_fold).
+    
+    If opts->posflag or opts->poserr is set, the integration status and
+    relative error estimate at each input position are put there (see
+    jam_axi_rms_wmmt).  A position interpolated from a grid is given the
+    number of grid nodes whose integrals failed and no error estimate (its
+    error is that of the interpolation, which the sentinels check), and a
+    position read from the cache is given zero for both.
+    
+    jam_axi_rms_quad does the grid part alone: it returns the second moment
+    on the nodes of the grid to interpolate from (refined and put in agrid if
+    opts asks for an adaptive grid), ready for jam_axi_interp with s1=s2=1,
+    or s1=-1, s2=1 for the xy and xz moments on a spectral grid (which are
+    then already signed; otherwise their signs are fixed after interpolation).
+    
+    INPUTS
+      xp      : projected x' [pc]
+      yp      : projected y' [pc]
+      nxy     : number of x' and y' values given
+      incl    : inclination [radians]
+      lt      : tracer terms from jam_axi_lumterms
+      pt      : potential terms from jam_axi_potterms
+      grid    : polar interpolation grid, or NULL to calculate directly
+      surf    : tracer surface density at the input positions
+      surfpol : tracer surface density on the grid (if grid is given)
+      vv      : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz,
+                6=yz)
+      mu      : array to hold the second moment
+      opts    : evaluation options (or NULL for defaults)
+      
+    INPUTS (jam_axi_rms_quad, as above and)
+      agrid   : grid structure to hold an adaptive grid
+      gp      : set to the grid to interpolate from (grid or agrid)
+      
+    NOTES
+      * Based on janis2_second_moment IDL code by Michele Cappellari.
+      * This version does not implement PDF convolution.
+      
+  Mark den Brok
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+double* jam_axi_rms_quad( struct jam_grid *grid, struct jam_lumterms *lt, \
+        struct jam_potterms *pt, double incl, double *surfpol, int vv, \
+        int* integrationFlag, struct jam_grid *agrid, struct jam_grid **gp, \
+        struct jam_opts *opts ) {
+        
+    int k, spec;
+    double *wm2, err, qtol = opts == NULL ? 0. : opts->quad;
+    int nthread = opts == NULL ? 0 : opts->nthread;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    struct jam_stop *stop = opts == NULL ? NULL : opts->stop;
+    struct cache *cache = opts == NULL ? NULL : opts->cache;
+    struct cache_key key;
+    
+    *gp = grid;
+    
+    // cached maps are only for integrals at the default precision
+    if ( qtol > 0. && qtol != 1. ) cache = NULL;
+    
+    // refine the grid until the map meets the tolerance
+    wm2 = NULL;
+    if ( opts != NULL && opts->tol > 0. && !grid->spec ) {
+        wm2 = jam_axi_adapt( grid, lt, pt, incl, surfpol, vv, opts->tol, \
+            qtol, nthread, ws, stop, integrationFlag, agrid, &err );
+        *gp = agrid;
+        if ( agrid->npol > opts->npol ) opts->npol = agrid->npol;
+        if ( err > opts->err ) opts->err = err;
+    }
+    
+    // look for the polar grid map in the cache
+    else if ( cache != NULL ) {
+        jam_axi_cache_key( &key, vv, incl, lt, pt, grid->xpol, grid->ypol, \
+            grid->npol );
+        wm2 = (double *) malloc( grid->npol * sizeof( double ) );
+        if ( cache_get( cache, &key, wm2, grid->npol ) != 0 ) {
+            free( wm2 );
+            wm2 = NULL;
+        }
+    }
+    
+    if ( wm2 == NULL ) {
+        
+        // weighted second moment on polar grid
+        wm2 = (double *) malloc( grid->npol * sizeof( double ) );
+        jam_axi_rms_wmmt( grid->xpol, grid->ypol, grid->npol, incl, lt, pt, \
+            vv, integrationFlag, qtol, nthread, wm2, NULL, NULL, stop, ws );
+            
+        // second moment on the polar grid
+        for ( k = 0; k < grid->npol; k++ ) {
+            if (surfpol[k]!=0) wm2[k] /= surfpol[k];
+            else wm2[k] = 0;
+        }
+        
+        // moments of a stopped calculation are not kept
+        if ( cache != NULL && *integrationFlag == 0 \
+            && jam_axi_stop_poll( stop, 0 ) == JAM_OK ) \
+            cache_put( cache, &key, wm2, grid->npol );
+            
+    }
+    
+    // the xy and xz moments are odd about both axes, which the spectral
+    // expansion can use directly (on the quadrant xy is minus the map)
+    spec = (*gp)->spec && ( vv == 4 || vv == 5 );
+    if ( spec && vv == 4 ) for ( k = 0; k < (*gp)->npol; k++ ) wm2[k] *= -1.;
+    
+    return wm2;
+    
+}
+
+
+void jam_axi_rms_eval( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, \
+        struct jam_grid *grid, double *surf, double *surfpol, int vv, \
+        int* integrationFlag, double *mu, struct jam_opts *opts ) {
+        
+    int i, spec, ns, nf, f0, *idx, *rep, *map, *pf;
+    double *wm2, *xs, *ys, *ss, *exact, *xf, *yf, *pe, sr;
+    int *posflag = opts == NULL ? NULL : opts->posflag;
+    double *poserr = opts == NULL ? NULL : opts->poserr;
+    double qtol = opts == NULL ? 0. : opts->quad;
+    double merge = opts == NULL ? 0. : opts->merge;
+    int nthread = opts == NULL ? 0 : opts->nthread;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    struct jam_stop *stop = opts == NULL ? NULL : opts->stop;
+    struct cache *cache = opts == NULL ? NULL : opts->cache;
+    struct cache_key key;
+    struct jam_grid agrid, *gp = grid;
+    struct jam_opts so = { NULL };
+    
+    // calculate directly when computing just a few points
+    if ( grid == NULL ) {
+        
+        // look for these moments in the cache
+        // (not those of merged positions, which are only approximate)
+        if ( ( qtol > 0. && qtol != 1. ) || merge > 0. ) cache = NULL;
+        if ( cache != NULL ) {
+            jam_axi_cache_key( &key, vv, incl, lt, pt, xp, yp, nxy );
+            if ( cache_get( cache, &key, mu, nxy ) == 0 ) {
+                if ( posflag != NULL ) for ( i = 0; i < nxy; i++ ) \
+                    posflag[i] = 0;
+                if ( poserr != NULL ) for ( i = 0; i < nxy; i++ ) \
+                    poserr[i] = 0.;
+                return;
+            }
+        }
+        
+        // weighted second moment at the unique folded positions (the
+        // integrand depends only on x'^2, y'^2 and |x'y'|)
+        xf = jam_axi_ws_buf( ws, JAM_WS_XF, nxy * sizeof( double ) );
+        yf = jam_axi_ws_buf( ws, JAM_WS_YF, nxy * sizeof( double ) );
+        rep = jam_axi_ws_buf( ws, JAM_WS_REP, nxy * sizeof( int ) );
+        map = jam_axi_ws_buf( ws, JAM_WS_MAP, nxy * sizeof( int ) );
+        nf = jam_axi_fold( xp, yp, nxy, merge, xf, yf, rep, map, ws );
+        wm2 = jam_axi_ws_buf( ws, JAM_WS_MU, nf * sizeof( double ) );
+        pf = ( posflag == NULL ) ? NULL : \
+            jam_axi_ws_buf( ws, JAM_WS_PFLAG, nf * sizeof( int ) );
+        pe = ( poserr == NULL ) ? NULL : \
+            jam_axi_ws_buf( ws, JAM_WS_PERR, nf * sizeof( double ) );
+        jam_axi_rms_wmmt( xf, yf, nf, incl, lt, pt, vv, integrationFlag, \
+            qtol, nthread, wm2, pf, pe, stop, ws );
+            
+        // second moment, with the signs of the xy and xz moments fixed
+        for ( i = 0; i < nxy; i++ ) {
+            sr = ( merge > 0. ) ? surf[rep[map[i]]] : surf[i];
+            mu[i] = wm2[map[i]] / sr;
+            if ( vv == 4 && xp[i] * yp[i] >= 0. ) mu[i] *= -1.;
+            if ( vv == 5 && xp[i] * yp[i] < 0. ) mu[i] *= -1.;
+            if (sr <= 0) mu[i] = 0;
+            if ( pf != NULL ) posflag[i] = pf[map[i]];
+            if ( pe != NULL ) poserr[i] = pe[map[i]];
+        }
+        
+        if ( cache != NULL && *integrationFlag == 0 \
+            && jam_axi_stop_poll( stop, 0 ) == JAM_OK ) \
+            cache_put( cache, &key, mu, nxy );
+            
+        jam_axi_ws_put( ws, wm2 );
+        jam_axi_ws_put( ws, pf );
+        jam_axi_ws_put( ws, pe );
+        jam_axi_ws_put( ws, xf );
+        jam_axi_ws_put( ws, yf );
+        jam_axi_ws_put( ws, rep );
+        jam_axi_ws_put( ws, map );
+        return;
+        
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // second moment on the grid nodes
+    f0 = *integrationFlag;
+    wm2 = jam_axi_rms_quad( grid, lt, pt, incl, surfpol, vv, \
+        integrationFlag, &agrid, &gp, opts );
+    spec = gp->spec && ( vv == 4 || vv == 5 );
+    
+    // positions share the status of the grid they are interpolated from
+    if ( posflag != NULL ) for ( i = 0; i < nxy; i++ ) \
+        posflag[i] = *integrationFlag - f0;
+    if ( poserr != NULL ) for ( i = 0; i < nxy; i++ ) poserr[i] = 0.;
+    
+    // interpolation to get second moments for all data points
+    if ( spec ) jam_axi_interp( gp, wm2, -1, 1, mu, opts );
+    else jam_axi_interp( gp, wm2, 1, 1, mu, opts );
+    if ( gp != grid ) jam_axi_grid_free( &agrid );
+    
+    // set second moments to zero when surface brightness is zero
+    // fix was already done above but negatives come back with
+    // interpolation
+    for ( i = 0; i < nxy; i++ ) {
+        if (surf[i]==0) mu[i] = 0;
+    }
+    
+    // fix signs of xy and xz second moments
+    if ( vv == 4 && !spec ) for ( i = 0; i < nxy; i++ ) \
+        if ( xp[i] * yp[i] >= 0. ) mu[i] *= -1.;
+        
+    if ( vv == 5 && !spec ) for ( i = 0; i < nxy; i++ ) \
+        if ( xp[i] * yp[i] < 0. ) mu[i] *= -1.;
+        
+    free( wm2 );
+    
+    // check the interpolation against direct calculation at sentinels
+    // (in the same workspace, whose folding buffers are free by now)
+    if ( opts != NULL && opts->nsentinel > 0 ) {
+        idx = jam_axi_ws_buf( ws, JAM_WS_SIDX, \
+            opts->nsentinel * sizeof( int ) );
+        ns = jam_axi_sentinel_pick( grid->r, nxy, opts->nsentinel, idx );
+        xs = jam_axi_ws_buf( ws, JAM_WS_SX, ns * sizeof( double ) );
+        ys = jam_axi_ws_buf( ws, JAM_WS_SY, ns * sizeof( double ) );
+        ss = jam_axi_ws_buf( ws, JAM_WS_SSURF, ns * sizeof( double ) );
+        exact = jam_axi_ws_buf( ws, JAM_WS_SMU, ns * sizeof( double ) );
+        for ( i = 0; i < ns; i++ ) {
+            xs[i] = xp[idx[i]];
+            ys[i] = yp[idx[i]];
+            ss[i] = surf[idx[i]];
+        }
+        so.ws = ws;
+        jam_axi_rms_eval( xs, ys, ns, incl, lt, pt, NULL, ss, NULL, vv, \
+            integrationFlag, exact, &so );
+        jam_axi_sentinel_err( exact, mu, idx, ns, &opts->sentmax[0], \
+            &opts->sentrms[0] );
+        jam_axi_ws_put( ws, idx );
+        jam_axi_ws_put( ws, xs );
+        jam_axi_ws_put( ws, ys );
+        jam_axi_ws_put( ws, ss );
+        jam_axi_ws_put( ws, exact );
+    }
+    
+}
@@ -0,0 +1,188 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_RMS_GRAD
+    
+    Calculates second moment and its derivatives with respect to the model
+    parameters.  The derivatives with respect to the anisotropy of each
+    luminous component and the mass scaling of each potential component are
+    propagated through the integrand, the integral and the interpolation
+    (see jam_axi_rms_wgrad); the derivative with respect to inclination,
+    which enters through the deprojection of both MGEs, is found by a
+    centred difference (or a one-sided difference if the model cannot be
+    deprojected at one of the two inclinations).
+    
+    The parameters are ordered as: inclination, beta for each luminous
+    component, kappa for each luminous component (the second moments do not
+    depend on kappa, so these are zero) and the mass scaling for each
+    potential component, giving npar = 1 + 2*nlum + npot.  The mass scaling
+    derivative is taken with respect to a factor multiplying the given
+    potential component, so it is ML * dmu/dML for a mass-to-light ratio ML.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      vv    : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz, 6=yz)
+      mu    : array to hold the second moment
+      dmu   : array to hold the derivatives, ordered as [p*nxy+i] for
+              parameter p and position i
+              
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check for a model that cannot be
+      deprojected (checked before any work is done), JAM_ERR_INPUT for an
+      invalid vv, or JAM_ERR_INTEGRAL if the integration flag is set.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+enum jam_status jam_axi_rms_grad( double *xp, double *yp, int nxy, \
+        double incl, struct multigaussexp *lum, struct multigaussexp *pot, \
+        double *beta, int nrad, int nang, int vv, int* integrationFlag, \
+        double *mu, double *dmu ) {
+    
+    int i, k, p, npar;
+    double *wm2, *dsb, *surf, *surfpol, *map, *out, *mlo, *mhi;
+    double dincl = 1e-3;    // inclination step for the centred difference
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_grid grid;
+    enum jam_status status;
+    
+    // check that integration flag is zero or don't proceed
+    if (*integrationFlag!=0) return JAM_ERR_INTEGRAL;
+    
+    // check that the model can be deprojected before doing any work
+    if ( vv < 1 || vv > 6 ) return JAM_ERR_INPUT;
+    status = jam_axi_terms_check( lum, pot, incl, beta );
+    if ( status != JAM_OK ) return status;
+    
+    // number of parameters without inclination
+    npar = 2 * lum->ntotal + pot->ntotal;
+    
+    lt = jam_axi_lumterms( lum, incl, beta, NULL );
+    pt = jam_axi_potterms( pot, incl );
+    surf = mge_surf( lum, xp, yp, nxy );
+    
+    // skip the interpolation when computing just a few points
+    if ( nrad * nang > nxy ) {
+        
+        // weighted second moment and its derivatives, in place
+        jam_axi_rms_wgrad( xp, yp, nxy, incl, &lt, &pt, vv, \
+            integrationFlag, mu, &dmu[nxy] );
+        
+        for ( p = -1; p < npar; p++ ) {
+            
+            map = ( p < 0 ) ? mu : &dmu[(1+p)*nxy];
+            out = map;
+            
+            for ( i = 0; i < nxy; i++ ) {
+                
+                // fix signs of xy and xz second moments
+                if ( vv == 4 && xp[i] * yp[i] >= 0. ) map[i] *= -1.;
+                if ( vv == 5 && xp[i] * yp[i] < 0. ) map[i] *= -1.;
+                
+                out[i] = map[i] / surf[i];
+                if (surf[i] <= 0) out[i] = 0;
+                
+            }
+            
+        }
+        
+    } else {
+        
+        // interpolation grid and surface brightness on it
+        grid = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, log( 0.99 ), \
+            log( 1.01 ), NULL );
+        surfpol = mge_surf( lum, grid.xpol, grid.ypol, grid.npol );
+        
+        // weighted second moment and its derivatives on polar grid
+        wm2 = (double *) malloc( grid.npol * sizeof( double ) );
+        dsb = (double *) malloc( npar * grid.npol * sizeof( double ) );
+        jam_axi_rms_wgrad( grid.xpol, grid.ypol, grid.npol, incl, &lt, &pt, \
+            vv, integrationFlag, wm2, dsb );
+        
+        for ( p = -1; p < npar; p++ ) {
+            
+            if ( p < 0 ) {
+                map = wm2;
+                out = mu;
+            } else {
+                map = &dsb[p*grid.npol];
+                out = &dmu[(1+p)*nxy];
+            }
+            
+            // second moment (or derivative) on the polar grid
+            for ( k = 0; k < grid.npol; k++ ) {
+                if (surfpol[k]!=0) map[k] /= surfpol[k];
+                else map[k] = 0;
+            }
+            
+            // interpolation to get values for all data points
+            jam_axi_interp( &grid, map, 1, 1, out, NULL );
+            
+            for ( i = 0; i < nxy; i++ ) {
+                
+                // set to zero when surface brightness is zero
+                if (surf[i]==0) out[i] = 0;
+                
+                // fix signs of xy and xz second moments
+                if ( vv == 4 && xp[i] * yp[i] >= 0. ) out[i] *= -1.;
+                if ( vv == 5 && xp[i] * yp[i] < 0. ) out[i] *= -1.;
+                
+            }
+            
+        }
+        
+        free( wm2 );
+        free( dsb );
+        free( surfpol );
+        jam_axi_grid_free( &grid );
+        
+    }
+    
+    free( surf );
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    
+    
+    // ---------------------------------
+    
+    
+    // inclination derivative by centred difference, or one-sided where
+    // the model cannot be deprojected at one of the steps
+    mlo = jam_axi_rms_mmt( xp, yp, nxy, incl - dincl, lum, pot, beta, nrad, \
+        nang, vv, integrationFlag, NULL );
+    mhi = jam_axi_rms_mmt( xp, yp, nxy, incl + dincl, lum, pot, beta, nrad, \
+        nang, vv, integrationFlag, NULL );
+    for ( i = 0; i < nxy; i++ ) {
+        if ( mlo != NULL && mhi != NULL ) \
+            dmu[i] = ( mhi[i] - mlo[i] ) / ( 2. * dincl );
+        else if ( mhi != NULL ) dmu[i] = ( mhi[i] - mu[i] ) / dincl;
+        else if ( mlo != NULL ) dmu[i] = ( mu[i] - mlo[i] ) / dincl;
+        else dmu[i] = 0.;
+    }
+    
+    free( mlo );
+    free( mhi );
+    
+    return ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    
+}
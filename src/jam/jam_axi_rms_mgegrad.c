@@ -0,0 +1,113 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_RMS_MGEGRAD
+    
+    Derivatives of the integrand for the MGE integral required for second
+    moment calculation (see jam_axi_rms_mgeint) with respect to the
+    anisotropy of each luminous component and the mass scaling of each
+    potential component.  The integrand is linear in both the anisotropy
+    term 1/(1-beta) of each luminous component and the mass of each potential
+    component, so the derivatives follow directly from the terms of the sum.
+    
+    INPUTS
+      u      : integration variable
+      params : function parameters passed as a structure
+      df     : array to hold the derivatives, ordered as beta for each
+               luminous component, kappa for each luminous component (zero)
+               and the mass scaling for each potential component
+               
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../mge/mge.h"
+#include "jam.h"
+
+
+void jam_axi_rms_mgegrad( double u, void *params, double *df ) {
+    
+    struct params_rmsint *p;
+    double e2u2p, a, b, c, d, dd, e, f, fk, w, norm;
+    int j, k, nlum;
+    
+    double u2 = u * u;
+    
+    p = params;
+    nlum = p->lum->ntotal;
+    norm = 4. * pow( M_PI, 1.5 ) * G;
+    
+    for ( k = 0; k < 2 * nlum + p->pot->ntotal; k++ ) df[k] = 0.;
+    
+    for ( j = 0; j < p->pot->ntotal; j++ ) { //mass gaussians
+        
+        e2u2p = u2 * p->e2p[j];
+        
+        for ( k = 0; k < nlum; k++ ) { // luminous gaussians
+            
+            a = 0.5 * ( u2 / p->s2p[j] + 1. / p->s2l[k] );
+            b = 0.5 * ( e2u2p * u2 / ( p->s2p[j] * ( 1. - e2u2p ) ) \
+                + ( 1. - p->q2l[k] ) / p->s2q2l[k] );
+            c = p->e2p[j] - p->s2q2l[k] / p->s2p[j];
+            d = 1. - p->kani[k] * p->q2l[k] \
+                - ( ( 1. - p->kani[k] ) * c + p->e2p[j] * p->kani[k] ) * u2;
+            e = a + b * p->ci2;
+            
+            // derivative of d with respect to the anisotropy term
+            dd = - p->q2l[k] - ( p->e2p[j] - c ) * u2;
+            
+            // integrand term f and its derivative fk
+            switch ( p->vv ) {
+                case 1: // v2xx
+                    f = p->kani[k] * p->s2q2l[k] + 0.5 * d * p->si2 / e \
+                        + d * pow( a + b, 2 ) * p->ci2 * p->y2 / e / e;
+                    fk = p->s2q2l[k] + 0.5 * dd * p->si2 / e \
+                        + dd * pow( a + b, 2 ) * p->ci2 * p->y2 / e / e;
+                    break;
+                case 2: // v2yy
+                    f = p->s2q2l[k] * ( p->si2 + p->kani[k] * p->ci2 ) \
+                        + p->x2 * p->ci2 * d;
+                    fk = p->s2q2l[k] * p->ci2 + p->x2 * p->ci2 * dd;
+                    break;
+                case 3: // v2zz
+                    f = p->s2q2l[k] * ( p->ci2 + p->kani[k] * p->si2 ) \
+                        + p->x2 * p->si2 * d;
+                    fk = p->s2q2l[k] * p->si2 + p->x2 * p->si2 * dd;
+                    break;
+                case 4: // v2xy
+                    f = d * fabs( p->xy ) * p->ci2 * ( a + b ) / e;
+                    fk = dd * fabs( p->xy ) * p->ci2 * ( a + b ) / e;
+                    break;
+                case 5: // v2xz
+                    f = d * fabs( p->xy ) * p->cisi * ( a + b ) / e;
+                    fk = dd * fabs( p->xy ) * p->cisi * ( a + b ) / e;
+                    break;
+                case 6: // v2yz
+                    f = p->cisi * ( p->s2q2l[k] * ( 1 - p->kani[k] ) \
+                        - d * p->x2 );
+                    fk = - p->cisi * ( p->s2q2l[k] + dd * p->x2 );
+                    break;
+                default:
+                    f = 0.;
+                    fk = 0.;
+                    break;
+            }
+            
+            w = norm * p->lum->area[k] * p->pot->q[j] * p->pot->area[j] * u2 \
+                / ( 1. - c * u2 ) / sqrt( ( 1. - e2u2p ) * e ) \
+                * exp( -a * ( p->x2 + p->y2 * ( a + b ) / e ) );
+                
+            // d(kani)/d(beta) = kani^2
+            df[k] += w * fk * p->kani[k] * p->kani[k];
+            df[2*nlum+j] += w * f;
+            
+        }
+    }
+    
+}
@@ -37,6 +37,9 @@ double jam_axi_rms_mgeint( double u, void *params ) {
     
     p = params;
     
+    // once the calculation has been stopped, finish at once
+    if ( jam_axi_stop_tick( p->stop, &p->neval ) ) return 0.;
+    
     sum = 0.;
     for ( j = 0; j < p->pot->ntotal; j++ ) { //mass gaussians
         
@@ -75,10 +78,8 @@ double jam_axi_rms_mgeint( double u, void *params ) {
                     f = p->cisi * ( p->s2q2l[k] * ( 1 - p->kani[k] ) \
                         - d * p->x2 );
                     break;
-                default:
-                    printf( "No integral selected.  Options: 1=v2xx, " );
-                    printf( "2=v2yy, 3=v2zz, 4=v2xy, 5=v2xz, 6=v2yz.\n" );
-                    f = 1.;
+                default: // rejected by the callers (JAM_ERR_INPUT)
+                    f = 0.;
                     break;
             }
             
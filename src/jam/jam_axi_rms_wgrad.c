@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_RMS_WGRAD
+    
+    Calculates weighted second moments and their derivatives with respect
+    to the anisotropy of each luminous component and the mass scaling of
+    each potential component.  The integral of the second moment is found
+    adaptively, exactly as in jam_axi_rms_wmmt (including the retry of a
+    failed integral), and is returned with the derivatives, which are then
+    integrated together over the same subintervals with a Gauss-Legendre
+    table made once for all the positions.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lt    : tracer terms from jam_axi_lumterms
+      pt    : potential terms from jam_axi_potterms
+      vv    : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz, 6=yz)
+      mu    : array [nxy] to hold the weighted second moment
+      dsb   : array to hold the derivatives, ordered as [p*nxy+i] for
+              parameter p (see jam_axi_rms_mgegrad) and position i
+              
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_integration.h>
+#include <gsl/gsl_errno.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+void jam_axi_rms_wgrad( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, int vv, \
+        int* integrationFlag, double *mu, double *dsb ) {
+        
+    struct params_rmsint p;
+    gsl_integration_glfixed_table *t;
+    gsl_integration_workspace *w, *retry = NULL, *u;
+    double ci, si;
+    double result, error, *res, *val;
+    int i, k, s, npar;
+    
+    // angles
+    ci = cos( incl );
+    si = sin( incl );
+    
+    // parameters for the integrand function
+    p.ci2 = ci * ci;
+    p.si2 = si * si;
+    p.cisi = ci * si;
+    p.lum = &lt->ilum;
+    p.pot = &pt->ipot;
+    p.kani = lt->kani;
+    p.s2l = lt->s2l;
+    p.q2l = lt->q2l;
+    p.s2q2l = lt->s2q2l;
+    p.s2p = pt->s2p;
+    p.e2p = pt->e2p;
+    p.vv = vv;
+    p.stop = NULL;
+    
+    npar = 2 * lt->ilum.ntotal + pt->ipot.ntotal;
+    res = (double *) malloc( npar * sizeof( double ) );
+    val = (double *) malloc( npar * sizeof( double ) );
+    t = gsl_integration_glfixed_table_alloc( 32 );
+    
+    
+    // perform integration
+    
+    w = gsl_integration_workspace_alloc( 1000 );
+    jam_axi_gsl_init();
+    gsl_function F;
+    F.function = &jam_axi_rms_mgeint;
+    
+    for ( i = 0; i < nxy; i++ ) {
+        
+        p.x2 = xp[i] * xp[i];
+        p.y2 = yp[i] * yp[i];
+        p.xy = xp[i] * yp[i];
+        F.params = &p;
+        
+        // second moment integral, retried as in jam_axi_rms_wmmt
+        u = w;
+        s = gsl_integration_qag( &F, 0., 1., 0., 1e-5, 1000, 6, u, &result, \
+            &error );
+        if ( s != 0 ) {
+            if ( retry == NULL ) \
+                retry = gsl_integration_workspace_alloc( JAM_RETRY_LIMIT );
+            u = retry;
+            s = gsl_integration_qags( &F, 0., 1., 0., 1e-5, JAM_RETRY_LIMIT, \
+                u, &result, &error );
+        }
+        *integrationFlag += s;
+        mu[i] = result;
+        
+        // derivatives over the subintervals of the integral that was kept
+        jam_axi_quadvec( u->alist, u->blist, u->size, t, \
+            &jam_axi_rms_mgegrad, &p, npar, val, res );
+        for ( k = 0; k < npar; k++ ) dsb[k*nxy+i] = res[k];
+        
+    }
+    
+    gsl_integration_workspace_free( w );
+    if ( retry != NULL ) gsl_integration_workspace_free( retry );
+    gsl_integration_glfixed_table_free( t );
+    free( val );
+    free( res );
+    
+}
@@ -1,17 +1,41 @@
 /* ----------------------------------------------------------------------------
   JAM_AXI_RMS_WMMT
     
-    Calculates weighted second moment.
+    Calculates weighted second moment.  The positions can be shared out
+    between threads, which take JAM_THREAD_CHUNK positions at a time and
+    each have their own integration workspace; every position is integrated
+    in the same way whichever thread takes it, so the results do not depend
+    on the number of threads.  The integration workspaces and thread handles
+    come from ws, if given, so that repeated calls do not allocate them, and
+    the moment is written straight into mu.  If the calculation is stopped
+    (see jam_axi_stop), the threads take no more positions and mu is left
+    incomplete.
+    
+    An integral that fails is tried again at once, at that position only,
+    with extrapolation (qags) and up to JAM_RETRY_LIMIT subintervals, and
+    only a position that still fails is counted in the integration flag.
+    The status and the relative error estimate at each position can be
+    returned in pflag and perr (zero at positions not reached if stopped).
     
     INPUTS
       xp    : projected x' [pc]
       yp    : projected y' [pc]
       nxy   : number of x' and y' values given
       incl  : inclination [radians]
-      lum   : projected luminous MGE
-      pot   : projected potential MGE
-      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      lt    : tracer terms from jam_axi_lumterms
+      pt    : potential terms from jam_axi_potterms
       vv    : velocity integral selector (1=xx, 2=yy, 3=zz, 4=xy, 5=xz, 6=yz)
+      quad  : factor on the relative tolerance of the integrals (0 or 1 for
+              the default, larger for faster but less precise integrals)
+      nthread : number of threads (0 or 1 for one, negative to use all
+              available processors)
+      mu    : array [nxy] to hold the weighted second moment
+      pflag : array [nxy] to hold the GSL status of the integral at each
+              position, 0 if it converged (or NULL)
+      perr  : array [nxy] to hold the relative error estimate of the
+              integral at each position (or NULL)
+      stop  : budget of the calculation (or NULL for none)
+      ws    : workspace (or NULL, see jam_axi_ws)
     
     NOTES
     * Based on janis2_weighted_second_moment_squared IDL code by Michele
@@ -30,6 +54,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_errno.h>
 #include "jam.h"
@@ -37,88 +63,150 @@
 #include "../tools/tools.h"
 
 
-double *jam_axi_rms_wmmt( double *xp, double *yp, int nxy, double incl, \
-        struct multigaussexp *lum, struct multigaussexp *pot, \
-        double *beta, int vv, int* integrationFlag) {
-    
+// work shared between threads
+struct rms_wmmt {
     struct params_rmsint p;
-    struct multigaussexp ilum, ipot;
-    double ci, si, *kani, *s2l, *q2l, *s2q2l, *s2p, *e2p;
-    double result, error, *sb_mu2;
-    int i;
-    
-    // convert from projected MGEs to intrinsic MGEs
-    ilum = mge_deproject( lum, incl );
-    ipot = mge_deproject( pot, incl );
-    
-    // angles
-    ci = cos( incl );
-    si = sin( incl );
-    
+    struct jam_workspace *ws;
+    double *xp, *yp, *sb_mu2, *perr, quad;
+    int *pflag;
+    int nxy, next, nstart, flag;
+    pthread_mutex_t lock;
+};
+
+
+static void *jam_axi_rms_wmmt_worker( void *arg ) {
     
-    // mge component combinations
+    struct rms_wmmt *wm = arg;
+    struct params_rmsint p = wm->p;
+    struct jam_wsquad own, *qw;
+    double result, error;
+    int i, n, s, t, flag = 0;
     
-    kani = (double *) malloc ( lum->ntotal * sizeof( double ) );
-    s2l = (double *) malloc( lum->ntotal * sizeof( double ) );
-    q2l = (double *) malloc( lum->ntotal * sizeof( double ) );
-    s2q2l = (double *) malloc( lum->ntotal * sizeof( double ) );
-    s2p = (double *) malloc( pot->ntotal * sizeof( double ) );
-    e2p = (double *) malloc( pot->ntotal * sizeof( double ) );
+    // thread number, for the integration workspace
+    pthread_mutex_lock( &wm->lock );
+    t = wm->nstart++;
+    pthread_mutex_unlock( &wm->lock );
     
-    for ( i = 0; i < ilum.ntotal; i++ ) {
-        kani[i] = 1. / ( 1. - beta[i] );
-        s2l[i] = pow( ilum.sigma[i], 2. );
-        q2l[i] = pow( ilum.q[i], 2. );
-        s2q2l[i] = s2l[i] * q2l[i];
+    qw = jam_axi_ws_quad( wm->ws, t, &own );
+    gsl_function F;
+    F.function = &jam_axi_rms_mgeint;
+    F.params = &p;
+    
+    while ( 1 ) {
+        
+        // take the next chunk of positions, unless stopped
+        if ( p.stop != NULL && p.stop->status != JAM_OK ) break;
+        pthread_mutex_lock( &wm->lock );
+        i = wm->next;
+        wm->next += JAM_THREAD_CHUNK;
+        pthread_mutex_unlock( &wm->lock );
+        if ( i >= wm->nxy ) break;
+        n = ( i + JAM_THREAD_CHUNK < wm->nxy ) ? i + JAM_THREAD_CHUNK : wm->nxy;
+        
+        for ( ; i < n; i++ ) {
+            p.x2 = wm->xp[i] * wm->xp[i];
+            p.y2 = wm->yp[i] * wm->yp[i];
+            p.xy = wm->xp[i] * wm->yp[i];
+            s = gsl_integration_qag( &F, 0., 1., 0., 1e-5 * wm->quad, \
+                1000, 6, qw->outer, &result, &error );
+                
+            // retry a failed integral with a more robust rule
+            if ( s != 0 ) {
+                if ( qw->retry == NULL ) qw->retry = \
+                    gsl_integration_workspace_alloc( JAM_RETRY_LIMIT );
+                s = gsl_integration_qags( &F, 0., 1., 0., 1e-5 * wm->quad, \
+                    JAM_RETRY_LIMIT, qw->retry, &result, &error );
+            }
+            
+            flag += s;
+            wm->sb_mu2[i] = result;
+            if ( wm->pflag != NULL ) wm->pflag[i] = s;
+            if ( wm->perr != NULL ) wm->perr[i] = ( result != 0. ) ? \
+                error / fabs( result ) : error;
+        }
+        
     }
     
-    for ( i = 0; i < ipot.ntotal; i++ ) {
-        s2p[i] = pow( ipot.sigma[i], 2. );
-        e2p[i] = 1. - pow( ipot.q[i], 2. );
-    }
+    jam_axi_ws_quad_put( wm->ws, qw );
+    jam_axi_stop_poll( p.stop, p.neval );
     
-    // parameters for the integrand function
-    p.ci2 = ci * ci;
-    p.si2 = si * si;
-    p.cisi = ci * si;
-    p.lum = &ilum;
-    p.pot = &ipot;
-    p.kani = kani;
-    p.s2l = s2l;
-    p.q2l = q2l;
-    p.s2q2l = s2q2l;
-    p.s2p = s2p;
-    p.e2p = e2p;
-    p.vv = vv;
+    pthread_mutex_lock( &wm->lock );
+    wm->flag += flag;
+    pthread_mutex_unlock( &wm->lock );
     
+    return NULL;
     
-    // perform integration
+}
+
+
+void jam_axi_rms_wmmt( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, int vv, \
+        int* integrationFlag, double quad, int nthread, double *mu, \
+        int *pflag, double *perr, struct jam_stop *stop, \
+        struct jam_workspace *ws ) {
+    
+    struct rms_wmmt wm;
+    struct params_rmsint *p = &wm.p;
+    pthread_t *threads;
+    double ci, si;
+    int i, t, nrun;
     
-    gsl_integration_workspace *w = gsl_integration_workspace_alloc( 1000 );
-    gsl_set_error_handler_off();
-    gsl_function F;
-    F.function = &jam_axi_rms_mgeint;
+    // angles
+    ci = cos( incl );
+    si = sin( incl );
     
-    sb_mu2 = (double *) malloc( nxy * sizeof( double ) );
-    for ( i = 0; i < nxy; i++ ) {
-        p.x2 = xp[i] * xp[i];
-        p.y2 = yp[i] * yp[i];
-        p.xy = xp[i] * yp[i];
-        F.params = &p;
-        *integrationFlag += gsl_integration_qag( &F, 0., 1., 0., 1e-5, 1000, \
-            6, w, &result, &error );
-        sb_mu2[i] = result;
-    }
+    // parameters for the integrand function
+    p->ci2 = ci * ci;
+    p->si2 = si * si;
+    p->cisi = ci * si;
+    p->lum = &lt->ilum;
+    p->pot = &pt->ipot;
+    p->kani = lt->kani;
+    p->s2l = lt->s2l;
+    p->q2l = lt->q2l;
+    p->s2q2l = lt->s2q2l;
+    p->s2p = pt->s2p;
+    p->e2p = pt->e2p;
+    p->vv = vv;
+    p->stop = stop;
+    p->neval = 0;
+    
+    wm.xp = xp;
+    wm.yp = yp;
+    wm.nxy = nxy;
+    wm.quad = ( quad > 0. ) ? quad : 1.;
+    wm.ws = ws;
+    wm.next = 0;
+    wm.nstart = 0;
+    wm.flag = 0;
+    wm.sb_mu2 = mu;
+    wm.pflag = pflag;
+    wm.perr = perr;
+    for ( i = 0; pflag != NULL && i < nxy; i++ ) pflag[i] = 0;
+    for ( i = 0; perr != NULL && i < nxy; i++ ) perr[i] = 0.;
+    pthread_mutex_init( &wm.lock, NULL );
     
-    gsl_integration_workspace_free( w );
     
-    free( kani );
-    free( s2l );
-    free( q2l );
-    free( s2q2l );
-    free( s2p );
-    free( e2p );
+    // perform integration
     
-    return sb_mu2;
+    jam_axi_gsl_init();
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread > ( nxy + JAM_THREAD_CHUNK - 1 ) / JAM_THREAD_CHUNK ) \
+        nthread = ( nxy + JAM_THREAD_CHUNK - 1 ) / JAM_THREAD_CHUNK;
+    if ( nthread < 1 ) nthread = 1;
+    jam_axi_ws_reserve( ws, nthread );
+    threads = jam_axi_ws_buf( ws, JAM_WS_THREADS, \
+        nthread * sizeof( pthread_t ) );
+    // a thread that cannot be created stops the rest, and those running
+    // (at least the calling thread) take on its share of the work
+    for ( nrun = 1; nrun < nthread; nrun++ ) if ( pthread_create( \
+        &threads[nrun], NULL, &jam_axi_rms_wmmt_worker, &wm ) != 0 ) break;
+    jam_axi_rms_wmmt_worker( &wm );
+    for ( t = 1; t < nrun; t++ ) pthread_join( threads[t], NULL );
+    
+    *integrationFlag += wm.flag;
+    
+    jam_axi_ws_put( ws, threads );
+    pthread_mutex_destroy( &wm.lock );
     
 }
@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_SENTINEL
+    
+    Accuracy sentinels for interpolated moments: a small random subset of
+    the input positions at which the moments are also calculated directly,
+    so that the interpolation error can be measured for each model.
+    
+    jam_axi_sentinel_pick chooses up to nsent positions, stratified in
+    elliptical radius: the positions are divided into nsent strata of equal
+    size by radius and one position is picked at random from each, so that
+    the centre and the outskirts are always both checked.  The generator is
+    seeded with JAM_SENTINEL_SEED, so the same positions give the same
+    sentinels.
+    
+    jam_axi_sentinel_err compares the interpolated moments at the sentinels
+    with the direct ones and updates emax and erms, the largest and the
+    root-mean-square error relative to the largest direct moment, if they
+    are larger than the values already there.
+    
+    INPUTS (jam_axi_sentinel_pick)
+      r     : elliptical radii of the input positions
+      nxy   : number of input positions
+      nsent : number of sentinels wanted
+      idx   : array to hold the indices of up to nsent sentinels
+      
+    INPUTS (jam_axi_sentinel_err)
+      exact : moments calculated directly at the sentinels
+      mu    : interpolated moments at all input positions
+      idx   : indices of the sentinels
+      n     : number of sentinels
+      emax  : largest relative error
+      erms  : root-mean-square relative error
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../tools/tools.h"
+
+
+int jam_axi_sentinel_pick( double *r, int nxy, int nsent, int *idx ) {
+    
+    double *srt, *lim;
+    int i, s, lo, hi, n, *count;
+    unsigned int seed = JAM_SENTINEL_SEED;
+    
+    if ( nsent > nxy ) nsent = nxy;
+    if ( nsent <= 0 ) return 0;
+    
+    // radii that divide the positions into strata of equal size
+    srt = (double *) malloc( nxy * sizeof( double ) );
+    for ( i = 0; i < nxy; i++ ) srt[i] = r[i];
+    sort_dbl( srt, nxy );
+    lim = (double *) malloc( nsent * sizeof( double ) );
+    for ( s = 1; s < nsent; s++ ) lim[s] = srt[(long) s * nxy / nsent];
+    
+    // one position at random from each stratum (reservoir sampling)
+    count = (int *) calloc( nsent, sizeof( int ) );
+    for ( i = 0; i < nxy; i++ ) {
+        lo = 0;
+        hi = nsent - 1;
+        while ( lo < hi ) {
+            s = ( lo + hi + 1 ) / 2;
+            if ( r[i] >= lim[s] ) lo = s;
+            else hi = s - 1;
+        }
+        count[lo]++;
+        if ( rand_r( &seed ) % count[lo] == 0 ) idx[lo] = i;
+    }
+    
+    // drop strata left empty by tied radii
+    n = 0;
+    for ( s = 0; s < nsent; s++ ) if ( count[s] > 0 ) idx[n++] = idx[s];
+    
+    free( srt );
+    free( lim );
+    free( count );
+    
+    return n;
+    
+}
+
+
+void jam_axi_sentinel_err( double *exact, double *mu, int *idx, int n, \
+        double *emax, double *erms ) {
+        
+    double big = 0., d, dmax = 0., dsum = 0.;
+    int i;
+    
+    if ( n <= 0 ) return;
+    
+    for ( i = 0; i < n; i++ ) if ( fabs( exact[i] ) > big ) \
+        big = fabs( exact[i] );
+    if ( big == 0. ) return;
+    
+    for ( i = 0; i < n; i++ ) {
+        d = fabs( mu[idx[i]] - exact[i] ) / big;
+        if ( d > dmax ) dmax = d;
+        dsum += d * d;
+    }
+    
+    if ( dmax > *emax ) *emax = dmax;
+    if ( sqrt( dsum / n ) > *erms ) *erms = sqrt( dsum / n );
+    
+}
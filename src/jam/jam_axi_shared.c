@@ -0,0 +1,251 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_SHARED
+    
+    Attaches to a store of precomputed tables shared between processes, e.g.
+    the workers of a sampler running on one node.  The store holds the polar
+    interpolation grids for the first and second moments, the elliptical
+    radii and eccentric anomalies of the positions and the tracer surface
+    densities, and optionally the deprojected tracer and potential MGEs and
+    their integrand terms for one inclination.  The first process to attach
+    builds the store (holding a lock so the others wait rather than build it
+    again) and every process then maps the same file read-only, so the
+    tables are held in memory once per node rather than once per worker.
+    The store is rebuilt if it was written for different inputs or by a
+    different version of the code.
+    
+    The grids, surface densities and terms in the structure can be passed to
+    jam_axi_rms_eval and jam_axi_vel_eval as they are, but they point into
+    the read-only mapping so must not be modified or freed; use
+    jam_axi_shared_detach instead.  Returns JAM_OK on success, JAM_ERR_IO if
+    the store could not be built or attached, or the status from
+    jam_axi_terms_check if terms are wanted for a model that cannot be
+    deprojected (checked before the store is touched).
+    
+    INPUTS
+      sh    : structure to hold the shared tables
+      path  : store file
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      lum   : projected luminous MGE
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      incl  : inclination [radians] (for the terms)
+      pot   : projected potential MGE (or NULL to share only the grids)
+      beta  : velocity anisotropy (1 - vz^2 / vr^2) (for the terms)
+      kappa : rotation parameter (for the terms, or NULL for second moments
+              only)
+              
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../store/store.h"
+
+
+static void jam_axi_shared_table( struct store_table *tab, int *ntab, \
+        char *name, double *val, long n ) {
+        
+    tab[*ntab].name = name;
+    tab[*ntab].val = val;
+    tab[*ntab].n = n;
+    (*ntab)++;
+    
+}
+
+
+static int jam_axi_shared_build( char *path, struct cache_key *key, \
+        double *xp, double *yp, int nxy, struct multigaussexp *lum, \
+        int nrad, int nang, double incl, struct multigaussexp *pot, \
+        double *beta, double *kappa ) {
+        
+    struct store_table tab[32];
+    struct jam_grid grms, gvel;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    double *surf, *surfrms, *surfvel;
+    int ntab = 0, nl, np, status;
+    
+    // grids and surface densities (radii, eccentric anomalies and angles
+    // are the same for both grids so are stored once)
+    grms = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, log( 0.99 ), \
+        log( 1.01 ), NULL );
+    gvel = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, -0.1, 0.1, NULL );
+    surf = mge_surf( lum, xp, yp, nxy );
+    surfrms = mge_surf( lum, grms.xpol, grms.ypol, grms.npol );
+    surfvel = mge_surf( lum, gvel.xpol, gvel.ypol, gvel.npol );
+    
+    jam_axi_shared_table( tab, &ntab, "grid.qmed", &grms.qmed, 1 );
+    jam_axi_shared_table( tab, &ntab, "grid.r", grms.r, nxy );
+    jam_axi_shared_table( tab, &ntab, "grid.e", grms.e, nxy );
+    jam_axi_shared_table( tab, &ntab, "grid.ang", grms.ang, nang );
+    jam_axi_shared_table( tab, &ntab, "grid.angvec", grms.angvec, \
+        4 * nang - 3 );
+    jam_axi_shared_table( tab, &ntab, "grms.rad", grms.rad, nrad );
+    jam_axi_shared_table( tab, &ntab, "grms.xpol", grms.xpol, grms.npol );
+    jam_axi_shared_table( tab, &ntab, "grms.ypol", grms.ypol, grms.npol );
+    jam_axi_shared_table( tab, &ntab, "grms.surf", surfrms, grms.npol );
+    jam_axi_shared_table( tab, &ntab, "gvel.rad", gvel.rad, nrad );
+    jam_axi_shared_table( tab, &ntab, "gvel.xpol", gvel.xpol, gvel.npol );
+    jam_axi_shared_table( tab, &ntab, "gvel.ypol", gvel.ypol, gvel.npol );
+    jam_axi_shared_table( tab, &ntab, "gvel.surf", surfvel, gvel.npol );
+    jam_axi_shared_table( tab, &ntab, "surf", surf, nxy );
+    
+    // deprojected MGEs and integrand terms
+    if ( pot != NULL ) {
+        lt = jam_axi_lumterms( lum, incl, beta, kappa );
+        pt = jam_axi_potterms( pot, incl );
+        nl = lt.ilum.ntotal;
+        np = pt.ipot.ntotal;
+        jam_axi_shared_table( tab, &ntab, "lum.area", lt.ilum.area, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.sigma", lt.ilum.sigma, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.q", lt.ilum.q, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.kani", lt.kani, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.s2l", lt.s2l, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.q2l", lt.q2l, nl );
+        jam_axi_shared_table( tab, &ntab, "lum.s2q2l", lt.s2q2l, nl );
+        if ( kappa != NULL ) \
+            jam_axi_shared_table( tab, &ntab, "lum.kappa", kappa, nl );
+        jam_axi_shared_table( tab, &ntab, "pot.area", pt.ipot.area, np );
+        jam_axi_shared_table( tab, &ntab, "pot.sigma", pt.ipot.sigma, np );
+        jam_axi_shared_table( tab, &ntab, "pot.q", pt.ipot.q, np );
+        jam_axi_shared_table( tab, &ntab, "pot.s2p", pt.s2p, np );
+        jam_axi_shared_table( tab, &ntab, "pot.e2p", pt.e2p, np );
+    }
+    
+    status = store_write( path, key, tab, ntab );
+    
+    if ( pot != NULL ) {
+        jam_axi_lumterms_free( &lt );
+        jam_axi_potterms_free( &pt );
+    }
+    jam_axi_grid_free( &grms );
+    jam_axi_grid_free( &gvel );
+    free( surf );
+    free( surfrms );
+    free( surfvel );
+    
+    return status;
+    
+}
+
+
+enum jam_status jam_axi_shared_attach( struct jam_shared *sh, char *path, \
+        double *xp, double *yp, int nxy, struct multigaussexp *lum, \
+        int nrad, int nang, double incl, struct multigaussexp *pot, \
+        double *beta, double *kappa ) {
+        
+    struct cache_key key;
+    int code = JAM_CACHE_CODE, fd;
+    long n;
+    enum jam_status status;
+    
+    // check that the model can be deprojected before doing any work
+    if ( pot != NULL ) {
+        status = jam_axi_terms_check( lum, pot, incl, beta );
+        if ( status != JAM_OK ) return status;
+    }
+    
+    // content key of the inputs
+    cache_key_init( &key );
+    cache_key_add( &key, &code, sizeof( int ) );
+    cache_key_add( &key, &nxy, sizeof( int ) );
+    cache_key_add( &key, xp, nxy * sizeof( double ) );
+    cache_key_add( &key, yp, nxy * sizeof( double ) );
+    cache_key_add( &key, &lum->ntotal, sizeof( int ) );
+    cache_key_add( &key, lum->area, lum->ntotal * sizeof( double ) );
+    cache_key_add( &key, lum->sigma, lum->ntotal * sizeof( double ) );
+    cache_key_add( &key, lum->q, lum->ntotal * sizeof( double ) );
+    cache_key_add( &key, &nrad, sizeof( int ) );
+    cache_key_add( &key, &nang, sizeof( int ) );
+    if ( pot != NULL ) {
+        cache_key_add( &key, &incl, sizeof( double ) );
+        cache_key_add( &key, &pot->ntotal, sizeof( int ) );
+        cache_key_add( &key, pot->area, pot->ntotal * sizeof( double ) );
+        cache_key_add( &key, pot->sigma, pot->ntotal * sizeof( double ) );
+        cache_key_add( &key, pot->q, pot->ntotal * sizeof( double ) );
+        cache_key_add( &key, beta, lum->ntotal * sizeof( double ) );
+        if ( kappa != NULL ) \
+            cache_key_add( &key, kappa, lum->ntotal * sizeof( double ) );
+    }
+    
+    // attach, or build the store if nobody else has
+    sh->st = store_attach( path, &key );
+    if ( sh->st == NULL ) {
+        fd = store_lock( path );
+        if ( fd < 0 ) return JAM_ERR_IO;
+        sh->st = store_attach( path, &key );
+        if ( sh->st == NULL && jam_axi_shared_build( path, &key, xp, yp, \
+                nxy, lum, nrad, nang, incl, pot, beta, kappa ) == 0 ) \
+            sh->st = store_attach( path, &key );
+        store_unlock( fd );
+        if ( sh->st == NULL ) return JAM_ERR_IO;
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // grids and surface densities
+    sh->grms.nrad = sh->gvel.nrad = nrad;
+    sh->grms.nang = sh->gvel.nang = nang;
+    sh->grms.npol = sh->gvel.npol = nrad * nang;
+    sh->grms.nxy = sh->gvel.nxy = nxy;
+    sh->grms.spec = sh->gvel.spec = 0;
+    sh->grms.qmed = sh->gvel.qmed = *store_get( sh->st, "grid.qmed", NULL );
+    sh->grms.r = sh->gvel.r = store_get( sh->st, "grid.r", NULL );
+    sh->grms.e = sh->gvel.e = store_get( sh->st, "grid.e", NULL );
+    sh->grms.ang = sh->gvel.ang = store_get( sh->st, "grid.ang", NULL );
+    sh->grms.angvec = sh->gvel.angvec = store_get( sh->st, "grid.angvec", \
+        NULL );
+    sh->grms.rad = store_get( sh->st, "grms.rad", NULL );
+    sh->grms.xpol = store_get( sh->st, "grms.xpol", NULL );
+    sh->grms.ypol = store_get( sh->st, "grms.ypol", NULL );
+    sh->surfrms = store_get( sh->st, "grms.surf", NULL );
+    sh->gvel.rad = store_get( sh->st, "gvel.rad", NULL );
+    sh->gvel.xpol = store_get( sh->st, "gvel.xpol", NULL );
+    sh->gvel.ypol = store_get( sh->st, "gvel.ypol", NULL );
+    sh->surfvel = store_get( sh->st, "gvel.surf", NULL );
+    sh->surf = store_get( sh->st, "surf", NULL );
+    
+    // deprojected MGEs and integrand terms
+    sh->terms = pot != NULL;
+    if ( sh->terms ) {
+        sh->lt.ilum.area = store_get( sh->st, "lum.area", &n );
+        sh->lt.ilum.ntotal = (int) n;
+        sh->lt.ilum.sigma = store_get( sh->st, "lum.sigma", NULL );
+        sh->lt.ilum.q = store_get( sh->st, "lum.q", NULL );
+        sh->lt.kani = store_get( sh->st, "lum.kani", NULL );
+        sh->lt.s2l = store_get( sh->st, "lum.s2l", NULL );
+        sh->lt.q2l = store_get( sh->st, "lum.q2l", NULL );
+        sh->lt.s2q2l = store_get( sh->st, "lum.s2q2l", NULL );
+        sh->lt.kappa = store_get( sh->st, "lum.kappa", NULL );
+        sh->pt.ipot.area = store_get( sh->st, "pot.area", &n );
+        sh->pt.ipot.ntotal = (int) n;
+        sh->pt.ipot.sigma = store_get( sh->st, "pot.sigma", NULL );
+        sh->pt.ipot.q = store_get( sh->st, "pot.q", NULL );
+        sh->pt.s2p = store_get( sh->st, "pot.s2p", NULL );
+        sh->pt.e2p = store_get( sh->st, "pot.e2p", NULL );
+    }
+    
+    return JAM_OK;
+    
+}
+
+
+void jam_axi_shared_detach( struct jam_shared *sh ) {
+    
+    store_detach( sh->st );
+    sh->st = NULL;
+    
+}
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_STOP
+    
+    Cancellation and budgets for a moment calculation, so that a sampler
+    can give up on a pathological model (one whose integrals blow up) and
+    move on.  The caller sets any of opts->cancel (a token that another
+    thread sets non-zero to cancel the calculation), opts->timeout (a
+    wall-clock budget [s]) and opts->maxeval (a budget of integrand
+    evaluations), and the entry point that is called starts the clock with
+    jam_axi_stop_start, which puts a struct jam_stop in opts->stop for all
+    the calculations below it (including those on other threads, which
+    share it through their copies of opts).  Entry points called below one
+    that has already started find opts->stop set and leave it alone, so the
+    budget is for the whole call.
+    
+    The integrands call jam_axi_stop_tick at every evaluation; it counts
+    the evaluations of its thread and checks the budget, with the lock and
+    the clock, only every JAM_STOP_POLL of them (jam_axi_stop_poll).  Once
+    the calculation has been cancelled or is over budget, every integrand
+    returns zero at once, so all the nested integrations finish promptly,
+    and the threads take no more positions.  jam_axi_stop_end then returns
+    JAM_ERR_CANCEL or JAM_ERR_BUDGET in place of the status of the
+    calculation, whose moments are then not meaningful (so that an entry
+    point called below another reports the stop too), and the entry point
+    that started the budget takes opts->stop away again.
+    
+    INPUTS (jam_axi_stop_start)
+      stop  : structure to hold the state of the budget
+      opts  : evaluation options (or NULL)
+      
+    OUTPUTS (jam_axi_stop_start)
+      1 if the budget was started (and must be ended), 0 if there is none
+      or it was started by a caller.
+      
+    INPUTS (jam_axi_stop_poll)
+      stop  : budget (or NULL for none)
+      neval : number of integrand evaluations since the last poll
+      
+    OUTPUTS (jam_axi_stop_poll)
+      JAM_OK, or the reason the calculation was stopped.
+      
+    INPUTS (jam_axi_stop_tick)
+      stop  : budget (or NULL for none)
+      neval : counter of integrand evaluations for this thread
+      
+    OUTPUTS (jam_axi_stop_tick)
+      Non-zero if the calculation has been stopped.
+      
+    INPUTS (jam_axi_stop_end)
+      stop   : budget from jam_axi_stop_start
+      opts   : evaluation options (or NULL)
+      own    : return value of jam_axi_stop_start
+      status : status of the calculation
+      
+    OUTPUTS (jam_axi_stop_end)
+      JAM_ERR_CANCEL or JAM_ERR_BUDGET if the calculation was stopped,
+      otherwise status.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "jam.h"
+
+
+static double jam_axi_stop_now( void ) {
+    
+    struct timespec ts;
+    
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    
+}
+
+
+int jam_axi_stop_start( struct jam_stop *stop, struct jam_opts *opts ) {
+    
+    if ( opts == NULL || opts->stop != NULL ) return 0;
+    if ( opts->cancel == NULL && opts->timeout <= 0. && opts->maxeval <= 0 ) \
+        return 0;
+        
+    stop->cancel = opts->cancel;
+    stop->t1 = ( opts->timeout > 0. ) ? \
+        jam_axi_stop_now() + opts->timeout : 0.;
+    stop->maxeval = opts->maxeval;
+    stop->neval = 0;
+    stop->status = JAM_OK;
+    pthread_mutex_init( &stop->lock, NULL );
+    opts->stop = stop;
+    
+    // a calculation cancelled before it starts does no work
+    jam_axi_stop_poll( stop, 0 );
+    
+    return 1;
+    
+}
+
+
+enum jam_status jam_axi_stop_poll( struct jam_stop *stop, long neval ) {
+    
+    if ( stop == NULL ) return JAM_OK;
+    
+    pthread_mutex_lock( &stop->lock );
+    stop->neval += neval;
+    if ( stop->status == JAM_OK ) {
+        if ( stop->cancel != NULL && *stop->cancel ) \
+            stop->status = JAM_ERR_CANCEL;
+        else if ( stop->maxeval > 0 && stop->neval > stop->maxeval ) \
+            stop->status = JAM_ERR_BUDGET;
+        else if ( stop->t1 > 0. && jam_axi_stop_now() > stop->t1 ) \
+            stop->status = JAM_ERR_BUDGET;
+    }
+    pthread_mutex_unlock( &stop->lock );
+    
+    return stop->status;
+    
+}
+
+
+int jam_axi_stop_tick( struct jam_stop *stop, long *neval ) {
+    
+    if ( stop == NULL ) return 0;
+    if ( stop->status != JAM_OK ) return 1;
+    if ( ++*neval < JAM_STOP_POLL ) return 0;
+    
+    *neval = 0;
+    return jam_axi_stop_poll( stop, JAM_STOP_POLL ) != JAM_OK;
+    
+}
+
+
+enum jam_status jam_axi_stop_end( struct jam_stop *stop, \
+        struct jam_opts *opts, int own, enum jam_status status ) {
+        
+    // the budget started by a caller, if any
+    if ( !own ) stop = ( opts == NULL ) ? NULL : opts->stop;
+    if ( stop == NULL ) return status;
+    if ( stop->status != JAM_OK ) status = stop->status;
+    
+    if ( own ) {
+        opts->stop = NULL;
+        pthread_mutex_destroy( &stop->lock );
+    }
+    
+    return status;
+    
+}
@@ -0,0 +1,131 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_TERMS
+    
+    Deprojects the luminous and potential MGEs and precomputes the
+    per-component quantities needed by the moment integrands.  Tracer terms
+    depend only on the luminous MGE and its beta and kappa, and potential
+    terms only on the potential MGE, so each can be shared across every model
+    that uses the same tracer or potential.
+    
+    jam_axi_terms_check is the cheap check, made up front by every program
+    that takes a model, that the terms can be made: it returns JAM_ERR_INCL
+    if the inclination is too low for a component of either MGE (q' < cos i),
+    JAM_ERR_FLAT if a component would be flatter than q = 0.05 when
+    deprojected, JAM_ERR_INPUT if an anisotropy is not below 1, and JAM_OK
+    otherwise.  Any of lum, pot and beta may be NULL to skip their checks.
+    It also turns off the default GSL error handler (see jam_axi_gsl_init).
+    
+    INPUTS
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      incl  : inclination [radians]
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      kappa : rotation parameter (may be NULL for second moments)
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+struct jam_lumterms jam_axi_lumterms( struct multigaussexp *lum, double incl, \
+        double *beta, double *kappa ) {
+    
+    struct jam_lumterms lt;
+    int i;
+    
+    // convert from projected MGE to intrinsic MGE
+    lt.ilum = mge_deproject( lum, incl );
+    lt.kappa = kappa;
+    
+    lt.kani = (double *) malloc( lt.ilum.ntotal * sizeof( double ) );
+    lt.s2l = (double *) malloc( lt.ilum.ntotal * sizeof( double ) );
+    lt.q2l = (double *) malloc( lt.ilum.ntotal * sizeof( double ) );
+    lt.s2q2l = (double *) malloc( lt.ilum.ntotal * sizeof( double ) );
+    
+    for ( i = 0; i < lt.ilum.ntotal; i++ ) {
+        lt.kani[i] = 1. / ( 1. - beta[i] );
+        lt.s2l[i] = pow( lt.ilum.sigma[i], 2. );
+        lt.q2l[i] = pow( lt.ilum.q[i], 2. );
+        lt.s2q2l[i] = lt.s2l[i] * lt.q2l[i];
+    }
+    
+    return lt;
+    
+}
+
+
+struct jam_potterms jam_axi_potterms( struct multigaussexp *pot, \
+        double incl ) {
+    
+    struct jam_potterms pt;
+    int i;
+    
+    // convert from projected MGE to intrinsic MGE
+    pt.ipot = mge_deproject( pot, incl );
+    
+    pt.s2p = (double *) malloc( pt.ipot.ntotal * sizeof( double ) );
+    pt.e2p = (double *) malloc( pt.ipot.ntotal * sizeof( double ) );
+    
+    for ( i = 0; i < pt.ipot.ntotal; i++ ) {
+        pt.s2p[i] = pow( pt.ipot.sigma[i], 2. );
+        pt.e2p[i] = 1. - pow( pt.ipot.q[i], 2. );
+    }
+    
+    return pt;
+    
+}
+
+
+void jam_axi_lumterms_free( struct jam_lumterms *lt ) {
+    
+    free( lt->ilum.area );
+    free( lt->ilum.sigma );
+    free( lt->ilum.q );
+    free( lt->kani );
+    free( lt->s2l );
+    free( lt->q2l );
+    free( lt->s2q2l );
+    
+}
+
+
+void jam_axi_potterms_free( struct jam_potterms *pt ) {
+    
+    free( pt->ipot.area );
+    free( pt->ipot.sigma );
+    free( pt->ipot.q );
+    free( pt->s2p );
+    free( pt->e2p );
+    
+}
+
+
+enum jam_status jam_axi_terms_check( struct multigaussexp *lum, \
+        struct multigaussexp *pot, double incl, double *beta ) {
+        
+    int i, chk = 0;
+    
+    jam_axi_gsl_init();
+    
+    if ( lum != NULL ) chk = mge_deproject_check( lum, incl );
+    if ( chk == 0 && pot != NULL ) chk = mge_deproject_check( pot, incl );
+    if ( chk == 1 ) return JAM_ERR_INCL;
+    if ( chk == 2 ) return JAM_ERR_FLAT;
+    
+    if ( lum != NULL && beta != NULL ) for ( i = 0; i < lum->ntotal; i++ ) \
+        if ( !( beta[i] < 1. ) ) return JAM_ERR_INPUT;
+        
+    return JAM_OK;
+    
+}
@@ -2,6 +2,7 @@
   JAM_AXI_VEL
     
     Wrapper for first moment calculator designed to interface with Python.
+    The moments are written straight into the arrays given.
     
     INPUTS
       xp : projected x' [pc]
@@ -21,6 +22,18 @@
       vx : array to hold the vx first moments calculated
       vy : array to hold the vy first moments calculated
       vz : array to hold the vz first moments calculated
+      posflag : array to hold the integration status at each position, 0
+        if its integrals succeeded (or NULL; see jam_axi_vel_cross)
+      poserr : array to hold the relative error estimate at each position
+        (or NULL)
+      nthread : number of threads for the integrals (0 or 1 for one,
+        negative to use all available processors)
+    
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check if the model cannot be
+      deprojected (checked before any work is done), or JAM_ERR_INTEGRAL if
+      the integration flag is set, in which case posflag shows which
+      positions failed and the moments at the others are still good.
 ---------------------------------------------------------------------------- */
 
 #include <stdio.h>
@@ -30,15 +43,23 @@
 #include "../mge/mge.h"
 
 
-void jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
+enum jam_status jam_axi_vel(double *xp, double *yp, int nxy, double incl, \
 double *lum_area, double *lum_sigma, double *lum_q, int lum_total, \
 double *pot_area, double *pot_sigma, double *pot_q, int pot_total, \
 double *beta, double *kappa, int nrad, int nang, int* integrationFlag, \
-double *vx, double *vy, double *vz) {
+double *vx, double *vy, double *vz, int *posflag, double *poserr, \
+int nthread) {
     
     struct multigaussexp lum, pot;
+    struct jam_opts opts = { NULL };
     struct jam_vel vm;
-    int i, j, k, check;
+    enum jam_status status;
+    int i, check;
+    
+    // evaluation options
+    opts.nthread = nthread;
+    opts.posflag = posflag;
+    opts.poserr = poserr;
     
     // put luminous MGE components into structure
     lum.area = lum_area;
@@ -52,34 +73,30 @@ double *vx, double *vy, double *vz) {
     pot.q = pot_q;
     pot.ntotal = pot_total;
     
+    // reject models that cannot be deprojected
+    status = jam_axi_terms_check(&lum, &pot, incl, beta);
+    if (status!=JAM_OK) return status;
+    
     // check for at least 1 rotating, non-spherical, non-isotropic component
-    check = 0;
-    for (k=0; k<lum.ntotal; k++) for (j=0; j<pot.ntotal; j++)
-        if ( (kappa[k]!=0.) & ((beta[k]!=0.)|(lum.q[k]!=1.)|(pot.q[j]!=1.)) )
-            check++;
+    check = jam_axi_vel_check(&lum, &pot, beta, kappa);
     
     if (check>0) {
-        // calculate moments and put into results arrays
-        vm = jam_axi_vel_mmt(xp, yp, nxy, incl, &lum, &pot, beta, kappa,
-            nrad, nang, integrationFlag);
-        for (i=0; i<nxy; i++) {
-            vx[i] = vm.vx[i];
-            vy[i] = vm.vy[i];
-            vz[i] = vm.vz[i];
-        }
-        
-        // free memory
-        free(vm.vx);
-        free(vm.vy);
-        free(vm.vz);
+        // calculate moments straight into results arrays
+        vm.vx = vx;
+        vm.vy = vy;
+        vm.vz = vz;
+        jam_axi_vel_cross(xp, yp, nxy, incl, &lum, &beta, &kappa, 1, &pot, 1,
+            nrad, nang, integrationFlag, &vm, &opts);
     } else {
         // return zeros
         for (i=0; i<nxy; i++) {
             vx[i] = 0.;
             vy[i] = 0.;
             vz[i] = 0.;
+            if (posflag!=NULL) posflag[i] = 0;
+            if (poserr!=NULL) poserr[i] = 0.;
         }
     }
     
-    return;
+    return (*integrationFlag!=0) ? JAM_ERR_INTEGRAL : JAM_OK;
 }
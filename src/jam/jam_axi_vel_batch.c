@@ -0,0 +1,277 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_BATCH
+    
+    Calculates first moments for a batch of models that share the same
+    positions and tracer MGE, e.g. the walkers of an ensemble sampler.  Work
+    that depends only on the positions and the tracer (interpolation grid,
+    elliptical radii and eccentric anomalies, surface densities) is done
+    once for the whole batch, and the models are shared out between threads.
+    Models with no rotating, non-spherical, non-isotropic component are set
+    to zero.
+    Whether to interpolate, calculate directly or mix the two is chosen once
+    for the batch by jam_axi_plan.  A budget set in opts (see jam_axi_stop)
+    is for each model, so that one pathological model does not hold up the
+    rest: a model that runs over it is skipped like one that cannot be
+    deprojected, and once the batch is cancelled every model that is left
+    is skipped.  The integration status and error estimate at each position
+    (opts->posflag and opts->poserr) are not reported for a batch.  Each
+    thread works in a workspace of its own (see jam_axi_ws), which is kept
+    in opts->ws, if it is set, for the next batch.
+    
+    INPUTS
+      xp      : projected x' [pc]
+      yp      : projected y' [pc]
+      nxy     : number of x' and y' values given
+      lum     : projected luminous MGE
+      model   : parameters of each model (inclination, anisotropy, rotation
+                and projected potential MGE)
+      nmodel  : number of models
+      nrad    : number of radial bins in interpolation grid
+      nang    : number of angular bins in interpolation grid
+      nthread : number of threads (0 for one, negative to use all
+                available processors)
+      integrationFlag : nmodel integration flags, one for each model
+      mu      : nmodel velocity structures (with arrays of nxy values
+                allocated) to hold the first moments
+      opts    : evaluation options (or NULL for defaults)
+      
+    OUTPUTS
+      JAM_OK if every model was calculated, otherwise the status from
+      jam_axi_terms_check for the first model that cannot be deprojected
+      (such models are skipped, with their moments set to zero and their
+      integration flag set to -1), otherwise JAM_ERR_CANCEL or
+      JAM_ERR_BUDGET for the first model that was stopped (skipped in the
+      same way), or JAM_ERR_INTEGRAL if any integration flag is set.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+// work shared between threads
+struct vel_batch {
+    struct multigaussexp *lum;
+    struct jam_model *model;
+    struct jam_grid *grid;
+    struct jam_vel *mu;
+    struct jam_opts *opts;
+    struct jam_plan *plan;
+    struct jam_workspace *ws;
+    enum jam_status status;
+    double *surf, *surfpol;
+    int nxy, nmodel, nstart, next, *integrationFlag;
+    pthread_mutex_t lock;
+};
+
+
+static void *jam_axi_vel_batch_worker( void *arg ) {
+    
+    struct vel_batch *b = arg;
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_model *m;
+    struct jam_opts opts = { NULL }, *op = &opts;
+    struct jam_workspace wown = { NULL }, *ws;
+    struct jam_plan *p = b->plan;
+    struct jam_stop stop;
+    enum jam_status s;
+    double *res;
+    int i, n, own, ng = p->ngrid, nxy = b->nxy;
+    
+    // workspace of this thread, kept in that of the caller if there is one
+    pthread_mutex_lock( &b->lock );
+    i = b->nstart++;
+    pthread_mutex_unlock( &b->lock );
+    ws = ( b->ws != NULL ) ? &b->ws[i] : &wown;
+    
+    // private copy of the options, so that threads report separately and
+    // do not each start threads of their own
+    if ( b->opts != NULL ) {
+        opts = *b->opts;
+        opts.npol = 0;
+        opts.err = 0.;
+        opts.posflag = NULL;
+        opts.poserr = NULL;
+        for ( i = 0; i < 3; i++ ) opts.sentmax[i] = opts.sentrms[i] = 0.;
+    }
+    opts.ws = ws;
+    opts.nthread = 1;
+    res = jam_axi_ws_buf( ws, JAM_WS_RES, 3 * nxy * sizeof( double ) );
+    
+    while ( 1 ) {
+        
+        // take the next model
+        pthread_mutex_lock( &b->lock );
+        n = b->next++;
+        pthread_mutex_unlock( &b->lock );
+        if ( n >= b->nmodel ) break;
+        
+        // check that integration flag is zero or don't proceed
+        if ( b->integrationFlag[n] != 0 ) continue;
+        
+        // check for at least 1 rotating, non-spherical, non-isotropic
+        // component
+        m = &b->model[n];
+        if ( jam_axi_vel_check( b->lum, m->pot, m->beta, m->kappa ) == 0 ) {
+            for ( i = 0; i < b->nxy; i++ ) {
+                b->mu[n].vx[i] = 0.;
+                b->mu[n].vy[i] = 0.;
+                b->mu[n].vz[i] = 0.;
+            }
+            continue;
+        }
+        
+        own = jam_axi_stop_start( &stop, op );
+        lt = jam_axi_lumterms( b->lum, m->incl, m->beta, m->kappa );
+        pt = jam_axi_potterms( m->pot, m->incl );
+        if ( ng > 0 ) jam_axi_vel_eval( p->xp, p->yp, ng, m->incl, &lt, \
+            &pt, b->grid, NULL, b->surfpol, &b->integrationFlag[n], res, \
+            &res[nxy], &res[2*nxy], op );
+        if ( p->ndirect > 0 ) jam_axi_vel_eval( &p->xp[ng], &p->yp[ng], \
+            p->ndirect, m->incl, &lt, &pt, NULL, b->surf, NULL, \
+            &b->integrationFlag[n], &res[ng], &res[nxy+ng], \
+            &res[2*nxy+ng], op );
+        
+        // a model stopped by its budget is skipped
+        s = jam_axi_stop_end( &stop, op, own, JAM_OK );
+        if ( s != JAM_OK ) {
+            b->integrationFlag[n] = -1;
+            for ( i = 0; i < 3 * nxy; i++ ) res[i] = 0.;
+            pthread_mutex_lock( &b->lock );
+            if ( b->status == JAM_OK ) b->status = s;
+            pthread_mutex_unlock( &b->lock );
+        }
+        
+        for ( i = 0; i < nxy; i++ ) {
+            b->mu[n].vx[p->idx[i]] = res[i];
+            b->mu[n].vy[p->idx[i]] = res[nxy+i];
+            b->mu[n].vz[p->idx[i]] = res[2*nxy+i];
+        }
+        jam_axi_lumterms_free( &lt );
+        jam_axi_potterms_free( &pt );
+        
+    }
+    jam_axi_ws_put( ws, res );
+    jam_axi_ws_free( &wown );
+    
+    // largest adaptive grid and errors over all threads
+    if ( b->opts != NULL ) {
+        pthread_mutex_lock( &b->lock );
+        if ( opts.npol > b->opts->npol ) b->opts->npol = opts.npol;
+        if ( opts.err > b->opts->err ) b->opts->err = opts.err;
+        for ( i = 0; i < 3; i++ ) {
+            if ( opts.sentmax[i] > b->opts->sentmax[i] ) \
+                b->opts->sentmax[i] = opts.sentmax[i];
+            if ( opts.sentrms[i] > b->opts->sentrms[i] ) \
+                b->opts->sentrms[i] = opts.sentrms[i];
+        }
+        pthread_mutex_unlock( &b->lock );
+    }
+    
+    return NULL;
+    
+}
+
+
+enum jam_status jam_axi_vel_batch( double *xp, double *yp, int nxy, \
+        struct multigaussexp *lum, struct jam_model *model, int nmodel, \
+        int nrad, int nang, int nthread, int* integrationFlag, \
+        struct jam_vel *mu, struct jam_opts *opts ) {
+    
+    struct vel_batch b;
+    struct jam_grid grid;
+    struct jam_plan plan;
+    pthread_t *threads;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    enum jam_status status = JAM_OK, s;
+    int i, t, nrun, npc;
+    
+    // skip the models that cannot be deprojected
+    for ( t = 0; t < nmodel; t++ ) {
+        s = jam_axi_terms_check( lum, model[t].pot, model[t].incl, \
+            model[t].beta );
+        if ( s == JAM_OK ) continue;
+        if ( status == JAM_OK ) status = s;
+        integrationFlag[t] = -1;
+        for ( i = 0; i < nxy; i++ ) \
+            mu[t].vx[i] = mu[t].vy[i] = mu[t].vz[i] = 0.;
+    }
+    
+    b.lum = lum;
+    b.model = model;
+    b.nxy = nxy;
+    b.nmodel = nmodel;
+    b.next = 0;
+    b.integrationFlag = integrationFlag;
+    b.mu = mu;
+    b.opts = opts;
+    b.status = JAM_OK;
+    pthread_mutex_init( &b.lock, NULL );
+    
+    // choose the positions to interpolate and to calculate directly
+    npc = 0;
+    for ( t = 0; t < nmodel; t++ ) \
+        if ( model[t].pot->ntotal > npc ) npc = model[t].pot->ntotal;
+    jam_axi_plan( &plan, xp, yp, nxy, lum, npc, nrad, nang, 1, opts );
+    b.plan = &plan;
+    
+    // position and tracer terms shared by all models
+    b.grid = NULL;
+    b.surf = NULL;
+    b.surfpol = NULL;
+    if ( plan.ndirect > 0 ) b.surf = mge_surf( lum, &plan.xp[plan.ngrid], \
+        &plan.yp[plan.ngrid], plan.ndirect );
+    if ( plan.ngrid > 0 ) {
+        if ( opts != NULL && opts->spectral ) grid = jam_axi_grid_spec( \
+            plan.xp, plan.yp, plan.ngrid, lum, nrad, nang, -0.1, 0.1, ws );
+        else grid = jam_axi_grid( plan.xp, plan.yp, plan.ngrid, lum, nrad, \
+            nang, -0.1, 0.1, ws );
+        b.grid = &grid;
+        b.surfpol = mge_surf( lum, grid.xpol, grid.ypol, grid.npol );
+    }
+    
+    // share the models out between threads
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread > nmodel ) nthread = nmodel;
+    if ( nthread < 1 ) nthread = 1;
+    threads = jam_axi_ws_buf( ws, JAM_WS_THREADS, \
+        nthread * sizeof( pthread_t ) );
+    if ( threads == NULL ) nthread = 1;
+    
+    // each thread has a workspace of its own, kept in the caller's
+    b.ws = jam_axi_ws_split( ws, nthread );
+    b.nstart = 0;
+    // a thread that cannot be created stops the rest, and those running
+    // (at least the calling thread) take on its share of the work
+    for ( nrun = 1; nrun < nthread; nrun++ ) if ( pthread_create( \
+        &threads[nrun], NULL, &jam_axi_vel_batch_worker, &b ) != 0 ) break;
+    jam_axi_vel_batch_worker( &b );
+    for ( t = 1; t < nrun; t++ ) pthread_join( threads[t], NULL );
+    
+    jam_axi_ws_put( ws, threads );
+    pthread_mutex_destroy( &b.lock );
+    if ( b.grid != NULL ) jam_axi_grid_free( &grid );
+    free( b.surfpol );
+    free( b.surf );
+    jam_axi_plan_free( &plan );
+    
+    if ( status == JAM_OK ) status = b.status;
+    for ( t = 0; t < nmodel && status == JAM_OK; t++ ) \
+        if ( integrationFlag[t] != 0 ) status = JAM_ERR_INTEGRAL;
+        
+    return status;
+    
+}
@@ -0,0 +1,42 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_CHECK
+    
+    Counts the combinations of luminous and potential MGE components that are
+    rotating and non-spherical or non-isotropic.  The first moment integrals
+    fail for spherical, isotropic, non-rotating models, so first moments
+    should only be calculated when this is non-zero.
+    
+    INPUTS
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      kappa : rotation parameter
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+int jam_axi_vel_check( struct multigaussexp *lum, struct multigaussexp *pot, \
+        double *beta, double *kappa ) {
+    
+    int j, k, check;
+    
+    check = 0;
+    for ( k = 0; k < lum->ntotal; k++ ) for ( j = 0; j < pot->ntotal; j++ )
+        if ( ( kappa[k] != 0. ) & ( ( beta[k] != 0. ) | ( lum->q[k] != 1. ) \
+            | ( pot->q[j] != 1. ) ) ) check++;
+    
+    return check;
+    
+}
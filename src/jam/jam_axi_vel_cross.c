@@ -0,0 +1,206 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_CROSS
+    
+    Calculates first moments for every combination of a set of tracer MGEs
+    and a set of potential MGEs in one pass.  Tracer-only work (deprojection,
+    interpolation grid, surface densities) is done once per tracer and
+    potential-only work (deprojection, s2p, e2p) once per potential, and both
+    are shared across all members of the cross product.  Combinations with no
+    rotating, non-spherical, non-isotropic component are set to zero.
+    Whether to interpolate, calculate directly or mix the two is chosen per
+    tracer by jam_axi_plan.  If opts->posflag or opts->poserr is set, the
+    integration status and error estimate at each position, the worst over
+    all the combinations, are put there (see jam_axi_vel_eval).
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lum   : projected luminous MGEs (nlum of them)
+      beta  : velocity anisotropy (1 - vz^2 / vr^2) for each luminous MGE
+      kappa : rotation parameter for each luminous MGE
+      nlum  : number of luminous MGEs
+      pot   : projected potential MGEs (npot of them)
+      npot  : number of potential MGEs
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      mu    : nlum*npot velocity structures with arrays of nxy values to hold
+              the first moments, the moments for luminous MGE l in potential
+              p go in mu[l*npot+p]
+      opts  : evaluation options (or NULL for defaults)
+      
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check for a model that cannot be
+      deprojected (checked before any work is done), JAM_ERR_INTEGRAL if
+      the integration flag is set, or JAM_ERR_CANCEL or JAM_ERR_BUDGET if
+      the calculation was stopped (see jam_axi_stop), in which case the
+      moments are incomplete.
+      
+    NOTES
+      * Based on janis1_first_moment IDL code by Michele Cappellari.
+      * This version does not implement PSF convolution.
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+enum jam_status jam_axi_vel_cross( double *xp, double *yp, int nxy, \
+        double incl, struct multigaussexp *lum, double **beta, double **kappa, \
+        int nlum, struct multigaussexp *pot, int npot, int nrad, int nang, \
+        int* integrationFlag, struct jam_vel *mu, struct jam_opts *opts ) {
+    
+    int i, l, m, npc, ng, own;
+    enum jam_status status;
+    struct jam_stop stop;
+    double *surf, *surfpol, *res;
+    int *posflag = NULL, *pf = NULL;
+    double *poserr = NULL, *pe = NULL;
+    struct jam_lumterms lt;
+    struct jam_potterms *pt;
+    struct jam_grid grid;
+    struct jam_plan plan;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    
+    // check that integration flag is zero or don't proceed
+    if (*integrationFlag!=0) return JAM_ERR_INTEGRAL;
+    
+    // check that every model can be deprojected before doing any work
+    for ( l = 0; l < nlum; l++ ) {
+        status = jam_axi_terms_check( &lum[l], NULL, incl, beta[l] );
+        if ( status != JAM_OK ) return status;
+    }
+    for ( m = 0; m < npot; m++ ) {
+        status = jam_axi_terms_check( NULL, &pot[m], incl, NULL );
+        if ( status != JAM_OK ) return status;
+    }
+    
+    // budget for the whole calculation
+    own = jam_axi_stop_start( &stop, opts );
+    
+    // integration status at the positions, the worst over all the models,
+    // with that of each model put in the plan order first
+    if ( opts != NULL && opts->posflag != NULL ) {
+        posflag = opts->posflag;
+        pf = jam_axi_ws_buf( ws, JAM_WS_RFLAG, nxy * sizeof( int ) );
+        for ( i = 0; i < nxy; i++ ) posflag[i] = 0;
+    }
+    if ( opts != NULL && opts->poserr != NULL ) {
+        poserr = opts->poserr;
+        pe = jam_axi_ws_buf( ws, JAM_WS_RERR, nxy * sizeof( double ) );
+        for ( i = 0; i < nxy; i++ ) poserr[i] = 0.;
+    }
+    
+    // potential terms are shared by all tracers
+    pt = (struct jam_potterms *) malloc( npot * sizeof( struct jam_potterms ) );
+    npc = 0;
+    for ( m = 0; m < npot; m++ ) {
+        pt[m] = jam_axi_potterms( &pot[m], incl );
+        if ( pot[m].ntotal > npc ) npc = pot[m].ntotal;
+    }
+    res = jam_axi_ws_buf( ws, JAM_WS_RES, 3 * nxy * sizeof( double ) );
+    
+    for ( l = 0; l < nlum; l++ ) {
+        
+        if ( jam_axi_stop_poll( opts == NULL ? NULL : opts->stop, 0 ) \
+            != JAM_OK ) break;
+            
+        // choose the positions to interpolate and to calculate directly
+        jam_axi_plan( &plan, xp, yp, nxy, &lum[l], npc, nrad, nang, 1, opts );
+        ng = plan.ngrid;
+        
+        // tracer terms are shared by all potentials
+        lt = jam_axi_lumterms( &lum[l], incl, beta[l], kappa[l] );
+        
+        // surface brightness at the positions to calculate directly
+        surf = NULL;
+        if ( plan.ndirect > 0 ) surf = mge_surf( &lum[l], &plan.xp[ng], \
+            &plan.yp[ng], plan.ndirect );
+        
+        // interpolation grid (or spectral nodes), and surface brightness on
+        // it, covering the positions to interpolate
+        surfpol = NULL;
+        if ( ng > 0 ) {
+            if ( opts != NULL && opts->spectral ) grid = jam_axi_grid_spec( \
+                plan.xp, plan.yp, ng, &lum[l], nrad, nang, -0.1, 0.1, ws );
+            else grid = jam_axi_grid( plan.xp, plan.yp, ng, &lum[l], nrad, \
+                nang, -0.1, 0.1, ws );
+            surfpol = mge_surf( &lum[l], grid.xpol, grid.ypol, grid.npol );
+        }
+        
+        for ( m = 0; m < npot; m++ ) {
+            
+            if ( jam_axi_stop_poll( opts == NULL ? NULL : opts->stop, 0 ) \
+                != JAM_OK ) break;
+                
+            // check for at least 1 rotating, non-spherical,
+            // non-isotropic component
+            if ( jam_axi_vel_check( &lum[l], &pot[m], beta[l], kappa[l] ) \
+                    == 0 ) {
+                for ( i = 0; i < nxy; i++ ) {
+                    mu[l*npot+m].vx[i] = 0.;
+                    mu[l*npot+m].vy[i] = 0.;
+                    mu[l*npot+m].vz[i] = 0.;
+                }
+                continue;
+            }
+            
+            // integration status of this combination, in the plan order
+            if ( opts != NULL ) {
+                opts->posflag = pf;
+                opts->poserr = pe;
+            }
+            if ( ng > 0 ) jam_axi_vel_eval( plan.xp, plan.yp, ng, incl, \
+                &lt, &pt[m], &grid, NULL, surfpol, integrationFlag, res, \
+                &res[nxy], &res[2*nxy], opts );
+            if ( opts != NULL ) {
+                opts->posflag = ( pf == NULL ) ? NULL : &pf[ng];
+                opts->poserr = ( pe == NULL ) ? NULL : &pe[ng];
+            }
+            if ( plan.ndirect > 0 ) jam_axi_vel_eval( &plan.xp[ng], \
+                &plan.yp[ng], plan.ndirect, incl, &lt, &pt[m], NULL, surf, \
+                NULL, integrationFlag, &res[ng], &res[nxy+ng], \
+                &res[2*nxy+ng], opts );
+            for ( i = 0; i < nxy; i++ ) {
+                mu[l*npot+m].vx[plan.idx[i]] = res[i];
+                mu[l*npot+m].vy[plan.idx[i]] = res[nxy+i];
+                mu[l*npot+m].vz[plan.idx[i]] = res[2*nxy+i];
+            }
+            jam_axi_posstat( nxy, plan.idx, pf, pe, posflag, poserr );
+            
+        }
+        
+        if ( ng > 0 ) jam_axi_grid_free( &grid );
+        free( surf );
+        free( surfpol );
+        jam_axi_lumterms_free( &lt );
+        jam_axi_plan_free( &plan );
+        
+    }
+    
+    jam_axi_ws_put( ws, res );
+    jam_axi_ws_put( ws, pf );
+    jam_axi_ws_put( ws, pe );
+    if ( opts != NULL ) {
+        opts->posflag = posflag;
+        opts->poserr = poserr;
+    }
+    for ( m = 0; m < npot; m++ ) jam_axi_potterms_free( &pt[m] );
+    free( pt );
+    
+    status = ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    return jam_axi_stop_end( &stop, opts, own, status );
+    
+}
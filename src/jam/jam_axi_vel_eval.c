@@ -0,0 +1,286 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_EVAL
+    
+    Calculates first moments for one tracer and one potential from their
+    precomputed terms, either directly at the input positions or on a
+    precomputed polar grid followed by interpolation.  If opts->nsentinel
+    is set, the interpolated moments are also calculated directly at that
+    many sentinel positions (see jam_axi_sentinel), and the errors are
+    reported in opts->sentmax and opts->sentrms (for vx, vy and vz).  Direct
+    calculation folds the positions onto one quadrant and integrates each
+    unique folded position once (merging those within opts->merge, see
+    jam_axi_fold).
+    
+    If opts->posflag or opts->poserr is set, the integration status and
+    relative error estimate at each input position are put there, as for
+    jam_axi_rms_eval (see jam_axi_vel_wmmt).
+    
+    jam_axi_vel_quad does the grid part alone: it returns the vx, vy and vz
+    maps (one after the other) on the nodes of the grid to interpolate from
+    (refined and put in agrid if opts asks for an adaptive grid), ready for
+    jam_axi_interp with s1=1, s2=-1 for vx and s1=s2=-1 for vy and vz.
+    
+    INPUTS
+      xp      : projected x' [pc]
+      yp      : projected y' [pc]
+      nxy     : number of x' and y' values given
+      incl    : inclination [radians]
+      lt      : tracer terms from jam_axi_lumterms (with kappa set)
+      pt      : potential terms from jam_axi_potterms
+      grid    : polar interpolation grid, or NULL to calculate directly
+      surf    : tracer surface density at the input positions (if grid is
+                NULL)
+      surfpol : tracer surface density on the grid (if grid is given)
+      vx, vy, vz : arrays to hold the first moments
+      opts    : evaluation options (or NULL for defaults)
+      
+    INPUTS (jam_axi_vel_quad, as above and)
+      agrid   : grid structure to hold an adaptive grid
+      gp      : set to the grid to interpolate from (grid or agrid)
+      
+    NOTES
+      * Based on janis1_first_moment IDL code by Michele Cappellari.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+double* jam_axi_vel_quad( struct jam_grid *grid, struct jam_lumterms *lt, \
+        struct jam_potterms *pt, double incl, double *surfpol, \
+        int* integrationFlag, struct jam_grid *agrid, struct jam_grid **gp, \
+        struct jam_opts *opts ) {
+        
+    int k, v, n;
+    double *quad, err, qtol = opts == NULL ? 0. : opts->quad;
+    int nthread = opts == NULL ? 0 : opts->nthread;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    struct jam_stop *stop = opts == NULL ? NULL : opts->stop;
+    struct cache *cache = opts == NULL ? NULL : opts->cache;
+    struct cache_key key;
+    struct jam_vel wm1;
+    
+    *gp = grid;
+    
+    // cached maps are only for integrals at the default precision
+    if ( qtol > 0. && qtol != 1. ) cache = NULL;
+    
+    // refine the grid until the maps meet the tolerance
+    if ( opts != NULL && opts->tol > 0. && !grid->spec ) {
+        quad = jam_axi_adapt( grid, lt, pt, incl, surfpol, 0, opts->tol, \
+            qtol, nthread, ws, stop, integrationFlag, agrid, &err );
+        *gp = agrid;
+        n = agrid->npol;
+        if ( n > opts->npol ) opts->npol = n;
+        if ( err > opts->err ) opts->err = err;
+        cache = NULL;
+    }
+    
+    // first moments on polar grid (stored as vx, vy, vz maps)
+    else {
+        n = grid->npol;
+        quad = (double *) malloc( 3 * n * sizeof( double ) );
+    }
+    
+    // look for the polar grid maps in the cache
+    if ( cache != NULL ) {
+        jam_axi_cache_key( &key, 0, incl, lt, pt, grid->xpol, grid->ypol, n );
+    }
+    if ( *gp == grid && \
+            ( cache == NULL || cache_get( cache, &key, quad, 3 * n ) != 0 ) ) {
+        
+        // weighted first moments on polar grid, straight into the maps
+        wm1.vx = quad;
+        wm1.vy = &quad[n];
+        wm1.vz = &quad[2*n];
+        jam_axi_vel_wmmt( grid->xpol, grid->ypol, n, incl, lt, pt, \
+            integrationFlag, qtol, nthread, &wm1, NULL, NULL, stop, ws );
+            
+        for ( v = 0; v < 3; v++ ) \
+            for ( k = 0; k < n; k++ ) quad[v*n+k] /= surfpol[k];
+        
+        // moments of a stopped calculation are not kept
+        if ( cache != NULL && *integrationFlag == 0 \
+            && jam_axi_stop_poll( stop, 0 ) == JAM_OK ) \
+            cache_put( cache, &key, quad, 3 * n );
+            
+    }
+    
+    return quad;
+    
+}
+
+
+void jam_axi_vel_eval( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, \
+        struct jam_grid *grid, double *surf, double *surfpol, \
+        int* integrationFlag, double *vx, double *vy, double *vz, \
+        struct jam_opts *opts ) {
+        
+    int i, n, ns, nf, f0, *idx, *rep, *map, *pf;
+    double *quad, *wm, *xs, *ys, *ss, *exact, *xf, *yf, *pe;
+    int *posflag = opts == NULL ? NULL : opts->posflag;
+    double *poserr = opts == NULL ? NULL : opts->poserr;
+    double sr, sx, sy, qtol = opts == NULL ? 0. : opts->quad;
+    double merge = opts == NULL ? 0. : opts->merge;
+    int nthread = opts == NULL ? 0 : opts->nthread;
+    struct jam_workspace *ws = opts == NULL ? NULL : opts->ws;
+    struct jam_stop *stop = opts == NULL ? NULL : opts->stop;
+    struct cache *cache = opts == NULL ? NULL : opts->cache;
+    struct cache_key key;
+    struct jam_grid agrid, *gp = grid;
+    struct multigaussexp plum;
+    struct jam_vel wm1;
+    struct jam_opts so = { NULL };
+    
+    // calculate directly when computing just a few points
+    if ( grid == NULL ) {
+        
+        // look for these moments in the cache (stored as vx, vy, vz)
+        // (not those of merged positions, which are only approximate)
+        if ( ( qtol > 0. && qtol != 1. ) || merge > 0. ) cache = NULL;
+        if ( cache != NULL ) {
+            jam_axi_cache_key( &key, 0, incl, lt, pt, xp, yp, nxy );
+            quad = jam_axi_ws_buf( ws, JAM_WS_CMU, \
+                3 * nxy * sizeof( double ) );
+            if ( cache_get( cache, &key, quad, 3 * nxy ) == 0 ) {
+                for ( i = 0; i < nxy; i++ ) {
+                    vx[i] = quad[i];
+                    vy[i] = quad[nxy+i];
+                    vz[i] = quad[2*nxy+i];
+                }
+                if ( posflag != NULL ) for ( i = 0; i < nxy; i++ ) \
+                    posflag[i] = 0;
+                if ( poserr != NULL ) for ( i = 0; i < nxy; i++ ) \
+                    poserr[i] = 0.;
+                jam_axi_ws_put( ws, quad );
+                return;
+            }
+            jam_axi_ws_put( ws, quad );
+        }
+        
+        // weighted first moments at the unique folded positions
+        xf = jam_axi_ws_buf( ws, JAM_WS_XF, nxy * sizeof( double ) );
+        yf = jam_axi_ws_buf( ws, JAM_WS_YF, nxy * sizeof( double ) );
+        rep = jam_axi_ws_buf( ws, JAM_WS_REP, nxy * sizeof( int ) );
+        map = jam_axi_ws_buf( ws, JAM_WS_MAP, nxy * sizeof( int ) );
+        nf = jam_axi_fold( xp, yp, nxy, merge, xf, yf, rep, map, ws );
+        wm = jam_axi_ws_buf( ws, JAM_WS_MU, 3 * nf * sizeof( double ) );
+        wm1.vx = wm;
+        wm1.vy = &wm[nf];
+        wm1.vz = &wm[2*nf];
+        pf = ( posflag == NULL ) ? NULL : \
+            jam_axi_ws_buf( ws, JAM_WS_PFLAG, nf * sizeof( int ) );
+        pe = ( poserr == NULL ) ? NULL : \
+            jam_axi_ws_buf( ws, JAM_WS_PERR, nf * sizeof( double ) );
+        jam_axi_vel_wmmt( xf, yf, nf, incl, lt, pt, integrationFlag, qtol, \
+            nthread, &wm1, pf, pe, stop, ws );
+            
+        // first moments (vx is odd in y', vy and vz are odd in x')
+        for ( i = 0; i < nxy; i++ ) {
+            sr = ( merge > 0. ) ? surf[rep[map[i]]] : surf[i];
+            sx = ( xp[i] < 0. ) ? -1. : 1.;
+            sy = ( yp[i] < 0. ) ? -1. : 1.;
+            vx[i] = sy * wm1.vx[map[i]] / sr;
+            vy[i] = sx * wm1.vy[map[i]] / sr;
+            vz[i] = sx * wm1.vz[map[i]] / sr;
+            if ( pf != NULL ) posflag[i] = pf[map[i]];
+            if ( pe != NULL ) poserr[i] = pe[map[i]];
+        }
+        
+        if ( cache != NULL && *integrationFlag == 0 \
+                && jam_axi_stop_poll( stop, 0 ) == JAM_OK ) {
+            quad = jam_axi_ws_buf( ws, JAM_WS_CMU, \
+                3 * nxy * sizeof( double ) );
+            for ( i = 0; i < nxy; i++ ) {
+                quad[i] = vx[i];
+                quad[nxy+i] = vy[i];
+                quad[2*nxy+i] = vz[i];
+            }
+            cache_put( cache, &key, quad, 3 * nxy );
+            jam_axi_ws_put( ws, quad );
+        }
+        
+        jam_axi_ws_put( ws, wm );
+        jam_axi_ws_put( ws, pf );
+        jam_axi_ws_put( ws, pe );
+        jam_axi_ws_put( ws, xf );
+        jam_axi_ws_put( ws, yf );
+        jam_axi_ws_put( ws, rep );
+        jam_axi_ws_put( ws, map );
+        return;
+        
+    }
+    
+    
+    // ---------------------------------
+    
+    
+    // first moments on the grid nodes
+    f0 = *integrationFlag;
+    quad = jam_axi_vel_quad( grid, lt, pt, incl, surfpol, integrationFlag, \
+        &agrid, &gp, opts );
+    n = gp->npol;
+    
+    // positions share the status of the grid they are interpolated from
+    if ( posflag != NULL ) for ( i = 0; i < nxy; i++ ) \
+        posflag[i] = *integrationFlag - f0;
+    if ( poserr != NULL ) for ( i = 0; i < nxy; i++ ) poserr[i] = 0.;
+    
+    // interpolate to get first moments at input positions
+    jam_axi_interp( gp, quad, 1, -1, vx, opts );
+    jam_axi_interp( gp, &quad[n], -1, -1, vy, opts );
+    jam_axi_interp( gp, &quad[2*n], -1, -1, vz, opts );
+    
+    if ( gp != grid ) jam_axi_grid_free( &agrid );
+    free( quad );
+    
+    // check the interpolation against direct calculation at sentinels
+    // (in the same workspace, whose folding buffers are free by now)
+    if ( opts != NULL && opts->nsentinel > 0 ) {
+        idx = jam_axi_ws_buf( ws, JAM_WS_SIDX, \
+            opts->nsentinel * sizeof( int ) );
+        ns = jam_axi_sentinel_pick( grid->r, nxy, opts->nsentinel, idx );
+        xs = jam_axi_ws_buf( ws, JAM_WS_SX, ns * sizeof( double ) );
+        ys = jam_axi_ws_buf( ws, JAM_WS_SY, ns * sizeof( double ) );
+        exact = jam_axi_ws_buf( ws, JAM_WS_SMU, 3 * ns * sizeof( double ) );
+        for ( i = 0; i < ns; i++ ) {
+            xs[i] = xp[idx[i]];
+            ys[i] = yp[idx[i]];
+        }
+        
+        // surface density at the sentinels, from the projected tracer
+        plum = mge_project( &lt->ilum, incl );
+        ss = mge_surf( &plum, xs, ys, ns );
+        
+        so.ws = ws;
+        jam_axi_vel_eval( xs, ys, ns, incl, lt, pt, NULL, ss, NULL, \
+            integrationFlag, exact, &exact[ns], &exact[2*ns], &so );
+        jam_axi_sentinel_err( exact, vx, idx, ns, &opts->sentmax[0], \
+            &opts->sentrms[0] );
+        jam_axi_sentinel_err( &exact[ns], vy, idx, ns, &opts->sentmax[1], \
+            &opts->sentrms[1] );
+        jam_axi_sentinel_err( &exact[2*ns], vz, idx, ns, \
+            &opts->sentmax[2], &opts->sentrms[2] );
+        jam_axi_ws_put( ws, idx );
+        jam_axi_ws_put( ws, xs );
+        jam_axi_ws_put( ws, ys );
+        jam_axi_ws_put( ws, exact );
+        free( ss );
+        free( plum.area );
+        free( plum.sigma );
+        free( plum.q );
+    }
+    
+}
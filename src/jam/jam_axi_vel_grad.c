@@ -0,0 +1,192 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_GRAD
+    
+    Calculates first moments and their derivatives with respect to the model
+    parameters.  The derivatives with respect to the anisotropy and rotation
+    of each luminous component and the mass scaling of each potential
+    component are propagated through the integrands, the integrals and the
+    interpolation (see jam_axi_vel_wgrad); the derivative with respect to
+    inclination is found by a centred difference (one-sided if the model
+    cannot be deprojected at one of the two inclinations).  The parameters
+    are ordered as in jam_axi_rms_grad.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lum   : projected luminous MGE
+      pot   : projected potential MGE
+      beta  : velocity anisotropy (1 - vz^2 / vr^2)
+      kappa : rotation parameter
+      nrad  : number of radial bins in interpolation grid
+      nang  : number of angular bins in interpolation grid
+      vx, vy, vz    : arrays to hold the first moments
+      dvx, dvy, dvz : arrays to hold the derivatives, ordered as [p*nxy+i]
+                      for parameter p and position i
+                      
+    OUTPUTS
+      JAM_OK, the status from jam_axi_terms_check for a model that cannot be
+      deprojected (checked before any work is done), or JAM_ERR_INTEGRAL if
+      the integration flag is set.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+enum jam_status jam_axi_vel_grad( double *xp, double *yp, int nxy, \
+        double incl, struct multigaussexp *lum, struct multigaussexp *pot, \
+        double *beta, double *kappa, int nrad, int nang, int* integrationFlag, \
+        double *vx, double *vy, double *vz, double *dvx, double *dvy, \
+        double *dvz ) {
+    
+    int i, k, p, v, npar, npnt;
+    double *wm, *dsb, *surf, *map, *src, *out, *mu[3], *dmu[3];
+    double dincl = 1e-3;    // inclination step for the centred difference
+    struct jam_lumterms lt;
+    struct jam_potterms pt;
+    struct jam_grid grid;
+    struct jam_vel wm1, mlo, mhi;
+    enum jam_status status;
+    
+    // check that integration flag is zero or don't proceed
+    if (*integrationFlag!=0) return JAM_ERR_INTEGRAL;
+    
+    // check that the model can be deprojected before doing any work
+    status = jam_axi_terms_check( lum, pot, incl, beta );
+    if ( status != JAM_OK ) return status;
+    
+    // number of parameters without inclination
+    npar = 2 * lum->ntotal + pot->ntotal;
+    
+    mu[0] = vx;
+    mu[1] = vy;
+    mu[2] = vz;
+    dmu[0] = dvx;
+    dmu[1] = dvy;
+    dmu[2] = dvz;
+    
+    // check for at least 1 rotating, non-spherical, non-isotropic component
+    if ( jam_axi_vel_check( lum, pot, beta, kappa ) == 0 ) {
+        for ( v = 0; v < 3; v++ ) {
+            for ( i = 0; i < nxy; i++ ) mu[v][i] = 0.;
+            for ( i = 0; i < ( 1 + npar ) * nxy; i++ ) dmu[v][i] = 0.;
+        }
+        return JAM_OK;
+    }
+    
+    lt = jam_axi_lumterms( lum, incl, beta, kappa );
+    pt = jam_axi_potterms( pot, incl );
+    
+    // skip the interpolation when computing just a few points
+    if ( nrad * nang > nxy ) {
+        
+        npnt = nxy;
+        surf = mge_surf( lum, xp, yp, nxy );
+        
+        // weighted first moments and their derivatives
+        wm = (double *) malloc( 3 * nxy * sizeof( double ) );
+        wm1 = (struct jam_vel) { wm, &wm[nxy], &wm[2*nxy] };
+        dsb = (double *) malloc( 3 * npar * nxy * sizeof( double ) );
+        jam_axi_vel_wgrad( xp, yp, nxy, incl, &lt, &pt, integrationFlag, \
+            &wm1, dsb );
+        
+    } else {
+        
+        // interpolation grid and surface brightness on it
+        grid = jam_axi_grid( xp, yp, nxy, lum, nrad, nang, -0.1, 0.1, \
+            NULL );
+        npnt = grid.npol;
+        surf = mge_surf( lum, grid.xpol, grid.ypol, grid.npol );
+        
+        // weighted first moments and their derivatives on polar grid
+        wm = (double *) malloc( 3 * npnt * sizeof( double ) );
+        wm1 = (struct jam_vel) { wm, &wm[npnt], &wm[2*npnt] };
+        dsb = (double *) malloc( 3 * npar * grid.npol * sizeof( double ) );
+        jam_axi_vel_wgrad( grid.xpol, grid.ypol, grid.npol, incl, &lt, &pt, \
+            integrationFlag, &wm1, dsb );
+        
+    }
+    
+    map = (double *) malloc( npnt * sizeof( double ) );
+    for ( v = 0; v < 3; v++ ) {
+        for ( p = -1; p < npar; p++ ) {
+            
+            if ( p < 0 ) out = mu[v];
+            else out = &dmu[v][(1+p)*nxy];
+            
+            // first moment (or derivative) at the positions, straight into
+            // the output, or on the grid
+            src = ( p < 0 ) ? &wm[v*npnt] : &dsb[(v*npar+p)*npnt];
+            if ( nrad * nang > nxy ) {
+                for ( i = 0; i < nxy; i++ ) out[i] = src[i] / surf[i];
+                continue;
+            }
+            for ( k = 0; k < npnt; k++ ) map[k] = src[k] / surf[k];
+            
+            // interpolate to get values at input positions
+            if ( v == 0 ) jam_axi_interp( &grid, map, 1, -1, out, NULL );
+            else jam_axi_interp( &grid, map, -1, -1, out, NULL );
+            
+        }
+    }
+    free( map );
+    
+    free( wm );
+    free( dsb );
+    free( surf );
+    if ( nrad * nang <= nxy ) jam_axi_grid_free( &grid );
+    jam_axi_lumterms_free( &lt );
+    jam_axi_potterms_free( &pt );
+    
+    
+    // ---------------------------------
+    
+    
+    // inclination derivative by centred difference, or one-sided where
+    // the model cannot be deprojected at one of the steps
+    mlo = jam_axi_vel_mmt( xp, yp, nxy, incl - dincl, lum, pot, beta, kappa, \
+        nrad, nang, integrationFlag, NULL );
+    mhi = jam_axi_vel_mmt( xp, yp, nxy, incl + dincl, lum, pot, beta, kappa, \
+        nrad, nang, integrationFlag, NULL );
+    for ( i = 0; i < nxy; i++ ) {
+        if ( mlo.vx != NULL && mhi.vx != NULL ) {
+            dvx[i] = ( mhi.vx[i] - mlo.vx[i] ) / ( 2. * dincl );
+            dvy[i] = ( mhi.vy[i] - mlo.vy[i] ) / ( 2. * dincl );
+            dvz[i] = ( mhi.vz[i] - mlo.vz[i] ) / ( 2. * dincl );
+        }
+        else if ( mhi.vx != NULL ) {
+            dvx[i] = ( mhi.vx[i] - vx[i] ) / dincl;
+            dvy[i] = ( mhi.vy[i] - vy[i] ) / dincl;
+            dvz[i] = ( mhi.vz[i] - vz[i] ) / dincl;
+        }
+        else if ( mlo.vx != NULL ) {
+            dvx[i] = ( vx[i] - mlo.vx[i] ) / dincl;
+            dvy[i] = ( vy[i] - mlo.vy[i] ) / dincl;
+            dvz[i] = ( vz[i] - mlo.vz[i] ) / dincl;
+        }
+        else dvx[i] = dvy[i] = dvz[i] = 0.;
+    }
+    
+    free( mlo.vx );
+    free( mlo.vy );
+    free( mlo.vz );
+    free( mhi.vx );
+    free( mhi.vy );
+    free( mhi.vz );
+    
+    return ( *integrationFlag != 0 ) ? JAM_ERR_INTEGRAL : JAM_OK;
+    
+}
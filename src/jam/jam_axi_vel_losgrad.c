@@ -0,0 +1,155 @@
+/* -----------------------------------------------------------------------------
+  JAM_AXI_VEL_LOSGRAD
+    
+    Derivatives of the integrand for the line-of-sight integral required for
+    first moment calculation (see jam_axi_vel_losint) with respect to the
+    anisotropy and rotation of each luminous component and the mass scaling
+    of each potential component.  The integrand is sqrt(nu * S), where S is a
+    sum over luminous components of kappa^2 times the MGE integral; the MGE
+    integral is linear in the anisotropy term and in the mass of each
+    potential component, so the derivatives of S are found from the MGE
+    integral of each potential component separately and from the MGE
+    integral of the anisotropy derivative (jam_axi_vel_mgegrad).
+    
+    INPUTS
+      zp     : line-of-sight coordinate z' (integration variable)
+      params : function parameters passed as a structure (as for
+               jam_axi_vel_losint, with intj set to a scratch array with
+               one element per potential component)
+      df     : array to hold the derivatives, ordered as beta for each
+               luminous component, kappa for each luminous component and the
+               mass scaling for each potential component, first for the z'^0
+               integrand and then for the z'^1 integrand
+               
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+----------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_integration.h>
+#include <gsl/gsl_errno.h>
+#include "jam.h"
+#include "../mge/mge.h"
+
+
+void jam_axi_vel_losgrad(double zp, void *params, double *df) {
+    
+    struct params_losint *lp;
+    struct params_mgeint mp;
+    struct multigaussexp single;
+    double xp, yp, si, ci, r, z, r2, z2, nu, intg, result, error, nu_i;
+    double sign_kappa, sign_int, sum, k2, dint, *intj;
+    int i, j, k, nlum, npot, npar;
+    
+    // get parameters
+    lp = params;
+    xp = lp->xp;
+    yp = lp->yp;
+    nlum = lp->lum->ntotal;
+    npot = lp->pot->ntotal;
+    npar = 2 * nlum + npot;
+    
+    for (k=0; k<2*npar; k++) df[k] = 0.;
+    
+    // if the integrationFlag is already set, do not proceed
+    if (*lp->integrationFlag!=0) {
+        return;
+    }
+    
+    // intrinsic R and z
+    si = sin(lp->incl);
+    ci = cos(lp->incl);
+    r = sqrt(pow(zp*si - yp*ci, 2) + pow(xp, 2));                   // eqn 25
+    z = sqrt(pow(zp*ci + yp*si, 2));
+    
+    // do some prep for the integrand to avoid repeat calculations
+    r2 = r * r;
+    z2 = z * z;
+    
+    // parameters for integrand function
+    mp.r2 = r2;
+    mp.z2 = z2;
+    mp.stop = NULL;
+    
+    // single potential component, for the integral of each component
+    single.ntotal = 1;
+    
+    // perform integration (in the caller's workspace and scratch array)
+    jam_axi_gsl_init();
+    gsl_function F;
+    
+    intj = lp->intj;
+    
+    // S and its derivatives
+    sum = 0.;
+    for (i=0; i<nlum; i++) {
+        if (lp->kappa[i]==0.) sign_kappa = 0.;
+        else sign_kappa = lp->kappa[i]/fabs(lp->kappa[i]);
+        nu_i = lp->lum->area[i] * exp(-0.5/lp->s2l[i]*(r2+z2/lp->q2l[i]));
+        k2 = sign_kappa * pow(lp->kappa[i], 2);
+        
+        mp.bani = lp->bani[i];
+        mp.s2l = lp->s2l[i];
+        mp.q2l = lp->q2l[i];
+        mp.s2q2l = lp->s2q2l[i];
+        
+        // MGE integral for each potential component separately
+        F.function = &jam_axi_vel_mgeint;
+        F.params = &mp;
+        mp.pot = &single;
+        result = 0.;
+        for (j=0; j<npot; j++) {
+            single.area = &lp->pot->area[j];
+            single.sigma = &lp->pot->sigma[j];
+            single.q = &lp->pot->q[j];
+            mp.s2p = &lp->s2p[j];
+            mp.e2p = &lp->e2p[j];
+            *lp->integrationFlag += gsl_integration_qag(&F, 0., 1., 0., 1e-5,
+                1000, 6, lp->w, &intj[j], &error);
+            result += intj[j];
+        }
+        sign_int = result<0. ? -1. : 1.;
+        
+        // MGE integral of the anisotropy derivative
+        mp.pot = lp->pot;
+        mp.s2p = lp->s2p;
+        mp.e2p = lp->e2p;
+        F.function = &jam_axi_vel_mgegrad;
+        *lp->integrationFlag += gsl_integration_qag(&F, 0., 1., 0., 1e-5,
+            1000, 6, lp->w, &dint, &error);
+            
+        sum += k2 * nu_i * fabs(result);
+        
+        // d(bani)/d(beta) = bani^2, d(kappa |kappa|)/d(kappa) = 2 |kappa|
+        df[i] = k2 * nu_i * sign_int * dint * pow(lp->bani[i], 2);
+        df[nlum+i] = 2. * fabs(lp->kappa[i]) * nu_i * fabs(result);
+        for (j=0; j<npot; j++) df[2*nlum+j] += k2 * nu_i * sign_int * intj[j];
+    }
+    
+    // check if the integration failed, or if the integrand (and so its
+    // derivative) vanishes here
+    if (*lp->integrationFlag!=0 || sum==0.) {
+        for (k=0; k<npar; k++) df[k] = 0.;
+        return;
+    }
+    
+    // mge volume density
+    nu = mge_dens(lp->lum, r, z);
+    
+    // d(integrand)/dS, keeping track of kappa signs as in jam_axi_vel_losint
+    intg = nu*sum/fabs(nu*sum)*sqrt(fabs(nu*sum));
+    intg *= 0.5 / sum;
+    
+    for (k=0; k<npar; k++) {
+        df[k] *= intg;
+        df[npar+k] = df[k] * zp;
+    }
+    
+}
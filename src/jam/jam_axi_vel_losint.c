@@ -6,7 +6,11 @@
     
     INPUTS
       zp     : line-of-sight coordinate z' (integration variable)
-      params : function parameters passed as a structure
+      params : function parameters passed as a structure (with w set to
+               an integration workspace for the inner integrals that is not
+               in use by the outer integral; if retry is set, the inner
+               integrals use extrapolation and up to JAM_RETRY_LIMIT
+               subintervals, and w must be that large)
       
     NOTES
       * Based on janis1_jeans_mge_los_integrand IDL code by Michele Cappellari.
@@ -47,6 +51,9 @@ double jam_axi_vel_losint(double zp, void *params) {
         return 0.;
     }
     
+    // or if the calculation has been stopped
+    if (jam_axi_stop_tick(lp->stop, &lp->neval)) return 0.;
+    
     // intrinsic R and z
     si = sin(lp->incl);
     ci = cos(lp->incl);
@@ -63,10 +70,11 @@ double jam_axi_vel_losint(double zp, void *params) {
     mp.pot = lp->pot;
     mp.s2p = lp->s2p;
     mp.e2p = lp->e2p;
+    mp.stop = lp->stop;
+    mp.neval = &lp->neval;
     
     // perform integration
-    gsl_integration_workspace *w = gsl_integration_workspace_alloc(1000);
-    gsl_set_error_handler_off();
+    jam_axi_gsl_init();
     gsl_function F;
     F.function = &jam_axi_vel_mgeint;
     
@@ -81,13 +89,14 @@ double jam_axi_vel_losint(double zp, void *params) {
         mp.q2l = lp->q2l[i];
         mp.s2q2l = lp->s2q2l[i];
         F.params = &mp;
-        *lp->integrationFlag += gsl_integration_qag(&F, 0., 1., 0., 1e-5,
-            1000, 6, w, &result, &error);
+        if (lp->retry) *lp->integrationFlag += gsl_integration_qags(&F,
+            0., 1., 0., 1e-5 * lp->quad, JAM_RETRY_LIMIT, lp->w, &result,
+            &error);
+        else *lp->integrationFlag += gsl_integration_qag(&F, 0., 1., 0.,
+            1e-5 * lp->quad, 1000, 6, lp->w, &result, &error);
         sum += sign_kappa * pow(lp->kappa[i], 2) * nu_i * fabs(result);
     }
     
-    gsl_integration_workspace_free(w);
-    
     // check if the integration failed
     if (*lp->integrationFlag!=0) {
         return 0.;
@@ -0,0 +1,54 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_MGEGRAD
+    
+    Derivative of the integrand for the MGE integral required for first
+    moment calculation (see jam_axi_vel_mgeint) with respect to the
+    anisotropy term 1/(1-beta) of the luminous component.
+    
+    INPUTS
+      u      : integration variable
+      params : function parameters passed as a structure
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../mge/mge.h"
+#include "jam.h"
+
+
+double jam_axi_vel_mgegrad(double u, void *params) {
+    
+    struct params_mgeint *p;
+    double c, dd, p2, hj, e, sum;
+    int j;
+    
+    double u2 = u*u;
+    
+    p = params;
+    
+    // derivative of eqn 38 with respect to bani (only d depends on it)
+    sum = 0.;
+    for (j=0; j<p->pot->ntotal; j++) { // mass gaussians
+        
+        p2 = 1. - p->e2p[j] * u2;
+        hj = exp( -0.5/p->s2p[j]*u2*(p->r2+p->z2/p2) )/sqrt(p2);         // 17
+        e = p->pot->q[j] * p->pot->area[j] * hj * u2;
+        
+        c = p->e2p[j] - p->s2q2l / p->s2p[j];                            // 22
+        dd = - p->q2l - (p->e2p[j]-c)*u2;                  // d(eqn 23)/d(bani)
+        sum += e*dd/(1.-c*u2);                                           // 38
+        
+    }
+    
+    return sum;
+    
+}
@@ -36,6 +36,9 @@ double jam_axi_vel_mgeint(double u, void *params) {
     
     p = params;
     
+    // once the calculation has been stopped, finish at once
+    if (jam_axi_stop_tick(p->stop, p->neval)) return 0.;
+    
     // double summation of eqn 38 over integration variable u
     sum = 0.;
     for (j=0; j<p->pot->ntotal; j++) { // mass gaussians
@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_VEL_WGRAD
+    
+    Calculates weighted first moments and their derivatives with respect to
+    the anisotropy and rotation of each luminous component and the mass
+    scaling of each potential component.  The z'^0 line-of-sight integral is
+    found adaptively and the z'^1 integral as in jam_axi_vel_wmmt, and the
+    derivatives of both are integrated together over the subintervals of the
+    z'^0 integral with a Gauss-Legendre table made once for all the
+    positions.
+    
+    INPUTS
+      xp    : projected x' [pc]
+      yp    : projected y' [pc]
+      nxy   : number of x' and y' values given
+      incl  : inclination [radians]
+      lt    : tracer terms from jam_axi_lumterms (with kappa set)
+      pt    : potential terms from jam_axi_potterms
+      mu    : arrays [nxy] to hold the weighted first moments
+      dsb   : array to hold the derivatives, ordered as [(v*npar+p)*nxy+i]
+              for velocity component v, parameter p (see jam_axi_vel_losgrad)
+              and position i
+              
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_integration.h>
+#include <gsl/gsl_errno.h>
+#include "jam.h"
+#include "../mge/mge.h"
+#include "../tools/tools.h"
+
+
+void jam_axi_vel_wgrad( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, \
+        int* integrationFlag, struct jam_vel *mu, double *dsb ) {
+        
+    struct params_losint lp;
+    gsl_integration_glfixed_table *t;
+    gsl_integration_cquad_workspace *cw;
+    double lim, error, si, ci, trpig, iz0, iz1, *res, *val;
+    size_t neval;
+    int i, k, npar;
+    
+    // ---------------------------------
+    
+    // parameters for integrand function
+    lp.incl = incl;
+    lp.lum = &lt->ilum;
+    lp.pot = &pt->ipot;
+    lp.bani = lt->kani;
+    lp.s2l = lt->s2l;
+    lp.q2l = lt->q2l;
+    lp.s2q2l = lt->s2q2l;
+    lp.s2p = pt->s2p;
+    lp.e2p = pt->e2p;
+    lp.kappa = lt->kappa;
+    lp.integrationFlag = integrationFlag;
+    lp.zpow = 0.;
+    lp.quad = 1.;
+    lp.stop = NULL;
+    lp.retry = 0;
+    
+    npar = 2 * lt->ilum.ntotal + pt->ipot.ntotal;
+    res = (double *) malloc( 2 * npar * sizeof( double ) );
+    val = (double *) malloc( 2 * npar * sizeof( double ) );
+    t = gsl_integration_glfixed_table_alloc( 10 );
+    lp.intj = (double *) malloc( pt->ipot.ntotal * sizeof( double ) );
+    
+    // ---------------------------------
+    
+    // set up integration, with the inner integrals in a workspace of their
+    // own
+    gsl_integration_workspace *w = gsl_integration_workspace_alloc( 1000 );
+    lp.w = gsl_integration_workspace_alloc( 1000 );
+    cw = gsl_integration_cquad_workspace_alloc( 1000 );
+    jam_axi_gsl_init();
+    gsl_function F;
+    F.function = &jam_axi_vel_losint;
+    F.params = &lp;
+    
+    // trig angles
+    si = sin( incl );
+    ci = cos( incl );
+    
+    // outer limit of integration
+    lim = 4. * maximum( lt->ilum.sigma, lt->ilum.ntotal );
+    
+    trpig = 2. * sqrt( M_PI * G );
+    for ( i = 0; i < nxy; i++ ) {
+        
+        // parameters for integrand function
+        lp.xp = xp[i];
+        lp.yp = yp[i];
+        
+        // z^0 integral, and its subintervals
+        lp.zpow = 0.;
+        *integrationFlag += gsl_integration_qag(&F, -lim, lim, 0., 1e-4, 1000,
+            2, w, &iz0, &error);
+            
+        // derivatives of the z^0 and z^1 integrals over the same subintervals
+        jam_axi_quadvec( w->alist, w->blist, w->size, t, \
+            &jam_axi_vel_losgrad, &lp, 2 * npar, val, res );
+            
+        // z^1 integral, as in jam_axi_vel_wmmt
+        lp.zpow = 1.;
+        *integrationFlag += gsl_integration_qag(&F, -lim, lim, 1., 1., 1000,
+            2, w, &iz1, &error);
+        if ( fabs( iz1 ) > 1e-6 ) *integrationFlag += \
+            gsl_integration_cquad(&F, -lim, lim, 0., 1e-3, cw, &iz1, &error,
+            &neval);
+            
+        // each velocity component and its derivatives
+        mu->vx[i] = trpig * ( yp[i] * ci * iz0 - si * iz1 );
+        mu->vy[i] = -trpig * xp[i] * ci * iz0;
+        mu->vz[i] = trpig * xp[i] * si * iz0;
+        for ( k = 0; k < npar; k++ ) {
+            dsb[k*nxy+i] = trpig * ( yp[i] * ci * res[k] - si * res[npar+k] );
+            dsb[(npar+k)*nxy+i] = -trpig * xp[i] * ci * res[k];
+            dsb[(2*npar+k)*nxy+i] = trpig * xp[i] * si * res[k];
+        }
+        
+    }
+    
+    // tidy up
+    gsl_integration_workspace_free( w );
+    gsl_integration_workspace_free( lp.w );
+    gsl_integration_cquad_workspace_free( cw );
+    gsl_integration_glfixed_table_free( t );
+    free( lp.intj );
+    free( val );
+    free( res );
+    
+}
@@ -1,21 +1,54 @@
 /* ----------------------------------------------------------------------------
   JAM_AXI_VEL_WMMT
     
-    Calculates weighted first moments.
+    Calculates weighted first moments.  The cost of a position varies by an
+    order of magnitude, from the centre (many evaluations of the nested
+    integrals) to the outskirts, so when there is more than one thread the
+    positions are scheduled by predicted cost: they are ordered by elliptical
+    radius, with predicted cost 1 + ln( mmax / m ) for elliptical radius m
+    and largest elliptical radius mmax, and dealt, most expensive first, to
+    the thread queue with the lowest predicted load.  Each thread works
+    through its own queue from the most expensive position, and when it is
+    empty steals the cheapest position from the fullest queue, so the long
+    tasks start first and no thread is left idle while work remains.  Every
+    position is integrated in the same way whichever thread takes it.  The
+    integration workspaces (including the one for the inner integral, which
+    each thread passes down to jam_axi_vel_losint), queues and intermediate
+    integrals come from ws, if given, so that repeated calls do not allocate
+    them, and the moments are written straight into the arrays of mu.  If
+    the calculation is stopped (see jam_axi_stop), the threads take no more
+    positions and mu is left incomplete.
+    
+    A position whose integrals fail (or whose inner integrals fail, which
+    stops the rest of its inner integrals) is integrated again at once,
+    with the inner integrals using extrapolation (qags) and up to
+    JAM_RETRY_LIMIT subintervals, and only a position that still fails is
+    counted in the integration flag; the other positions are not affected.
+    The status and the relative error estimate at each position can be
+    returned in pflag and perr (zero at positions not reached if stopped).
     
     INPUTS
       xp    : projected x' [pc]
       yp    : projected y' [pc]
       nxy   : number of x' and y' values given
       incl  : inclination [radians]
-      lum   : projected luminous MGE
-      pot   : projected potential MGE
-      beta  : velocity anisotropy (1 - vz^2 / vr^2)
-      kappa : rotation parameter
-    
+      lt    : tracer terms from jam_axi_lumterms (with kappa set)
+      pt    : potential terms from jam_axi_potterms
+      quad  : factor on the relative tolerance of the integrals (0 or 1 for
+              the default, larger for faster but less precise integrals)
+      nthread : number of threads (0 or 1 for one, negative to use all
+              available processors)
+      mu    : arrays [nxy] to hold the weighted vx, vy and vz first moments
+      pflag : array [nxy] to hold the sum of the GSL status codes of the
+              integrals at each position, 0 if they converged (or NULL)
+      perr  : array [nxy] to hold the largest relative error estimate of
+              the z^0 and z^1 integrals at each position (or NULL)
+      stop  : budget of the calculation (or NULL for none)
+      ws    : workspace (or NULL, see jam_axi_ws)
+      
     NOTES
       * Based on janis1_weighted_first_moment IDL code by Michele Cappellari.
-    
+      
   Laura L Watkins [lauralwatkins@gmail.com]
   
   This code is released under a BSD 2-clause license.
@@ -28,6 +61,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_errno.h>
 #include "jam.h"
@@ -35,135 +70,344 @@
 #include "../tools/tools.h"
 
 
-double** jam_axi_vel_wmmt( double *xp, double *yp, int nxy, double incl, \
-        struct multigaussexp *lum, struct multigaussexp *pot, \
-        double *beta, double *kappa, int* integrationFlag) {
-    
+// queue of positions for one thread, most expensive first
+struct vel_queue {
+    int *idx, head, tail;
+    pthread_mutex_t lock;
+};
+
+
+// work shared between threads
+struct vel_wmmt {
     struct params_losint lp;
-    struct multigaussexp ilum, ipot;
-    double *bani, *s2l, *q2l, *s2q2l, *s2p, *e2p;
-    double *iz0, *iz1;
-    double lim, result, error, si, ci, trpig, **sb_mu1;
+    struct jam_workspace *ws;
+    struct vel_queue *queue;
+    double *xp, *yp, *iz0, *iz1, *perr, lim;
+    int nxy, nthread, next, flag, *pflag;
+    pthread_mutex_t lock;
+};
+
+
+struct vel_cost {
+    double m;
     int i;
-    size_t neval;
+};
+
+
+static int jam_axi_vel_wmmt_cmp( const void *a, const void *b ) {
     
-    // ---------------------------------
+    const struct vel_cost *ca = a, *cb = b;
+    
+    if ( ca->m != cb->m ) return ( ca->m > cb->m ) - ( ca->m < cb->m );
+    return ca->i - cb->i;
     
-    // MGE parameters for inner integrand function
-    
-    // convert from projected MGEs to intrinsic MGEs
-    ilum = mge_deproject( lum, incl );
-    ipot = mge_deproject( pot, incl );
-    
-    // calculate useful quantities
-    bani = (double *) malloc( ilum.ntotal * sizeof( double ) );
-    s2l = (double *) malloc( ilum.ntotal * sizeof( double ) );
-    q2l = (double *) malloc( ilum.ntotal * sizeof( double ) );
-    s2q2l = (double *) malloc( ilum.ntotal * sizeof( double ) );
-    s2p = (double *) malloc( ipot.ntotal * sizeof( double ) );
-    e2p = (double *) malloc( ipot.ntotal * sizeof( double ) );
-    
-    for ( i = 0; i < ilum.ntotal; i++ ) {
-        bani[i] = 1. / ( 1. - beta[i] );
-        s2l[i] = pow( ilum.sigma[i], 2 );
-        q2l[i] = pow( ilum.q[i], 2 );
-        s2q2l[i] = s2l[i] * q2l[i];
+}
+
+
+// deal the positions to the thread queues by predicted cost
+static void jam_axi_vel_wmmt_deal( struct vel_wmmt *wm, double q, int *idx ) {
+    
+    struct vel_cost *c;
+    double mmax, *load, cost;
+    int i, t, best, *owner, *count;
+    
+    // elliptical radii, in order of decreasing predicted cost
+    c = jam_axi_ws_buf( wm->ws, JAM_WS_COST, \
+        wm->nxy * sizeof( struct vel_cost ) );
+    mmax = 0.;
+    for ( i = 0; i < wm->nxy; i++ ) {
+        c[i].m = sqrt( wm->xp[i] * wm->xp[i] + wm->yp[i] * wm->yp[i] / q / q );
+        c[i].i = i;
+        if ( c[i].m > mmax ) mmax = c[i].m;
     }
+    qsort( c, wm->nxy, sizeof( struct vel_cost ), jam_axi_vel_wmmt_cmp );
     
-    for ( i = 0; i < ipot.ntotal; i++ ) {
-        s2p[i] = pow( ipot.sigma[i], 2 );
-        e2p[i] = 1. - pow( ipot.q[i], 2 );
+    // each position to the queue with the lowest predicted load
+    load = jam_axi_ws_buf( wm->ws, JAM_WS_LOAD, \
+        wm->nthread * sizeof( double ) );
+    count = jam_axi_ws_buf( wm->ws, JAM_WS_COUNT, \
+        wm->nthread * sizeof( int ) );
+    owner = jam_axi_ws_buf( wm->ws, JAM_WS_OWNER, wm->nxy * sizeof( int ) );
+    for ( t = 0; t < wm->nthread; t++ ) {
+        load[t] = 0.;
+        count[t] = 0;
+    }
+    for ( i = 0; i < wm->nxy; i++ ) {
+        cost = ( mmax > 0. ) ? \
+            1. + log( mmax / fmax( c[i].m, 1.e-6 * mmax ) ) : 1.;
+        best = 0;
+        for ( t = 1; t < wm->nthread; t++ ) \
+            if ( load[t] < load[best] ) best = t;
+        load[best] += cost;
+        count[best]++;
+        owner[i] = best;
     }
     
-    // parameters for integrand function
-    lp.incl = incl;
-    lp.lum = &ilum;
-    lp.pot = &ipot;
-    lp.bani = bani;
-    lp.s2l = s2l;
-    lp.q2l = q2l;
-    lp.s2q2l = s2q2l;
-    lp.s2p = s2p;
-    lp.e2p = e2p;
-    lp.kappa = kappa;
-    lp.integrationFlag = integrationFlag;
+    // queues laid end to end in idx
+    for ( t = 0; t < wm->nthread; t++ ) {
+        wm->queue[t].idx = ( t == 0 ) ? idx \
+            : wm->queue[t-1].idx + count[t-1];
+        wm->queue[t].head = wm->queue[t].tail = 0;
+    }
+    for ( i = 0; i < wm->nxy; i++ ) {
+        t = owner[i];
+        wm->queue[t].idx[wm->queue[t].tail++] = c[i].i;
+    }
     
-    // ---------------------------------
+    jam_axi_ws_put( wm->ws, c );
+    jam_axi_ws_put( wm->ws, load );
+    jam_axi_ws_put( wm->ws, count );
+    jam_axi_ws_put( wm->ws, owner );
+    
+}
+
+
+// next position for thread t: its own most expensive, or a stolen one
+static int jam_axi_vel_wmmt_take( struct vel_wmmt *wm, int t ) {
+    
+    struct vel_queue *q = &wm->queue[t];
+    int i = -1, v, victim, n;
+    
+    pthread_mutex_lock( &q->lock );
+    if ( q->head < q->tail ) i = q->idx[q->head++];
+    pthread_mutex_unlock( &q->lock );
+    
+    while ( i < 0 ) {
+        
+        // the fullest queue
+        victim = -1;
+        n = 0;
+        for ( v = 0; v < wm->nthread; v++ ) {
+            pthread_mutex_lock( &wm->queue[v].lock );
+            if ( wm->queue[v].tail - wm->queue[v].head > n ) {
+                n = wm->queue[v].tail - wm->queue[v].head;
+                victim = v;
+            }
+            pthread_mutex_unlock( &wm->queue[v].lock );
+        }
+        if ( victim < 0 ) break;
+        
+        // steal its cheapest position (unless it has gone in the meantime)
+        q = &wm->queue[victim];
+        pthread_mutex_lock( &q->lock );
+        if ( q->head < q->tail ) i = q->idx[--q->tail];
+        pthread_mutex_unlock( &q->lock );
+        
+    }
     
-    // set up integration
-    gsl_integration_workspace *w = gsl_integration_workspace_alloc( 1000 );
-    gsl_integration_cquad_workspace *ww = gsl_integration_cquad_workspace_alloc(1000);
-    gsl_set_error_handler_off();
+    return i;
+    
+}
+
+
+// z^0 and z^1 integrals at one position, returning the sum of the status
+// codes of the integrals (inner ones included) and in rerr the largest
+// relative error estimate
+static int jam_axi_vel_wmmt_pos( struct params_losint *lp, \
+        struct jam_wsquad *qw, double lim, double *iz0, double *iz1, \
+        double *rerr ) {
+        
+    double result, error, e;
+    size_t neval;
+    int s, flag = 0;
+    
+    // inner integrals count their failures here
+    lp->integrationFlag = &flag;
     gsl_function F;
     F.function = &jam_axi_vel_losint;
+    F.params = lp;
     
-    // trig angles
-    si = sin( incl );
-    ci = cos( incl );
+    // do z^0 integral
+    lp->zpow = 0.;
+    s = gsl_integration_cquad(&F, -lim, lim, 0.,
+        1e-4 * lp->quad, qw->cquad, &result, &error, &neval);
+    flag += s;
+    *iz0 = result;
+    *rerr = ( result != 0. ) ? error / fabs( result ) : error;
     
-    // outer limit of integration
-    lim = 4. * maximum( ilum.sigma, ilum.ntotal );
+    // do z^1 integral
+    lp->zpow = 1.;
+    s = gsl_integration_qag(&F, -lim, lim, 1., 1., 1000,
+        2, qw->outer, &result, &error);
+    flag += s;
+    if ( fabs( result ) > 1e-6 ) {
+        s = gsl_integration_cquad(&F, -lim, lim, 0.,
+            1e-3 * lp->quad, qw->cquad, &result, &error, &neval);
+        flag += s;
+        e = error / fabs( result );
+        if ( e > *rerr ) *rerr = e;
+    }
+    *iz1 = result;
     
-    iz0 = (double *) malloc( nxy * sizeof( double ) );
-    iz1 = (double *) malloc( nxy * sizeof( double ) );
-    for ( i = 0; i < nxy; i++ ) {
+    return flag;
+    
+}
+
+
+static void *jam_axi_vel_wmmt_worker( void *arg ) {
+    
+    struct vel_wmmt *wm = arg;
+    struct params_losint lp = wm->lp;
+    struct jam_wsquad own, *qw;
+    double lim = wm->lim, e;
+    int i, s, t, flag = 0;
+    
+    // thread number, for the queue
+    pthread_mutex_lock( &wm->lock );
+    t = wm->next++;
+    pthread_mutex_unlock( &wm->lock );
+    
+    // set up integration, with the inner integrals in a workspace of their
+    // own
+    qw = jam_axi_ws_quad( wm->ws, t, &own );
+    
+    while ( ( lp.stop == NULL || lp.stop->status == JAM_OK ) \
+        && ( i = jam_axi_vel_wmmt_take( wm, t ) ) >= 0 ) {
         
         // parameters for integrand function
-        lp.xp = xp[i];
-        lp.yp = yp[i];
-        
-        // do z^0 integral
-        lp.zpow = 0.;
-        F.function = &jam_axi_vel_losint;
-        F.params = &lp;
-        *integrationFlag += gsl_integration_cquad(&F, -lim, lim, 0., 1e-4, ww,
-            &result, &error, &neval);
-        iz0[i] = result;
-        
-        // do z^1 integral
-        lp.zpow = 1.;
-        F.function = &jam_axi_vel_losint;
-        F.params = &lp;
-        *integrationFlag += gsl_integration_qag(&F, -lim, lim, 1., 1., 1000,
-            2, w, &result, &error);
-        if ( fabs( result ) > 1e-6 ) {
-            *integrationFlag += gsl_integration_cquad(&F, -lim, lim, 0., 1e-3,
-                ww, &result, &error, &neval);
+        lp.xp = wm->xp[i];
+        lp.yp = wm->yp[i];
+        lp.w = qw->inner;
+        lp.retry = 0;
+        s = jam_axi_vel_wmmt_pos( &lp, qw, lim, &wm->iz0[i], &wm->iz1[i], \
+            &e );
+            
+        // retry a failed position with more robust inner integrals
+        if ( s != 0 ) {
+            if ( qw->retry == NULL ) qw->retry = \
+                gsl_integration_workspace_alloc( JAM_RETRY_LIMIT );
+            lp.w = qw->retry;
+            lp.retry = 1;
+            s = jam_axi_vel_wmmt_pos( &lp, qw, lim, &wm->iz0[i], \
+                &wm->iz1[i], &e );
         }
-        iz1[i] = result;
+        
+        // each position counts its own integration failures
+        flag += s;
+        if ( wm->pflag != NULL ) wm->pflag[i] = s;
+        if ( wm->perr != NULL ) wm->perr[i] = e;
         
     }
     
     // tidy up
-    gsl_integration_workspace_free( w );
-    gsl_integration_cquad_workspace_free(ww);
+    jam_axi_ws_quad_put( wm->ws, qw );
+    jam_axi_stop_poll( lp.stop, lp.neval );
+    
+    pthread_mutex_lock( &wm->lock );
+    wm->flag += flag;
+    pthread_mutex_unlock( &wm->lock );
+    
+    return NULL;
+    
+}
+
+
+void jam_axi_vel_wmmt( double *xp, double *yp, int nxy, double incl, \
+        struct jam_lumterms *lt, struct jam_potterms *pt, \
+        int* integrationFlag, double quad, int nthread, struct jam_vel *mu, \
+        int *pflag, double *perr, struct jam_stop *stop, \
+        struct jam_workspace *ws ) {
+        
+    struct vel_wmmt wm;
+    struct params_losint *lp = &wm.lp;
+    pthread_t *threads;
+    double *iz0, *iz1;
+    double si, ci, trpig;
+    int i, t, nrun, *idx;
     
     // ---------------------------------
     
-    sb_mu1 = (double **) malloc( nxy * sizeof( double* ) );
-    for ( i = 0; i < nxy; i++ ) \
-        sb_mu1[i] = (double *) malloc( 3 * sizeof( double ) );
+    // parameters for integrand function
+    lp->incl = incl;
+    lp->lum = &lt->ilum;
+    lp->pot = &pt->ipot;
+    lp->bani = lt->kani;
+    lp->s2l = lt->s2l;
+    lp->q2l = lt->q2l;
+    lp->s2q2l = lt->s2q2l;
+    lp->s2p = pt->s2p;
+    lp->e2p = pt->e2p;
+    lp->kappa = lt->kappa;
+    lp->quad = ( quad > 0. ) ? quad : 1.;
+    lp->stop = stop;
+    lp->neval = 0;
+    lp->retry = 0;
+    
+    // outer limit of integration
+    wm.lim = 4. * maximum( lt->ilum.sigma, lt->ilum.ntotal );
+    
+    wm.ws = ws;
+    wm.xp = xp;
+    wm.yp = yp;
+    wm.nxy = nxy;
+    wm.next = 0;
+    wm.flag = 0;
+    wm.pflag = pflag;
+    wm.perr = perr;
+    for ( i = 0; pflag != NULL && i < nxy; i++ ) pflag[i] = 0;
+    for ( i = 0; perr != NULL && i < nxy; i++ ) perr[i] = 0.;
+    wm.iz0 = iz0 = jam_axi_ws_buf( ws, JAM_WS_IZ0, nxy * sizeof( double ) );
+    wm.iz1 = iz1 = jam_axi_ws_buf( ws, JAM_WS_IZ1, nxy * sizeof( double ) );
+    pthread_mutex_init( &wm.lock, NULL );
+    
+    // ---------------------------------
+    
+    // thread queues (in the order given for a single thread)
+    if ( nthread < 0 ) nthread = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthread > nxy ) nthread = nxy;
+    if ( nthread < 1 ) nthread = 1;
+    wm.nthread = nthread;
+    wm.queue = jam_axi_ws_buf( ws, JAM_WS_QUEUE, \
+        nthread * sizeof( struct vel_queue ) );
+    idx = jam_axi_ws_buf( ws, JAM_WS_IDX, nxy * sizeof( int ) );
+    for ( t = 0; t < nthread; t++ ) \
+        pthread_mutex_init( &wm.queue[t].lock, NULL );
+    if ( nthread > 1 ) jam_axi_vel_wmmt_deal( &wm, \
+        mge_qmed( &lt->ilum, maximum( xp, nxy ) ), idx );
+    else {
+        for ( i = 0; i < nxy; i++ ) idx[i] = i;
+        wm.queue[0].idx = idx;
+        wm.queue[0].head = 0;
+        wm.queue[0].tail = nxy;
+    }
+    
+    // z^0 and z^1 integrals, shared out between threads
+    jam_axi_gsl_init();
+    jam_axi_ws_reserve( ws, nthread );
+    threads = jam_axi_ws_buf( ws, JAM_WS_THREADS, \
+        nthread * sizeof( pthread_t ) );
+    // a thread that cannot be created stops the rest, and those running
+    // (at least the calling thread) take on its share of the work
+    for ( nrun = 1; nrun < nthread; nrun++ ) if ( pthread_create( \
+        &threads[nrun], NULL, &jam_axi_vel_wmmt_worker, &wm ) != 0 ) break;
+    jam_axi_vel_wmmt_worker( &wm );
+    for ( t = 1; t < nrun; t++ ) pthread_join( threads[t], NULL );
+    
+    *integrationFlag += wm.flag;
+    
+    jam_axi_ws_put( ws, threads );
+    for ( t = 0; t < nthread; t++ ) pthread_mutex_destroy( &wm.queue[t].lock );
+    jam_axi_ws_put( ws, wm.queue );
+    jam_axi_ws_put( ws, idx );
+    pthread_mutex_destroy( &wm.lock );
+    
+    // trig angles
+    si = sin( incl );
+    ci = cos( incl );
+    
+    // ---------------------------------
     
     // calculate for each velocity component
     trpig = 2. * sqrt( M_PI * G );
     for ( i = 0; i < nxy; i++ ) {
-        sb_mu1[i][0] = trpig * ( yp[i] * ci * iz0[i] - si * iz1[i] );
-        sb_mu1[i][1] = -trpig * xp[i] * ci * iz0[i];
-        sb_mu1[i][2] = trpig * xp[i] * si * iz0[i];
+        mu->vx[i] = trpig * ( yp[i] * ci * iz0[i] - si * iz1[i] );
+        mu->vy[i] = -trpig * xp[i] * ci * iz0[i];
+        mu->vz[i] = trpig * xp[i] * si * iz0[i];
     }
     
     // ---------------------------------
     
-    free( bani );
-    free( s2l );
-    free( q2l );
-    free( s2q2l );
-    free( s2p );
-    free( e2p );
-    
-    free( iz0 );
-    free( iz1 );
-    
-    return sb_mu1;
+    jam_axi_ws_put( ws, iz0 );
+    jam_axi_ws_put( ws, iz1 );
     
 }
@@ -0,0 +1,228 @@
+/* ----------------------------------------------------------------------------
+  JAM_AXI_WS
+    
+    A workspace that holds the memory used by the integrals between calls,
+    so that evaluating model after model at the same (or fewer) positions
+    does not allocate it again once the first model has been done.  It
+    holds, for each thread, the quadrature workspaces for the outer
+    integral, the inner (line-of-sight) integral and the cquad integral
+    (and, once an integral has failed, the larger one for retrying it), and
+    a set of scratch buffers for the plan, folded positions, the positions
+    of the grid nodes, the interpolation patches, thread queues,
+    intermediate integrals, the moments and status of one model, the
+    copies kept in the cache and the sentinel checks.
+    
+    This is not all that a model allocates: the tracer and potential terms
+    with their deprojected MGEs, the surface brightness, the moment maps on
+    the grid nodes (and the adaptive grid), the choice of sentinels and the
+    arrays returned by jam_axi_rms_mmt and jam_axi_vel_mmt are still
+    allocated and freed on every model, and of these the surface brightness
+    and the returned arrays grow with the number of positions.
+    A workspace starts empty ( struct jam_workspace ws = { NULL } ), grows to
+    the largest size asked for, and is passed to the moment calculations in
+    opts->ws.  It must be used by only one calculation at a time (the thread
+    count is that of the calculation, which manages its own threads); free
+    it with jam_axi_ws_free.
+    
+    Calculations that run several others side by side (jam_axi_mmt, the
+    batches and maps) split their workspace with jam_axi_ws_split into
+    workspaces of their own for each task or thread, which are kept in the
+    workspace for the next call and freed with it.
+    
+    Each function that takes a workspace also works without one (ws = NULL),
+    in which case the memory is allocated and freed on every call as before:
+    jam_axi_ws_buf then returns newly allocated memory and jam_axi_ws_put
+    frees it, and jam_axi_ws_quad fills in own and jam_axi_ws_quad_put frees
+    it.  jam_axi_ws_reserve must be called before threads are started, so
+    that jam_axi_ws_quad can be called by each thread for its own slot (a
+    thread without a reserved slot is given workspaces of its own).
+    
+    INPUTS (jam_axi_ws_buf)
+      ws    : workspace (or NULL)
+      slot  : scratch buffer (JAM_WS_XF, ..., one of enum jam_ws_buf)
+      size  : size needed [bytes]
+      
+    OUTPUTS (jam_axi_ws_buf)
+      The buffer, or NULL if memory cannot be allocated.
+      
+    INPUTS (jam_axi_ws_put)
+      ws    : workspace (or NULL)
+      buf   : buffer from jam_axi_ws_buf
+      
+    INPUTS (jam_axi_ws_reserve)
+      ws      : workspace (or NULL)
+      nthread : number of threads that will call jam_axi_ws_quad
+      
+    INPUTS (jam_axi_ws_quad)
+      ws    : workspace (or NULL)
+      t     : thread number
+      own   : structure to fill if ws is NULL
+      
+    OUTPUTS (jam_axi_ws_quad)
+      The quadrature workspaces of thread t (or own).
+      
+    INPUTS (jam_axi_ws_quad_put)
+      ws    : workspace (or NULL)
+      qw    : quadrature workspaces from jam_axi_ws_quad
+      
+    INPUTS (jam_axi_ws_split)
+      ws    : workspace (or NULL)
+      n     : number of workspaces to split it into
+      
+    OUTPUTS (jam_axi_ws_split)
+      An array of n workspaces, or NULL if ws is NULL or memory cannot be
+      allocated.  It must be called before threads are started.
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gsl/gsl_integration.h>
+#include "jam.h"
+
+
+void *jam_axi_ws_buf( struct jam_workspace *ws, int slot, size_t size ) {
+    
+    void *p;
+    
+    if ( ws == NULL ) return malloc( size );
+    
+    // grow the buffer, but never shrink it
+    if ( size > ws->nbuf[slot] ) {
+        p = realloc( ws->buf[slot], size );
+        if ( p == NULL ) return NULL;
+        ws->buf[slot] = p;
+        ws->nbuf[slot] = size;
+    }
+    
+    return ws->buf[slot];
+    
+}
+
+
+void jam_axi_ws_put( struct jam_workspace *ws, void *buf ) {
+    
+    if ( ws == NULL ) free( buf );
+    
+}
+
+
+void jam_axi_ws_reserve( struct jam_workspace *ws, int nthread ) {
+    
+    struct jam_wsquad *q;
+    
+    if ( ws == NULL || nthread <= ws->nthread ) return;
+    
+    // the new slots are empty until their thread first asks for them
+    q = (struct jam_wsquad *) realloc( ws->quad, \
+        nthread * sizeof( struct jam_wsquad ) );
+    if ( q == NULL ) return;
+    memset( &q[ws->nthread], 0, \
+        ( nthread - ws->nthread ) * sizeof( struct jam_wsquad ) );
+    ws->quad = q;
+    ws->nthread = nthread;
+    
+}
+
+
+static void jam_axi_ws_quad_alloc( struct jam_wsquad *qw ) {
+    
+    qw->outer = gsl_integration_workspace_alloc( 1000 );
+    qw->inner = gsl_integration_workspace_alloc( 1000 );
+    qw->cquad = gsl_integration_cquad_workspace_alloc( 1000 );
+    qw->retry = NULL;
+    
+}
+
+
+struct jam_wsquad *jam_axi_ws_quad( struct jam_workspace *ws, int t, \
+        struct jam_wsquad *own ) {
+        
+    struct jam_wsquad *qw;
+    
+    if ( ws == NULL || t >= ws->nthread ) {
+        jam_axi_ws_quad_alloc( own );
+        own->own = 1;
+        return own;
+    }
+    
+    qw = &ws->quad[t];
+    if ( qw->outer == NULL ) jam_axi_ws_quad_alloc( qw );
+    
+    return qw;
+    
+}
+
+
+static void jam_axi_ws_quad_release( struct jam_wsquad *qw ) {
+    
+    if ( qw->outer != NULL ) gsl_integration_workspace_free( qw->outer );
+    if ( qw->inner != NULL ) gsl_integration_workspace_free( qw->inner );
+    if ( qw->cquad != NULL ) gsl_integration_cquad_workspace_free( qw->cquad );
+    if ( qw->retry != NULL ) gsl_integration_workspace_free( qw->retry );
+    qw->outer = qw->inner = qw->retry = NULL;
+    qw->cquad = NULL;
+    
+}
+
+
+void jam_axi_ws_quad_put( struct jam_workspace *ws, struct jam_wsquad *qw ) {
+    
+    // the workspaces of a slot stay in ws, only those of a thread without
+    // one (or of a calculation without ws) are freed
+    ( void ) ws;
+    if ( qw->own ) jam_axi_ws_quad_release( qw );
+    
+}
+
+
+struct jam_workspace *jam_axi_ws_split( struct jam_workspace *ws, int n ) {
+    
+    struct jam_workspace *s;
+    
+    if ( ws == NULL ) return NULL;
+    if ( n <= ws->nsplit ) return ws->split;
+    
+    // the new workspaces start empty, like any other
+    s = (struct jam_workspace *) realloc( ws->split, \
+        n * sizeof( struct jam_workspace ) );
+    if ( s == NULL ) return NULL;
+    memset( &s[ws->nsplit], 0, \
+        ( n - ws->nsplit ) * sizeof( struct jam_workspace ) );
+    ws->split = s;
+    ws->nsplit = n;
+    
+    return ws->split;
+    
+}
+
+
+void jam_axi_ws_free( struct jam_workspace *ws ) {
+    
+    int i;
+    
+    for ( i = 0; i < ws->nsplit; i++ ) jam_axi_ws_free( &ws->split[i] );
+    free( ws->split );
+    ws->split = NULL;
+    ws->nsplit = 0;
+    
+    for ( i = 0; i < ws->nthread; i++ ) jam_axi_ws_quad_release( &ws->quad[i] );
+    free( ws->quad );
+    ws->quad = NULL;
+    ws->nthread = 0;
+    
+    for ( i = 0; i < JAM_WS_NBUF; i++ ) {
+        free( ws->buf[i] );
+        ws->buf[i] = NULL;
+        ws->nbuf[i] = 0;
+    }
+    
+}
@@ -4,6 +4,13 @@
     mge_addbh     : add a black hole component to an MGE
     mge_dens      : MGE volume density at a given position
     mge_deproject : MGE deprojection for a given inclination angle
+    mge_deproject_check : check that an MGE can be deprojected
+    mge_fit1d     : fit a spherical MGE to a spherical density profile
+    mge_halo_burkert : Burkert dark-matter halo density
+    mge_halo_gnfw : generalised NFW dark-matter halo density
+    mge_halo_zhao : double power-law dark-matter halo density
+    mge_merge     : combine the components of two MGEs
+    mge_project   : MGE projection for a given inclination angle
     mge_qmed      : MGE median flattening
     mge_read      : read MGE from file into structure
     mge_surf      : MGE surface density at a given position
@@ -12,6 +19,9 @@
   Laura L Watkins [lauralwatkins@gmail.com]
 ----------------------------------------------------------------------------- */
 
+#ifndef MGE_H
+#define MGE_H
+
 struct multigaussexp {
     double *area;
     double *sigma;
@@ -25,8 +35,26 @@ double mge_dens( struct multigaussexp *, double, double );
 
 struct multigaussexp mge_deproject( struct multigaussexp *, double );
 
+int mge_deproject_check( struct multigaussexp *, double );
+
+struct multigaussexp mge_fit1d( double (*)( double, void * ), void *, \
+    double, double, int, int, double * );
+
+double mge_halo_burkert( double, void * );
+
+double mge_halo_gnfw( double, void * );
+
+double mge_halo_zhao( double, void * );
+
+struct multigaussexp mge_merge( struct multigaussexp *, \
+    struct multigaussexp * );
+
+struct multigaussexp mge_project( struct multigaussexp *, double );
+
 double mge_qmed( struct multigaussexp *, double );
 
 void mge_read( char *, int, struct multigaussexp * );
 
 double* mge_surf( struct multigaussexp *, double *, double *, int );
+
+#endif
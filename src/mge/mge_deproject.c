@@ -1,7 +1,13 @@
 /* ----------------------------------------------------------------------------
   MGE_DEPROJECT
     
-    Deprojects an MGE given an inclination value.
+    Deprojects an MGE given an inclination value.  A component can only be
+    deprojected if its projected flattening q' > cos(incl), and the intrinsic
+    flattening must be at least 0.05; mge_deproject_check tests this
+    beforehand, returning 0 if the MGE can be deprojected, 1 if the
+    inclination is too low for a component and 2 if a component would be
+    too flat.  mge_deproject itself does not check, and gives NaN or
+    unphysical flattenings for such components.
     
     INPUTS
       pmge : projected MGE
@@ -41,20 +47,10 @@ struct multigaussexp mge_deproject( struct multigaussexp *pmge, double incl ) {
         // sigmas stay the same
         imge.sigma[i] = pmge->sigma[i];
         
-        // convert flattening values (and exit if q is too small)
+        // convert flattening values
         imge.q[i] = pmge->q[i] * pmge->q[i] - ci * ci;
-        if ( imge.q[i] < 0. ) {
-            printf( "Inclination %lf is too low: q<0\n", incl );
-            exit(0);
-        }
         if (incl==0.) imge.q[i] = 1.; // avoid problems when sin(incl)=0
-        else {
-            imge.q[i] = sqrt( imge.q[i] ) / si;
-            if ( imge.q[i] < 0.05 ) {
-                printf( "There are components with q<0.05\n" );
-                exit(0);
-            }
-        }
+        else imge.q[i] = sqrt( imge.q[i] ) / si;
         
         // convert surface density to volume density
         imge.area[i] = pmge->area[i] * pmge->q[i] / pmge->sigma[i] \
@@ -64,3 +60,22 @@ struct multigaussexp mge_deproject( struct multigaussexp *pmge, double incl ) {
     return imge;
     
 }
+
+
+int mge_deproject_check( struct multigaussexp *pmge, double incl ) {
+    
+    double si, ci, q2;
+    int i;
+    
+    si = sin( incl );
+    ci = cos( incl );
+    
+    for ( i = 0; i < pmge->ntotal; i++ ) {
+        q2 = pmge->q[i] * pmge->q[i] - ci * ci;
+        if ( !( q2 >= 0. ) ) return 1;
+        if ( incl != 0. && sqrt( q2 ) / si < 0.05 ) return 2;
+    }
+    
+    return 0;
+    
+}
@@ -0,0 +1,117 @@
+/* ----------------------------------------------------------------------------
+  MGE_FIT1D
+    
+    Fits a spherical MGE to a spherical density profile, e.g. an analytic
+    dark-matter halo (see mge_halo).  The Gaussian widths are fixed and
+    logarithmically spaced between rmin/2 (so that a central cusp is
+    followed all the way in to rmin) and rmax, so only the Gaussian
+    amplitudes need to be found; these are the non-negative least-squares
+    solution for the relative residuals at nrad logarithmically spaced
+    radii.  Components with zero amplitude are dropped.  The result is a
+    projected MGE [area in M/pc^2, sigma in pc] that can be combined with
+    other potential components using mge_merge or mge_addbh.
+    
+    At least two Gaussians and two radii are needed to span the range from
+    rmin to rmax; with fewer, the MGE returned is empty and the error is set
+    to HUGE_VAL.
+    
+    INPUTS
+      dens   : density profile [M/pc^3] as a function of radius [pc]
+      params : parameters passed to the density profile
+      rmin   : smallest radius fitted [pc]
+      rmax   : largest radius fitted [pc]
+      ngauss : number of Gaussian components (at least 2)
+      nrad   : number of radii fitted (at least 2)
+      err    : largest relative error of the fit at the fitted radii (may be
+               NULL)
+               
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mge.h"
+#include "../tools/tools.h"
+
+
+struct multigaussexp mge_fit1d( double (*dens)( double, void * ), \
+        void *params, double rmin, double rmax, int ngauss, int nrad, \
+        double *err ) {
+        
+    struct multigaussexp mge;
+    double *r, *sigma, *rho, *a, *b, *x, fit;
+    int i, j, k;
+    
+    // the widths and radii are spaced from the first to the last
+    if ( ngauss < 2 || nrad < 2 ) {
+        mge.ntotal = 0;
+        mge.area = mge.sigma = mge.q = NULL;
+        if ( err != NULL ) *err = HUGE_VAL;
+        return mge;
+    }
+    
+    r = (double *) malloc( nrad * sizeof( double ) );
+    rho = (double *) malloc( nrad * sizeof( double ) );
+    sigma = (double *) malloc( ngauss * sizeof( double ) );
+    a = (double *) malloc( nrad * ngauss * sizeof( double ) );
+    b = (double *) malloc( nrad * sizeof( double ) );
+    x = (double *) malloc( ngauss * sizeof( double ) );
+    
+    // fitted radii and fixed Gaussian widths, logarithmically spaced
+    for ( i = 0; i < nrad; i++ ) {
+        r[i] = rmin * pow( rmax / rmin, (double) i / ( nrad - 1 ) );
+        rho[i] = dens( r[i], params );
+    }
+    for ( j = 0; j < ngauss; j++ ) sigma[j] = 0.5 * rmin \
+        * pow( 2. * rmax / rmin, (double) j / ( ngauss - 1 ) );
+        
+    // relative residuals are linear in the central densities
+    for ( i = 0; i < nrad; i++ ) {
+        for ( j = 0; j < ngauss; j++ ) a[i*ngauss+j] \
+            = exp( -0.5 * pow( r[i] / sigma[j], 2. ) ) / rho[i];
+        b[i] = 1.;
+    }
+    nnls( a, nrad, ngauss, b, x );
+    
+    // largest relative error of fit
+    if ( err != NULL ) {
+        *err = 0.;
+        for ( i = 0; i < nrad; i++ ) {
+            fit = 0.;
+            for ( j = 0; j < ngauss; j++ ) fit += a[i*ngauss+j] * x[j];
+            if ( fabs( fit - 1. ) > *err ) *err = fabs( fit - 1. );
+        }
+    }
+    
+    // keep non-zero components, converting central density to projected
+    // central surface density
+    mge.ntotal = 0;
+    for ( j = 0; j < ngauss; j++ ) if ( x[j] > 0. ) mge.ntotal++;
+    mge.area = (double *) malloc( mge.ntotal * sizeof( double ) );
+    mge.sigma = (double *) malloc( mge.ntotal * sizeof( double ) );
+    mge.q = (double *) malloc( mge.ntotal * sizeof( double ) );
+    for ( j = 0, k = 0; j < ngauss; j++ ) {
+        if ( x[j] <= 0. ) continue;
+        mge.area[k] = x[j] * sqrt( 2. * M_PI ) * sigma[j];
+        mge.sigma[k] = sigma[j];
+        mge.q[k] = 1.;
+        k++;
+    }
+    
+    free( r );
+    free( rho );
+    free( sigma );
+    free( a );
+    free( b );
+    free( x );
+    
+    return mge;
+    
+}
@@ -0,0 +1,64 @@
+/* ----------------------------------------------------------------------------
+  MGE_HALO
+    
+    Analytic spherical density profiles for dark-matter haloes, in the form
+    needed by mge_fit1d.
+    
+    mge_halo_gnfw : generalised NFW profile
+        rho(r) = rhos (r/rs)^-gamma (1 + r/rs)^(gamma-3)
+      params = { rhos [M/pc^3], rs [pc], gamma }, gamma = 1 gives NFW
+      
+    mge_halo_zhao : double power-law profile (Zhao 1996)
+        rho(r) = rhos (r/rs)^-gamma (1 + (r/rs)^alpha)^((gamma-beta)/alpha)
+      params = { rhos [M/pc^3], rs [pc], alpha, beta, gamma }, gamma = 0 gives
+      a cored profile
+      
+    mge_halo_burkert : cored profile of Burkert (1995)
+        rho(r) = rhos / ( (1 + r/rs) (1 + (r/rs)^2) )
+      params = { rhos [M/pc^3], rs [pc] }
+      
+    INPUTS
+      r      : radius [pc]
+      params : array of profile parameters (as above)
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mge.h"
+
+
+double mge_halo_gnfw( double r, void *params ) {
+    
+    double *p = params, x = r / p[1];
+    
+    return p[0] * pow( x, -p[2] ) * pow( 1. + x, p[2] - 3. );
+    
+}
+
+
+double mge_halo_zhao( double r, void *params ) {
+    
+    double *p = params, x = r / p[1];
+    
+    return p[0] * pow( x, -p[4] ) * pow( 1. + pow( x, p[2] ), \
+        ( p[4] - p[3] ) / p[2] );
+        
+}
+
+
+double mge_halo_burkert( double r, void *params ) {
+    
+    double *p = params, x = r / p[1];
+    
+    return p[0] / ( ( 1. + x ) * ( 1. + x * x ) );
+    
+}
@@ -0,0 +1,51 @@
+/* ----------------------------------------------------------------------------
+  MGE_MERGE
+    
+    Combines the components of two MGEs into a single MGE, e.g. a stellar
+    mass MGE and a dark-matter halo MGE from mge_fit1d.
+    
+    INPUTS
+      mge1 : first MGE
+      mge2 : second MGE
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mge.h"
+
+
+struct multigaussexp mge_merge( struct multigaussexp *mge1, \
+    struct multigaussexp *mge2 ) {
+    
+    struct multigaussexp mge;
+    int i;
+    
+    // memory allocation
+    mge.ntotal = mge1->ntotal + mge2->ntotal;
+    mge.area = ( double * ) malloc( mge.ntotal * sizeof( double ) );
+    mge.sigma = ( double * ) malloc( mge.ntotal * sizeof( double ) );
+    mge.q = ( double * ) malloc( mge.ntotal * sizeof( double ) );
+    
+    // copy components of both MGEs
+    for ( i = 0; i < mge1->ntotal; i++ ) {
+        mge.area[i] = mge1->area[i];
+        mge.sigma[i] = mge1->sigma[i];
+        mge.q[i] = mge1->q[i];
+    }
+    for ( i = 0; i < mge2->ntotal; i++ ) {
+        mge.area[mge1->ntotal+i] = mge2->area[i];
+        mge.sigma[mge1->ntotal+i] = mge2->sigma[i];
+        mge.q[mge1->ntotal+i] = mge2->q[i];
+    }
+    
+    return mge;
+    
+}
@@ -0,0 +1,55 @@
+/* ----------------------------------------------------------------------------
+  MGE_PROJECT
+    
+    Projects an intrinsic MGE given an inclination value (the inverse of
+    mge_deproject).
+    
+    INPUTS
+      imge : intrinsic MGE
+      incl : inclination [radians]
+  
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mge.h"
+
+
+struct multigaussexp mge_project( struct multigaussexp *imge, double incl ) {
+    
+    struct multigaussexp pmge;
+    double si, ci;
+    int i;
+    
+    si = sin( incl );
+    ci = cos( incl );
+    
+    pmge.ntotal = imge->ntotal;
+    pmge.sigma = (double *) malloc( imge->ntotal * sizeof( double ) );
+    pmge.area = (double *) malloc( imge->ntotal * sizeof( double ) );
+    pmge.q = (double *) malloc( imge->ntotal * sizeof( double ) );
+    
+    for ( i = 0; i < imge->ntotal ; i++ ) {
+        
+        // sigmas stay the same
+        pmge.sigma[i] = imge->sigma[i];
+        
+        // convert flattening values
+        pmge.q[i] = sqrt( imge->q[i] * imge->q[i] * si * si + ci * ci );
+        
+        // convert volume density to surface density
+        pmge.area[i] = imge->area[i] * imge->q[i] * imge->sigma[i] \
+            * sqrt( 2. * M_PI ) / pmge.q[i];
+    }
+    
+    return pmge;
+    
+}
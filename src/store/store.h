@@ -0,0 +1,56 @@
+/* -----------------------------------------------------------------------------
+  STORE PROGRAMS
+    
+    store        : attached shared table store structure
+    store_attach : map a table store read-only into memory
+    store_detach : unmap a table store
+    store_entry  : table directory entry structure
+    store_get    : find a table in an attached store
+    store_lock   : take the builder lock of a table store
+    store_table  : table structure for writing
+    store_unlock : release the builder lock of a table store
+    store_write  : write a table store
+    
+  Laura L Watkins [lauralwatkins@gmail.com]
+----------------------------------------------------------------------------- */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include "../cache/cache.h"
+
+#define STORE_VERSION 1
+#define STORE_NAMELEN 24
+
+struct store_entry {
+    char name[STORE_NAMELEN];
+    long offset, n;
+};
+
+struct store {
+    void *base;
+    size_t size;
+    int ntab;
+    struct store_entry *tab;
+};
+
+struct store_table {
+    char *name;
+    double *val;
+    long n;
+};
+
+struct store* store_attach( char *, struct cache_key * );
+
+void store_detach( struct store * );
+
+double* store_get( struct store *, char *, long * );
+
+int store_lock( char * );
+
+void store_unlock( int );
+
+int store_write( char *, struct cache_key *, struct store_table *, int );
+
+#endif
@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+  STORE_ATTACH
+    
+    Maps a store file written by store_write read-only into memory.  The
+    mapping is shared, so every process attached to the same store uses the
+    same physical pages and no tables are copied.  Returns NULL if the file
+    does not exist, was written by a different format version, holds
+    tables for a different content key or is damaged: a negative number of
+    tables, or a table with a negative length, or one that is not aligned to
+    a double or does not lie between the end of the directory and the end of
+    the file.
+    
+    INPUTS
+      path : store file
+      key  : content key of the expected tables
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "store.h"
+
+
+struct store* store_attach( char *path, struct cache_key *key ) {
+    
+    struct store *st;
+    struct stat sb;
+    int fd, head[3], i;
+    unsigned long long hash[2];
+    size_t hsize, dsize;
+    void *base;
+    char *p;
+    
+    fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return NULL;
+    if ( fstat( fd, &sb ) != 0 ) {
+        close( fd );
+        return NULL;
+    }
+    hsize = 4 + 3 * sizeof( int ) + 2 * sizeof( hash[0] );
+    if ( (size_t) sb.st_size < hsize ) {
+        close( fd );
+        return NULL;
+    }
+    
+    // the mapping stays valid after the file is closed or replaced
+    base = mmap( NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( base == MAP_FAILED ) return NULL;
+    
+    // check magic, version and content key
+    p = base;
+    memcpy( head, p + 4, sizeof( head ) );
+    memcpy( hash, p + 4 + sizeof( head ), sizeof( hash ) );
+    if ( memcmp( p, "JAMS", 4 ) != 0 || head[0] != STORE_VERSION \
+            || hash[0] != key->h1 || hash[1] != key->h2 || head[1] < 0 \
+            || (size_t) head[1] > ( sb.st_size - hsize ) \
+                / sizeof( struct store_entry ) ) {
+        munmap( base, sb.st_size );
+        return NULL;
+    }
+    
+    st = (struct store *) malloc( sizeof( struct store ) );
+    st->base = base;
+    st->size = sb.st_size;
+    st->ntab = head[1];
+    st->tab = (struct store_entry *) ( p + hsize );
+    
+    // check every table is aligned and lies between the directory and the
+    // end of the file (without overflowing on a damaged length)
+    dsize = hsize + st->ntab * sizeof( struct store_entry );
+    for ( i = 0; i < st->ntab; i++ ) {
+        if ( st->tab[i].n < 0 || st->tab[i].offset < (long) dsize \
+                || st->tab[i].offset % sizeof( double ) != 0 \
+                || st->tab[i].offset > (long) st->size \
+                || st->tab[i].n > ( (long) st->size - st->tab[i].offset ) \
+                    / (long) sizeof( double ) ) {
+            store_detach( st );
+            return NULL;
+        }
+    }
+    
+    return st;
+    
+}
+
+
+void store_detach( struct store *st ) {
+    
+    if ( st == NULL ) return;
+    munmap( st->base, st->size );
+    free( st );
+    
+}
+
+
+double* store_get( struct store *st, char *name, long *n ) {
+    
+    int i;
+    
+    for ( i = 0; i < st->ntab; i++ ) {
+        if ( strncmp( st->tab[i].name, name, STORE_NAMELEN ) == 0 ) {
+            if ( n != NULL ) *n = st->tab[i].n;
+            return (double *) ( (char *) st->base + st->tab[i].offset );
+        }
+    }
+    
+    if ( n != NULL ) *n = 0;
+    return NULL;
+    
+}
@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+  STORE_LOCK
+    
+    Takes an exclusive lock on a store, so that only one process builds the
+    tables while the others wait and then attach to the result.  The lock is
+    held on a separate lock file (path with ".lock" appended) rather than
+    the store itself, since the store is replaced when it is rewritten.
+    Returns a descriptor to pass to store_unlock, or -1 on failure.
+    
+    INPUTS
+      path : store file
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "store.h"
+
+
+int store_lock( char *path ) {
+    
+    char *lock;
+    int fd;
+    
+    lock = (char *) malloc( strlen( path ) + 6 );
+    sprintf( lock, "%s.lock", path );
+    fd = open( lock, O_RDWR | O_CREAT, 0644 );
+    free( lock );
+    if ( fd < 0 ) return -1;
+    
+    if ( flock( fd, LOCK_EX ) != 0 ) {
+        close( fd );
+        return -1;
+    }
+    
+    return fd;
+    
+}
+
+
+void store_unlock( int fd ) {
+    
+    if ( fd < 0 ) return;
+    flock( fd, LOCK_UN );
+    close( fd );
+    
+}
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+  STORE_WRITE
+    
+    Writes a set of named tables to a store file that other processes can
+    map into memory with store_attach.  The file starts with a header (magic,
+    format version, content key and number of tables) and a directory of
+    table names, offsets and lengths, followed by the tables themselves.
+    It is written to a temporary file and renamed into place, so processes
+    that are already attached keep their old mapping and new processes see
+    either the old or the new store but never a partial one.  Returns 0 on
+    success and 1 on failure.
+    
+    INPUTS
+      path : store file
+      key  : content key of the tables (checked by store_attach)
+      tab  : tables to write
+      ntab : number of tables
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "store.h"
+
+
+int store_write( char *path, struct cache_key *key, struct store_table *tab, \
+        int ntab ) {
+        
+    FILE *fp;
+    char *tmp;
+    int head[3], i, ok;
+    unsigned long long hash[2];
+    long offset;
+    struct store_entry *dir;
+    
+    // directory of tables, with data starting after the header (the header
+    // is padded so that every table is aligned to a double)
+    dir = (struct store_entry *) calloc( ntab, sizeof( struct store_entry ) );
+    offset = 4 + 3 * sizeof( int ) + 2 * sizeof( hash[0] ) \
+        + ntab * sizeof( struct store_entry );
+    for ( i = 0; i < ntab; i++ ) {
+        strncpy( dir[i].name, tab[i].name, STORE_NAMELEN - 1 );
+        dir[i].offset = offset;
+        dir[i].n = tab[i].n;
+        offset += tab[i].n * sizeof( double );
+    }
+    
+    tmp = (char *) malloc( strlen( path ) + 24 );
+    sprintf( tmp, "%s.%ld.tmp", path, (long) getpid() );
+    fp = fopen( tmp, "wb" );
+    if ( fp == NULL ) {
+        free( tmp );
+        free( dir );
+        return 1;
+    }
+    
+    head[0] = STORE_VERSION;
+    head[1] = ntab;
+    head[2] = 0;
+    hash[0] = key->h1;
+    hash[1] = key->h2;
+    ok = fwrite( "JAMS", 1, 4, fp ) == 4 \
+        && fwrite( head, sizeof( int ), 3, fp ) == 3 \
+        && fwrite( hash, sizeof( hash[0] ), 2, fp ) == 2 \
+        && fwrite( dir, sizeof( struct store_entry ), ntab, fp ) \
+            == (size_t) ntab;
+    for ( i = 0; ok && i < ntab; i++ ) \
+        ok = fwrite( tab[i].val, sizeof( double ), tab[i].n, fp ) \
+            == (size_t) tab[i].n;
+            
+    if ( fclose( fp ) != 0 ) ok = 0;
+    if ( ok && rename( tmp, path ) != 0 ) ok = 0;
+    if ( !ok ) remove( tmp );
+    
+    free( tmp );
+    free( dir );
+    
+    return ok ? 0 : 1;
+    
+}
@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------------------
+  NNLS
+    
+    Solves the non-negative least-squares problem min |A x - b| subject to
+    x >= 0 with the active-set method of Lawson & Hanson (1974, Solving
+    Least Squares Problems, ch. 23).  The columns of A are scaled to unit
+    norm first, so that columns of very different size (e.g. basis
+    functions weighted by a steep profile) are treated alike, and the
+    unconstrained subproblems are solved by Householder QR of the columns in
+    the passive set.  Returns 0
+    on convergence and 1 if the iteration limit was reached (x then holds
+    the last feasible solution).
+    
+    INPUTS
+      a : m x n matrix A, stored by rows (a[i*n+j])
+      m : number of rows
+      n : number of columns
+      b : m values of b
+      x : array to hold the n values of the solution
+      
+  Laura L Watkins [lauralwatkins@gmail.com]
+  
+  This code is released under a BSD 2-clause license.
+  If you use this code for your research, please cite:
+  Watkins et al. 2013, MNRAS, 436, 2598
+  "Discrete dynamical models of omega Centauri"
+  http://adsabs.harvard.edu/abs/2013MNRAS.436.2598W
+---------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <math.h>
+
+
+// least-squares solution using only the columns listed in cols
+static void nnls_lsq( double *a, int m, int n, double *b, int *cols, \
+        int np, double *q, double *r, double *z ) {
+        
+    int i, j, k;
+    double norm, s, v0, d;
+    
+    // copy passive columns (column-major) and right-hand side
+    for ( k = 0; k < np; k++ ) \
+        for ( i = 0; i < m; i++ ) q[k*m+i] = a[i*n+cols[k]];
+    for ( i = 0; i < m; i++ ) r[i] = b[i];
+    
+    // Householder QR, applying each reflection to b as we go
+    for ( k = 0; k < np; k++ ) {
+        norm = 0.;
+        for ( i = k; i < m; i++ ) norm += q[k*m+i] * q[k*m+i];
+        norm = sqrt( norm );
+        if ( norm == 0. ) continue;
+        if ( q[k*m+k] > 0. ) norm = -norm;
+        v0 = q[k*m+k] - norm;
+        q[k*m+k] = v0;
+        s = -v0 * norm;
+        for ( j = k + 1; j < np; j++ ) {
+            d = 0.;
+            for ( i = k; i < m; i++ ) d += q[k*m+i] * q[j*m+i];
+            d /= s;
+            for ( i = k; i < m; i++ ) q[j*m+i] -= d * q[k*m+i];
+        }
+        d = 0.;
+        for ( i = k; i < m; i++ ) d += q[k*m+i] * r[i];
+        d /= s;
+        for ( i = k; i < m; i++ ) r[i] -= d * q[k*m+i];
+        q[k*m+k] = norm;
+    }
+    
+    // back substitution (diagonal of R is on the diagonal of q)
+    for ( k = np - 1; k >= 0; k-- ) {
+        s = r[k];
+        for ( j = k + 1; j < np; j++ ) s -= q[j*m+k] * z[cols[j]];
+        z[cols[k]] = ( q[k*m+k] != 0. ) ? s / q[k*m+k] : 0.;
+    }
+    
+}
+
+
+int nnls( double *a, int m, int n, double *b, double *x ) {
+    
+    int i, j, t, tmin, np, iter, maxiter, *passive, *cols, status;
+    double *w, *z, *q, *r, *res, *scale, *as, wmax, alpha, tol;
+    
+    // scale columns to unit norm
+    scale = (double *) malloc( n * sizeof( double ) );
+    as = (double *) malloc( m * n * sizeof( double ) );
+    for ( j = 0; j < n; j++ ) {
+        scale[j] = 0.;
+        for ( i = 0; i < m; i++ ) scale[j] += a[i*n+j] * a[i*n+j];
+        scale[j] = ( scale[j] > 0. ) ? 1. / sqrt( scale[j] ) : 1.;
+        for ( i = 0; i < m; i++ ) as[i*n+j] = a[i*n+j] * scale[j];
+    }
+    a = as;
+    
+    passive = (int *) calloc( n, sizeof( int ) );
+    cols = (int *) malloc( n * sizeof( int ) );
+    w = (double *) malloc( n * sizeof( double ) );
+    z = (double *) malloc( n * sizeof( double ) );
+    q = (double *) malloc( m * n * sizeof( double ) );
+    r = (double *) malloc( m * sizeof( double ) );
+    res = (double *) malloc( m * sizeof( double ) );
+    
+    for ( j = 0; j < n; j++ ) x[j] = 0.;
+    
+    // tolerance on the dual variables, relative to the size of A^T b
+    tol = 0.;
+    for ( j = 0; j < n; j++ ) {
+        w[j] = 0.;
+        for ( i = 0; i < m; i++ ) w[j] += a[i*n+j] * b[i];
+        if ( fabs( w[j] ) > tol ) tol = fabs( w[j] );
+    }
+    tol *= 1e-12;
+    
+    status = 1;
+    maxiter = 3 * n;
+    for ( iter = 0; iter < maxiter; iter++ ) {
+        
+        // dual variables w = A^T ( b - A x )
+        for ( i = 0; i < m; i++ ) {
+            res[i] = b[i];
+            for ( j = 0; j < n; j++ ) res[i] -= a[i*n+j] * x[j];
+        }
+        t = -1;
+        wmax = tol;
+        for ( j = 0; j < n; j++ ) {
+            if ( passive[j] ) continue;
+            w[j] = 0.;
+            for ( i = 0; i < m; i++ ) w[j] += a[i*n+j] * res[i];
+            if ( w[j] > wmax ) {
+                wmax = w[j];
+                t = j;
+            }
+        }
+        
+        // converged when no inactive column would reduce the residual
+        if ( t < 0 ) {
+            status = 0;
+            break;
+        }
+        passive[t] = 1;
+        
+        while ( 1 ) {
+            
+            // unconstrained solution on the passive set
+            np = 0;
+            for ( j = 0; j < n; j++ ) if ( passive[j] ) cols[np++] = j;
+            nnls_lsq( a, m, n, b, cols, np, q, r, z );
+            
+            // accept it if it is feasible
+            alpha = 2.;
+            tmin = -1;
+            for ( j = 0; j < np; j++ ) {
+                t = cols[j];
+                if ( z[t] <= 0. && x[t] / ( x[t] - z[t] ) < alpha ) {
+                    alpha = x[t] / ( x[t] - z[t] );
+                    tmin = t;
+                }
+            }
+            if ( tmin < 0 ) {
+                for ( j = 0; j < np; j++ ) x[cols[j]] = z[cols[j]];
+                break;
+            }
+            
+            // otherwise step towards it and drop the columns that hit zero
+            for ( j = 0; j < np; j++ ) {
+                t = cols[j];
+                x[t] += alpha * ( z[t] - x[t] );
+                if ( t == tmin || x[t] <= 0. ) {
+                    x[t] = 0.;
+                    passive[t] = 0;
+                }
+            }
+            
+        }
+        
+    }
+    
+    // undo column scaling
+    for ( j = 0; j < n; j++ ) x[j] *= scale[j];
+    
+    free( scale );
+    free( as );
+    free( passive );
+    free( cols );
+    free( w );
+    free( z );
+    free( q );
+    free( r );
+    free( res );
+    
+    return status;
+    
+}
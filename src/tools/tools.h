@@ -4,6 +4,7 @@
     maximum   : finds the maximum value in an array
     median    : calculates median of an array of values
     minimum   : finds the minimum value in an array
+    nnls      : non-negative least-squares solution of a linear system
     range     : creates an array of n numbers between given limits
     sort_dbl  : sorts an array of doubles
     where     : selects a given subset of an array
@@ -17,6 +18,8 @@ double median( double *, int );
 
 double minimum( double *, int );
 
+int nnls( double *, int, int, double *, double * );
+
 double* range(double , double , int, int );
 
 void sort_dbl( double *, int );
@@ -1,7 +1,8 @@
 /* ----------------------------------------------------------------------------
   WHERE
     
-    Selects a given subset of an array.
+    Selects a given subset of an array.  Returns NULL if memory cannot be
+    allocated.
     
     INPUTS
       in     : input array
@@ -28,10 +29,7 @@ double* where( double *in, int *select, int n ) {
     
     // allocate memory
     out = (double *) malloc( n * sizeof( double ) );
-    if ( out == NULL ) {
-        printf( "Error: failed in memory declaration\n" );
-        exit(1);
-    }
+    if ( out == NULL ) return NULL;
     
     // only take selected elements
     for ( i = 0; i < n; i++ ) {